@@ -3,17 +3,17 @@
 #include <assert.h>
 #include <stdbool.h>
 #include <stddef.h>
+#include <string.h>
 
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
 
 #ifdef __EMSCRIPTEN__
-#include <GLES2/gl2.h>
 #include <emscripten.h>
-#else
-#include <glad/glad.h>
 #endif
 
+#include "glcaps.h"
+
 #define GLFW_INCLUDE_NONE
 #include <GLFW/glfw3.h>
 #include <GL/gl.h>
@@ -22,634 +22,499 @@
 #include <cglm/cglm.h>
 #include <cglm/types.h>
 
+#include "mesh.h"
+#include "glstats.h"
+#include "glstate.h"
+#include "ubo.h"
+#include "instance.h"
+#include "texarray.h"
+#include "program.h"
+#include "progcache.h"
+#include "texcache.h"
+#include "shader.h"
+#include "pool.h"
+#include "texload.h"
+#include "texstream.h"
+#include "texres.h"
+#include "vtex.h"
+#include "asset.h"
+#include "arena.h"
+#include "memstats.h"
+#include "scene.h"
+#include "sim.h"
+#include "rigid.h"
+
 const unsigned int DISP_WIDTH = 1200;
 const unsigned int DISP_HEIGHT = 500;
 const float PI = 3.14159265358979323846f;
 
 GLFWwindow *window;
-GLuint obj_shader_program;
-GLuint spc_shader_program;
+// NULL until its build is collected
+program *spc_shader_program;
+const char *spc_vert = "textures/spc_texture.vert";
+const char *spc_frag = "textures/spc_texture.frag";
 
-GLuint mv_mat_loc;
-GLuint normal_mat_loc;
-GLuint proj_mat_loc;
-GLuint light_pos_loc;
-GLuint ambient_col_loc;
-GLuint diffuse_col_loc;
+// body shaders; the GLES2 ones unless the uniform buffer ones build
+const char *body_vert = "textures/texture_ubo.vert";
+const char *body_frag = "textures/texture_ubo.frag";
+
+// bodies smaller than this against their distance are drawn unlit
+const float FAR_BODY_RATIO = 0.005f;
 
 typedef struct AstroObject
 {
+    GLuint vao;
     GLuint vbo;
     GLuint ebo;
     GLuint texture;
     GLuint vertexes_size;
     GLsizei indices_size;
-    GLuint *indices;
+    GLenum index_type;
+    bool instanced;
     GLint object_pos;
     GLint object_texture;
     GLint object_normal;
+    mesh_data mesh;             // CPU copy, when retained at upload
 } astro_object;
 
-typedef struct AstroAttributes
+#define MAX_BODIES INSTANCE_MAX
+
+// Bodies are instances of the shared sphere mesh, with their colour map in
+// a layer of the body texture array.
+typedef struct Body
 {
-    float positions[3];
-    float textures[2];
-    float normals[3];
-} astro_attributes;
+    unsigned int layer;
+    int night_layer;            // -1 without a night map
+    unsigned int features;      // SHADER_* lighting features
+    GLfloat radius;
+} body;
 
 typedef struct GLData
 {
-    astro_object *earth;
-    astro_object *moon;
     astro_object *space;
+    astro_object *sphere;
+    tex_resident space_texture;
+    tex_resident body_textures;     // a tex_array of the body maps
+    body bodies[MAX_BODIES];
+    unsigned int body_count;
 } gl_data;
 
-typedef struct Image
-{
-    unsigned long sizeX;
-    unsigned long sizeY;
-    GLubyte *data;
-} image;
-
-static const char *filetobuf(const char *file)
-{
-    FILE *fptr;
-    long length;
-    char *buf;
-
-    fptr = fopen(file, "rb");
-    if (!fptr)
-        return NULL;
-    fseek(fptr, 0, SEEK_END);
-    length = ftell(fptr);
-    buf = (char *)malloc(length+1);
-    fseek(fptr, 0, SEEK_SET);
-    fread(buf, length, 1, fptr);
-    fclose(fptr);
-    buf[length] = 0;
-
-    return buf;
-}
-
-static GLuint ShaderLoad(const char *filename, GLenum shader_type)
-{
-    const GLchar *shaderSrc = filetobuf(filename);
-    GLuint shader = glCreateShader(shader_type);
-    glShaderSource(shader, 1, &shaderSrc, NULL);
-
-    // compile it
-    glCompileShader(shader);
-    GLint compiled = GL_FALSE;
-    glGetShaderiv(shader, GL_COMPILE_STATUS, &compiled);
-    if(!compiled)
-    {
-        // compilation failed - print error info
-        fprintf(stderr, "Compilation of shader %s failed:\n", filename);
-        GLint logLength = 0;
-        glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &logLength);
-
-        glDeleteShader(shader);
-        shader = 0;
-    }
-    return shader;
-}
-
-static GLuint ShaderProgLoad(const char *vert_filename,
-                             const char *frag_filename)
-{
-    GLuint vert_shader = ShaderLoad(vert_filename, GL_VERTEX_SHADER);
-    if(!vert_shader)
-    {
-        fprintf(stderr, "Couldn't load vertex shader: %s\n", vert_filename);
-        glDeleteShader(vert_shader);
-        vert_shader = 0;
-        return 0;
-    }
-
-    GLuint frag_shader = ShaderLoad(frag_filename, GL_FRAGMENT_SHADER);
-    if(!frag_shader)
-    {
-        fprintf(stderr, "Couldn't load fragment shader: %s\n", frag_filename);
-        glDeleteShader(frag_shader);
-        frag_shader = 0;
-        return 0;
-    }
-
-    GLuint shader_prog = glCreateProgram();
-    if(shader_prog)
-    {
-        glAttachShader(shader_prog, vert_shader);
-        glAttachShader(shader_prog, frag_shader);
-        glLinkProgram(shader_prog);
-        GLint linked = GL_FALSE;
-        glGetProgramiv(shader_prog, GL_LINK_STATUS, &linked);
-        if (!linked)
-        {
-            fprintf(stderr,
-                    "Linking shader failed (vert: %s, frag: %s\n",
-                    vert_filename,
-                    frag_filename);
-            GLint logLength = 0;
-            glGetProgramiv(shader_prog, GL_INFO_LOG_LENGTH, &logLength);
-
-            fprintf(stderr, "Couldn't get shader link log; out of memory\n");
-            glDeleteProgram(shader_prog);
-            shader_prog = 0;
-        }
-        glDetachShader(shader_prog, vert_shader);
-        glDetachShader(shader_prog, frag_shader);
-    }
-    else
-    {
-        fprintf(stderr, "Couldn't create shader program\n");
-    }
-
-    // don't need these any more
-    glDeleteShader(vert_shader);
-    glDeleteShader(frag_shader);
-    return shader_prog;
-}
-
+// the objects and every other CPU allocation of the scene
+static arena scene_arena;
+static mesh_pack meshes;
+// the bodies and their orbits, from textures/astro-pos.scene
+static scene sky;
+static asset_span mesh_file;
+// a body's colour map in tiles, when there's a .vt beside its map
+static vtex virtual_map;
+
+// Attribute layout of an object. With VAOs this is recorded once at load,
+// otherwise it is re-specified around every draw.
 static
-GLuint SetTexture(const char *texture_file)
+void object_attribs(const astro_object *gd)
 {
-    GLuint texture;
-    texture = 0;
-    glGenTextures(1, &texture);
-    glBindTexture(GL_TEXTURE_2D, texture); 
-    // set the texture wrapping parameters
-    // set texture wrapping to GL_REPEAT (default wrapping method)
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    // set texture filtering parameters
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-    // load image, create texture and generate mipmaps
-    int width, height, nrChannels;
-    unsigned char *data = stbi_load(texture_file,
-                                    &width,
-                                    &height,
-                                    &nrChannels,
-                                    STBI_rgb_alpha);
-
-    if (data)
-    {
-        glTexImage2D(GL_TEXTURE_2D,
-                     0,
-                     GL_RGBA,
-                     width,
-                     height,
-                     0,
-                     GL_RGBA,
-                     GL_UNSIGNED_BYTE,
-                     data);
-        glGenerateMipmap(GL_TEXTURE_3D);
-    }
-    else
+    unsigned int mask = (1u << gd->object_pos) | (1u << gd->object_texture);
+    unsigned int instance_mask = gd->instanced ? instance_attrib_mask() : 0;
+    if (gd->object_normal >= 0)
+        mask |= 1u << gd->object_normal;
+
+    gls_bind_buffer(GL_ARRAY_BUFFER, gd->vbo);
+    gls_bind_buffer(GL_ELEMENT_ARRAY_BUFFER, gd->ebo);
+    gls_vertex_attrib_arrays(mask | instance_mask);
+    if (caps.instancing)
+        gls_vertex_attrib_divisors(instance_mask);
+
+    GL_CALL(glVertexAttribPointer(gd->object_pos,
+                                  3,
+                                  GL_FLOAT,
+                                  GL_FALSE,
+                                  sizeof(astro_attributes),
+                                  (const GLvoid*)0));
+
+    GL_CALL(glVertexAttribPointer(gd->object_texture,
+                                  2,
+                                  GL_FLOAT,
+                                  GL_FALSE,
+                                  sizeof(astro_attributes),
+                                  (const GLvoid*)offsetof(astro_attributes,
+                                                          textures)));
+
+    if (gd->object_normal >= 0)
     {
-        fprintf(stderr, "Failed to load texture\n");
+        GL_CALL(glVertexAttribPointer(gd->object_normal,
+                                      3,
+                                      GL_FLOAT,
+                                      GL_FALSE,
+                                      sizeof(astro_attributes),
+                                      (const GLvoid*)offsetof(astro_attributes,
+                                                              normals)));
     }
 
-    if ((width & (width - 1)) != 0 || (height & (height - 1)) != 0)
-    {
-        fprintf(stderr,
-                "WARNING: texture %s is not power-of-2 dimensions\n",
-                texture_file);
-    }
-
-    stbi_image_free(data);
-    return texture;
-}
-
-static unsigned int getint(FILE *fp)
-{
-   unsigned int c, c1, c2, c3;
-   c  = ((unsigned int)getc(fp));  // get 4 bytes
-   c1 = ((unsigned int)getc(fp)) << 8;
-   c2 = ((unsigned int)getc(fp)) << 16;
-   c3 = ((unsigned int)getc(fp)) << 24;
-   return c | c1 | c2 | c3;
-}
-
-// ensure that little endian shorts are read into memory correctl
-// on big endian platforms
-static unsigned short getshort(FILE* fp)
-{
-   unsigned short c, c1;
-   // get 2 bytes
-   c  = ((unsigned short)getc(fp));
-   c1 = ((unsigned short)getc(fp)) << 8;
-   return c | c1;
+    if (gd->instanced)
+        instance_attribs(0);
 }
 
 static
-int ImageLoad(const char *filename, image* bmp_image)
+void object_vao(astro_object *gd)
 {
-   FILE *file;
-   unsigned long size;          // size of the image in bytes.
-   size_t i,j,k, linediff;        
-   unsigned short int planes;   // number of planes in image (must be 1)
-   unsigned short int bpp;      // number of bits per pixel (must be 24)
-   char temp;                   // temporary storage for bgr-rgb conversion.
-
-   // make sure the file is there
-   if ((file = fopen(filename, "rb"))==NULL) {
-      printf("File Not Found : %s\n",filename);
-      return -1;
-   }
-
-   // seek through the bmp header, up to the width/height
-   fseek(file, 18, SEEK_CUR);
-
-   // read the width
-   bmp_image->sizeX = getint (file);
-
-   // read the height
-   bmp_image->sizeY = getint (file);
-
-   // calculate the size (assuming 24 bits or 3 bytes per pixel)
-   // BMP lines are padded to the nearest double word boundary
-   size = 4.0*ceil(bmp_image->sizeX*24.0/32.0) * bmp_image->sizeY ;
-
-   // read the planes
-   planes = getshort(file);
-   if (planes != 1){
-      printf("Planes from %s is not 1: %u\n", filename, planes);
-      return -1;
-   }
-
-   // read the bpp
-   bpp = getshort(file);
-   if (bpp != 24) {
-      printf("Bpp from %s is not 24: %u\n", filename, bpp);
-      return 0;
-   }
-
-   // seek past the rest of the bitmap header
-   fseek(file, 24, SEEK_CUR);
-
-   // allocate space for the data
-   bmp_image->data = (GLubyte *) malloc(size * sizeof(GLubyte));
-   if (bmp_image->data == NULL) {
-      printf("Error allocating memory for color-corrected image data");
-      return -1;
-   }
-
-   // read the data
-   i = fread(bmp_image->data, size, 1, file);
-   if (i != 1) {
-      printf("Error reading image data from %s.\n", filename);
-      return -1;
-   }
-
-   // reverse all of the colors (bgr -> rgb)
-   // calculate distance to 4 byte boundary for each line
-   // if this distance is not 0, then there will be a color reversal error
-   // unless correction for the distance on each line
-   linediff = 4.0*ceil(bmp_image->sizeX*24.0/32.0) - bmp_image->sizeX*3.0;
-   k = 0;
-   for (j=0;j<bmp_image->sizeY;j++) {
-      for (i=0;i<bmp_image->sizeX;i++) {
-        temp = bmp_image->data[k];
-        bmp_image->data[k] = bmp_image->data[k+2];
-        bmp_image->data[k+2] = temp;
-        k+=3;
-      }
-      k+= linediff;
-   }
-
-   return 0;
-}
+    gd->vao = 0;
+    if (!caps.vao)
+        return;
 
-static
-GLuint SetBMPTexture(const char *texture_file)
-{
-    // load texture
-    image *image1 = (image *) malloc(sizeof(image));
-
-    // allocate space for texture
-    if (image1 == NULL) {
-       printf("Error allocating space for image");
-       exit(0);
-    }
- 
-    // load picture from file
-    if (ImageLoad(texture_file, image1) != 0) {
-       exit(1);
-    }
- 
-    GLuint texture;
-    texture = 0;
- 
-    // create texture name and bind it as current
-    glGenTextures(1, &texture);
-    glBindTexture(GL_TEXTURE_2D, texture); // 2d texture (x and y size)
- 
-    // set texture parameters
-    // scale linearly when image bigger than texture
-    glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_MAG_FILTER,GL_LINEAR);
-    // scale linearly when image smaller than texture
-    glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_MIN_FILTER,GL_LINEAR);
- 
-    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
-
-    glTexImage2D(GL_TEXTURE_2D,     // 2D texture
-         0,                         // level of detail 0 (normal)
-         3,                            // 3 color components
-         image1->sizeX,             // x size from image
-         image1->sizeY,             // y size from image
-         0,                            // border 0 (normal)
-         GL_RGB,                    // rgb color data order
-         GL_UNSIGNED_BYTE,          // color component types
-         image1->data               // image data itself
-       );
- 
-    return texture;
+    glGenVertexArrays(1, &gd->vao);
+    gls_bind_vertex_array(gd->vao);
+    object_attribs(gd);
 }
 
-static 
-void background(astro_object *gd)
+// With retain the object keeps a copy of the mesh in the scene arena, e.g.
+// to pick against; otherwise only the GPU has it. name is for the stats.
+static
+void upload_mesh(astro_object *gd,
+                 const char *name,
+                 const mesh_data *mesh,
+                 bool retain)
 {
-    glUseProgram(spc_shader_program);
-
-    const astro_attributes bg[] =
-    {
-        {{  1.0f,  1.0f, 0.0f }, { 1.0f, 1.0f }, { 0.0, 0.0, 0.0 }},
-        {{  1.0f, -1.0f, 0.0f }, { 1.0f, 0.0f }, { 0.0, 0.0, 0.0 }},
-        {{ -1.0f, -1.0f, 0.0f }, { 0.0f, 0.0f }, { 0.0, 0.0, 0.0 }},
-        {{ -1.0f,  1.0f, 0.0f }, { 0.0f, 1.0f }, { 0.0, 0.0, 0.0 }}
-    };
-
-    GLuint indices[6] = {0, 1, 2, 2, 3, 0};
+    gd->vertexes_size = mesh->vertex_count;
+    gd->indices_size = mesh->index_count;
+    gd->index_type = mesh->index_size == 2 ? GL_UNSIGNED_SHORT
+                                           : GL_UNSIGNED_INT;
 
     gd->vbo = 0;
     gd->ebo = 0;
     glGenBuffers(1, &gd->vbo);
     glGenBuffers(1, &gd->ebo);
 
-    glBindBuffer(GL_ARRAY_BUFFER, gd->vbo);
+    // the index binding would land in whichever VAO is bound
+    if (caps.vao)
+        gls_bind_vertex_array(0);
 
-    // copy the vertex data in, and deactivate
+    // copy the vertex data in
+    gls_bind_buffer(GL_ARRAY_BUFFER, gd->vbo);
     glBufferData(GL_ARRAY_BUFFER,
-                 sizeof(bg),
-                 bg,
+                 mesh->vertex_count * sizeof(astro_attributes),
+                 mesh->vertexes,
                  GL_STATIC_DRAW);
+    memstats_gl(MEM_BUFFER, gd->vbo, name,
+                mesh->vertex_count * sizeof(astro_attributes));
 
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, gd->ebo);
+    gls_bind_buffer(GL_ELEMENT_ARRAY_BUFFER, gd->ebo);
     glBufferData(GL_ELEMENT_ARRAY_BUFFER,
-                 6 * sizeof(GLuint),
-                 indices,
+                 mesh->index_count * mesh->index_size,
+                 mesh->indices,
                  GL_STATIC_DRAW);
+    memstats_gl(MEM_BUFFER, gd->ebo, name,
+                mesh->index_count * mesh->index_size);
+
+    if (retain)
+    {
+        size_t vertex_bytes = mesh->vertex_count * sizeof(astro_attributes);
+        size_t index_bytes = mesh->index_count * mesh->index_size;
+        void *vertexes = arena_alloc(&scene_arena, vertex_bytes, ARENA_MESHES);
+        void *indices = arena_alloc(&scene_arena, index_bytes, ARENA_MESHES);
+        memcpy(vertexes, mesh->vertexes, vertex_bytes);
+        memcpy(indices, mesh->indices, index_bytes);
+        gd->mesh = *mesh;
+        gd->mesh.vertexes = (const astro_attributes *) vertexes;
+        gd->mesh.indices = indices;
+    }
+}
 
-    gd->object_pos = glGetAttribLocation(spc_shader_program,
-                                         "vertex_position");
-    gd->object_texture = glGetAttribLocation(spc_shader_program,
-                                             "vertex_texture");
+static
+void background(astro_object *gd, bool retain)
+{
+    astro_attributes bg[MESH_QUAD_VERTEXES];
+    uint16_t indices[MESH_QUAD_INDICES];
+    mesh_data mesh;
+
+    if (mesh_pack_find(&meshes, "quad", &mesh) != 0)
+    {
+        mesh_build_quad(bg, indices);
+        mesh.vertexes = bg;
+        mesh.vertex_count = MESH_QUAD_VERTEXES;
+        mesh.indices = indices;
+        mesh.index_count = MESH_QUAD_INDICES;
+        mesh.index_size = sizeof(uint16_t);
+    }
+    upload_mesh(gd, "quad", &mesh, retain);
 
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    gd->object_pos = SHADER_ATTRIB_POSITION;
+    gd->object_texture = SHADER_ATTRIB_TEXTURE;
+    gd->object_normal = -1;
+    gd->instanced = false;
+    object_vao(gd);
 }
 
 void sphere(astro_object *gd,
-            float radius,
             unsigned int stacks,
             unsigned int sectors,
-            unsigned int offset)
+            bool retain)
 {
-    gd->vertexes_size = stacks * sectors * sizeof(astro_attributes);
-    astro_attributes vertexes[gd->vertexes_size];
-
-    float x, y, z, xy;                              // vertex position
-    float nx, ny, nz, length_inv = 1.0f / radius;   // normal
-    float s, t;                                     // texCoord
+    char name[MESH_NAME_LEN];
+    mesh_data mesh;
 
-    float sector_step = 2 * PI / sectors;
-    float stack_step = PI / stacks;
-    float sector_angle, stack_angle;
-
-    int count = 0;
-    for(int i = 0; i <= stacks; i++)
+    mesh_sphere_name(name, sizeof(name), stacks, sectors);
+    if (mesh_pack_find(&meshes, name, &mesh) == 0)
     {
-        stack_angle = PI / 2 - i * stack_step; // starting from pi/2 to -pi/2
-        xy = radius * cosf(stack_angle);       // r * cos(u)
-        z = radius * sinf(stack_angle);        // r * sin(u)
-
-        // add (sectorCount+1) vertices per stack
-        // the first and last vertices have same position and normal,
-        // but different tex coords
-        for(int j = 0; j <= sectors; j++)
-        {
-            sector_angle = j * sector_step;          // starting from 0 to 2pi
-
-            // vertex position
-            x = xy * cosf(sector_angle);             // r * cos(u) * cos(v)
-            y = xy * sinf(sector_angle);             // r * cos(u) * sin(v)
-            vertexes[count].positions[0] = x + offset;
-            vertexes[count].positions[1] = y;
-            vertexes[count].positions[2] = z + offset;
-
-            // vertex tex coord between [0, 1]
-            s = (float)j / sectors;
-            t = (float)i / stacks;
-
-            vertexes[count].textures[0] = s;
-            vertexes[count].textures[1] = t;
-
-            // normalized vertex normal
-            nx = x * length_inv;
-            ny = y * length_inv;
-            nz = z * length_inv;
-            vertexes[count].normals[0] = nx;
-            vertexes[count].normals[1] = ny;
-            vertexes[count].normals[2] = nz;
-
-            count++;
-        }
+        upload_mesh(gd, name, &mesh, retain);
     }
-
-    // generate the index array
-    gd->indices_size = ((stacks * sectors) - sectors) * 6;
-    gd->indices = (GLuint *) malloc(gd->indices_size * sizeof(GLuint));
-
-    unsigned int k1, k2;
-    count = 0;
-    for(int i = 0; i < stacks; i++)
+    else
     {
-        k1 = i * (sectors + 1);     // beginning of current stack
-        k2 = k1 + sectors + 1;      // beginning of next stack
-
-        for(int j = 0; j < sectors; j++, k1++, k2++)
-        {
-            // 2 triangles per sector excluding 1st and last stacks
-            if(i != 0)
-            {
-                // k1---k2---k1+1
-                gd->indices[count++] = k1;
-                gd->indices[count++] = k2;
-                gd->indices[count++] = k1+1;
-            }
-
-            if(i != (stacks-1))
-            {
-                // k1+1---k2---k2+1
-                gd->indices[count++] = k1+1;
-                gd->indices[count++] = k2;
-                gd->indices[count++] = k2+1;
-            }
-        }
+        // not baked; build it here, as scratch unless it is retained
+        mesh.vertex_count = mesh_sphere_vertex_count(stacks, sectors);
+        mesh.index_count = mesh_sphere_index_count(stacks, sectors);
+        mesh.index_size = mesh_index_size(mesh.vertex_count);
+
+        arena_mark mark = arena_save(&scene_arena);
+        arena_category category = retain ? ARENA_MESHES : ARENA_SCRATCH;
+        astro_attributes *vertexes = (astro_attributes *)
+            arena_alloc(&scene_arena,
+                        mesh.vertex_count * sizeof(astro_attributes),
+                        category);
+        void *indices = arena_alloc(&scene_arena,
+                                    mesh.index_count * mesh.index_size,
+                                    category);
+        mesh_build_sphere(vertexes, indices, mesh.index_size, stacks, sectors);
+        mesh.vertexes = vertexes;
+        mesh.indices = indices;
+
+        upload_mesh(gd, name, &mesh, false);
+        if (retain)
+            gd->mesh = mesh;
+        else
+            arena_rewind(&scene_arena, mark);
     }
 
-    gd->vbo = 0;
-    gd->ebo = 0;
-    glGenBuffers(1, &gd->vbo);
-    glGenBuffers(1, &gd->ebo);
-
-    glBindBuffer(GL_ARRAY_BUFFER, gd->vbo);
-
-    // copy the vertex data in, and deactivate
-    glBufferData(GL_ARRAY_BUFFER,
-                 sizeof(vertexes),
-                 vertexes,
-                 GL_STATIC_DRAW);
-
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, gd->ebo);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER,
-                 gd->indices_size * sizeof(GLuint),
-                 gd->indices,
-                 GL_STATIC_DRAW);
+    // the same for every variant of the body shaders
+    gd->object_pos = SHADER_ATTRIB_POSITION;
+    gd->object_texture = SHADER_ATTRIB_TEXTURE;
+    gd->object_normal = SHADER_ATTRIB_NORMAL;
+    gd->instanced = true;
+    object_vao(gd);
+}
 
-    gd->object_pos = glGetAttribLocation(obj_shader_program, "vertex_position");
-    gd->object_texture = glGetAttribLocation(obj_shader_program,
-                                             "vertex_texture");
-    gd->object_normal = glGetAttribLocation(obj_shader_program, "vertex_normal");
+void active_object(astro_object *gd)
+{
+    if (gd->vao)
+        gls_bind_vertex_array(gd->vao);
+    else
+        object_attribs(gd);
+}
 
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+// The sphere every body is drawn from.
+void planetoid(astro_object *gd,
+               unsigned int stacks,
+               unsigned int sectors,
+               bool retain)
+{
+    instance_init();
+    sphere(gd, stacks, sectors, retain);
 }
 
-void active_object(astro_object *gd)
+// Constant state of a new body shader variant.
+static
+void body_setup(program *prog, unsigned int features)
 {
-    glBindBuffer(GL_ARRAY_BUFFER, gd->vbo);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, gd->ebo);
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, gd->texture);
-
-    glEnableVertexAttribArray(gd->object_pos);
-    glEnableVertexAttribArray(gd->object_texture);
-    glEnableVertexAttribArray(gd->object_normal);
-
-    glVertexAttribPointer(gd->object_pos,
-                          3,
-                          GL_FLOAT,
-                          GL_FALSE,
-                          sizeof(astro_attributes),
-                          (const GLvoid*)0);
-
-    glVertexAttribPointer(gd->object_texture,
-                          2,
-                          GL_FLOAT,
-                          GL_FALSE,
-                          sizeof(astro_attributes),
-                          (const GLvoid*)offsetof(astro_attributes, textures));
-
-    glVertexAttribPointer(gd->object_normal,
-                          3,
-                          GL_FLOAT,
-                          GL_FALSE,
-                          sizeof(astro_attributes),
-                          (const GLvoid*)offsetof(astro_attributes, normals));
+    gls_use_program(prog->id);
+    glUniform1i(program_uniform(prog, "texture_sampler"), 0);
+    ubo_program(prog->id);
+    if (features & SHADER_VIRTUAL_TEXTURE)
+        vtex_program(&virtual_map, prog);
 }
 
-void active_background(astro_object *gd)
+static
+program *body_program(unsigned int features)
 {
-    glBindBuffer(GL_ARRAY_BUFFER, gd->vbo);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, gd->ebo);
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, gd->texture);
-
-    glEnableVertexAttribArray(gd->object_pos);
-    glEnableVertexAttribArray(gd->object_texture);
-
-    glVertexAttribPointer(gd->object_pos,
-                          3,
-                          GL_FLOAT,
-                          GL_FALSE,
-                          sizeof(astro_attributes),
-                          (const GLvoid*)0);
-
-    glVertexAttribPointer(gd->object_texture,
-                          2,
-                          GL_FLOAT,
-                          GL_FALSE,
-                          sizeof(astro_attributes),
-                          (const GLvoid*)offsetof(astro_attributes, textures));
+    return shader_variant(body_vert, body_frag, features, body_setup);
 }
 
-void inactive_object(astro_object *gd)
+static
+void spc_setup(program *prog, unsigned int features)
 {
-    glDisableVertexAttribArray(gd->object_pos);
-    glDisableVertexAttribArray(gd->object_texture);
-    glDisableVertexAttribArray(gd->object_normal);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    (void) features;
+    ubo_program(prog->id);
 }
 
-void inactive_background(astro_object *gd)
+// Start building the variants the scene starts with, far bodies' included.
+static
+void body_programs(const gl_data *gd)
 {
-    glDisableVertexAttribArray(gd->object_pos);
-    glDisableVertexAttribArray(gd->object_texture);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    shader_request(body_vert, body_frag, SHADER_NO_LIGHTING, body_setup);
+    for (unsigned int i = 0; i < gd->body_count; i++)
+        shader_request(body_vert,
+                       body_frag,
+                       gd->bodies[i].features,
+                       body_setup);
 }
 
-void planetoid(astro_object *gd,
-               float radius,
-               unsigned int stacks,
-               unsigned int sectors,
-               unsigned int offset)
+// Collect finished builds. If the uniform buffer shaders turn out not to
+// build, start over with the GLES2 ones, which need the atlas.
+static
+void check_programs(gl_data *gd)
 {
-    glUseProgram(obj_shader_program);
-    glUniform1i(glGetUniformLocation(obj_shader_program, "texture"), 0);
+    shader_poll();
 
-    mv_mat_loc = glGetUniformLocation(obj_shader_program, "mv_mat");
-    if (mv_mat_loc < 0)
+    if (spc_shader_program == NULL)
     {
-        fprintf(stderr, "ERROR: Couldn't get mv_mat's location.");
-        exit(EXIT_FAILURE);
+        if (shader_request(spc_vert, spc_frag, 0, spc_setup) == SHADER_FAILED)
+        {
+            fprintf(stderr, "Couldn't create a shader program.");
+            exit(EXIT_FAILURE);
+        }
+        spc_shader_program = shader_variant(spc_vert, spc_frag, 0, spc_setup);
     }
-    normal_mat_loc = glGetUniformLocation(obj_shader_program, "normal_mat");
-    if (normal_mat_loc < 0)
+
+    // a virtual texture variant that won't build is dropped for the map
+    for (unsigned int i = 0; i < gd->body_count; i++)
     {
-        fprintf(stderr, "ERROR: Couldn't get normal_mat's location.");
-        exit(EXIT_FAILURE);
+        body *b = &gd->bodies[i];
+        if ((b->features & SHADER_VIRTUAL_TEXTURE) &&
+            shader_request(body_vert,
+                           body_frag,
+                           b->features,
+                           body_setup) == SHADER_FAILED)
+        {
+            fprintf(stderr,
+                    "WARNING: virtual texture shaders failed, "
+                    "using the texture map\n");
+            b->features &= ~SHADER_VIRTUAL_TEXTURE;
+            shader_request(body_vert, body_frag, b->features, body_setup);
+            texres_unpin(vtex_bytes(&virtual_map));
+            vtex_close(&virtual_map);
+        }
     }
-    proj_mat_loc = glGetUniformLocation(obj_shader_program, "proj_mat");
-    if (proj_mat_loc < 0)
+
+    if (!caps.ubo)
+        return;
+    bool failed = shader_request(body_vert,
+                                 body_frag,
+                                 SHADER_NO_LIGHTING,
+                                 body_setup) == SHADER_FAILED;
+    for (unsigned int i = 0; i < gd->body_count; i++)
+        failed = failed || shader_request(body_vert,
+                                          body_frag,
+                                          gd->bodies[i].features,
+                                          body_setup) == SHADER_FAILED;
+    if (!failed)
+        return;
+
+    fprintf(stderr,
+            "WARNING: uniform buffer shaders failed, "
+            "using plain uniforms\n");
+    ubo_destroy();
+    caps.ubo = caps.texture_array = false;
+    body_vert = "textures/texture.vert";
+    body_frag = "textures/texture.frag";
+    body_programs(gd);
+
+    texres_reload(&gd->body_textures);
+    if (texres_wait(&gd->body_textures) != 0)
     {
-        fprintf(stderr, "ERROR: Couldn't get proj_mat's location.");
+        fprintf(stderr, "Couldn't load the body textures.");
         exit(EXIT_FAILURE);
     }
-    light_pos_loc = glGetUniformLocation(obj_shader_program, "light_position");
-    if (light_pos_loc < 0)
+}
+
+// Make the space texture and the body texture array as soon as the pool
+// has loaded their files, whichever comes first. Only their coarse levels
+// go up here; draw() streams in the rest.
+static
+void upload_textures(gl_data *gd)
+{
+    for (;;)
     {
-        fprintf(stderr, "ERROR: Couldn't get light_position's location.");
-        exit(EXIT_FAILURE);
+        unsigned int finished = pool_finished();
+        // an array, unless the uniform buffer shaders fail later and
+        // want the atlas instead
+        bool maps = texres_poll(&gd->body_textures);
+        bool space = texres_poll(&gd->space_texture);
+        if (gd->body_textures.failed)
+        {
+            fprintf(stderr, "Couldn't load the body textures.");
+            exit(EXIT_FAILURE);
+        }
+        if (maps && (space || gd->space_texture.failed))
+            return;
+        pool_wait_finished(finished);
     }
-    ambient_col_loc = glGetUniformLocation(obj_shader_program, "ambient_colour");
-    if (ambient_col_loc < 0)
+}
+
+// The layer of the body maps that file is, added if it's new.
+static
+int map_layer_of(const char *file, const char **maps, unsigned int *count)
+{
+    for (unsigned int i = 0; i < *count; i++)
+        if (strcmp(maps[i], file) == 0)
+            return (int) i;
+    if (*count == TEXARRAY_MAX_LAYERS)
     {
-        fprintf(stderr, "ERROR: Couldn't get ambient_colour's location.");
+        fprintf(stderr, "ERROR: Too many body maps.");
         exit(EXIT_FAILURE);
     }
-    diffuse_col_loc = glGetUniformLocation(obj_shader_program, "diffuse_colour");
-    if (diffuse_col_loc < 0)
+    maps[*count] = file;
+    return (int) (*count)++;
+}
+
+static
+void add_body(gl_data *gd,
+              unsigned int layer,
+              int night_layer,
+              unsigned int features,
+              float radius)
+{
+    if (gd->body_count == MAX_BODIES || gd->body_count == SIM_MAX_BODIES)
     {
-        fprintf(stderr, "ERROR: Couldn't get diffuse_colour's location.");
+        fprintf(stderr, "ERROR: Too many bodies.");
         exit(EXIT_FAILURE);
     }
 
-    sphere(gd, radius, stacks, sectors, offset);
+    body *b = &gd->bodies[gd->body_count++];
+    b->layer = layer;
+    b->night_layer = night_layer;
+    b->features = features;
+    b->radius = radius;
+}
+
+// The body where the simulation has it, in view space; the shader scales
+// the unit sphere by the radius.
+static
+void body_instance(const body *b,
+                   const rigid_batch *model_views,
+                   unsigned int i,
+                   instance_data *instance)
+{
+    rigid_batch_store(model_views, i, instance->model_view);
+    glm_vec4_copy((vec4){b->radius, b->layer, b->night_layer, 0.0f},
+                  instance->params);
+}
+
+// GLES2 path: what the Frame block carries otherwise. Uniforms belong to
+// a program, so this is done for each variant drawn, and only for the
+// uniforms its features use.
+static
+void set_frame_uniforms(const gl_data *gd,
+                        program *prog,
+                        unsigned int features,
+                        const frame_uniforms *frame)
+{
+    GL_CALL(glUniformMatrix4fv(program_uniform(prog, "proj_mat"),
+                               1,
+                               GL_FALSE,
+                               (GLfloat *) frame->proj_mat));
+    GL_CALL(glUniform3fv(program_uniform(prog, "ambient_colour"),
+                         1,
+                         (GLfloat *) frame->ambient_colour));
+    GL_CALL(glUniform1f(program_uniform(prog, "layer_scale"),
+                        texarray_layer_scale(&gd->body_textures.layers)));
+    if (features & SHADER_NO_LIGHTING)
+        return;
+
+    GL_CALL(glUniform3fv(program_uniform(prog, "light_position"),
+                         1,
+                         (GLfloat *) frame->light_position));
+    if (features & SHADER_ECLIPSE)
+        GL_CALL(glUniform4fv(program_uniform(prog, "occluders"),
+                             FRAME_MAX_OCCLUDERS,
+                             (GLfloat *) frame->occluders));
 }
 
 void draw(gl_data *gd)
@@ -658,89 +523,155 @@ void draw(gl_data *gd)
 
     glfwGetFramebufferSize(window, &width, &height);
  
-    glViewport(0, 0, width, height);
+    gls_viewport(0, 0, width, height);
 
-    glEnable(GL_DEPTH_TEST);
-    glDepthFunc(GL_LEQUAL);
-    glClearDepthf(1.0f);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-    glDisable(GL_DEPTH_TEST);
-    glUseProgram(spc_shader_program);
-    active_background(gd->space);
-    glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, (void *)0);
-    inactive_background(gd->space);
-    glUseProgram(0);
-    glEnable(GL_DEPTH_TEST);
-
-    glUseProgram(obj_shader_program);
-
-    mat4 model_mat = GLM_MAT4_IDENTITY_INIT;
-    float cam_pos_x = 0.0f;
-    float cam_pos_y = 0.0f;
-    float cam_pos_z = 150.0f;
-    mat4 view_mat = GLM_MAT4_IDENTITY_INIT;
-
-    float camX = sin(0.2*glfwGetTime()) * 100;
-    float camZ = cos(0.2*glfwGetTime()) * 100;
-    glm_lookat((vec3){camX, 0.0, camZ},
+    GL_CALL(glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT));
+
+    // draw whatever has its program already
+    check_programs(gd);
+    // and whatever levels of the textures are up, within the budget
+    texres_update();
+    texstream_update();
+
+    if (spc_shader_program)
+    {
+        gls_disable(GL_DEPTH_TEST);
+        gls_use_program(spc_shader_program->id);
+        active_object(gd->space);
+        gd->space->texture = texres_use(&gd->space_texture);
+        gls_bind_texture(GL_TEXTURE_2D, gd->space->texture);
+        GL_DRAW(glDrawElements(GL_TRIANGLES,
+                               gd->space->indices_size,
+                               gd->space->index_type,
+                               (void *)0));
+    }
+    gls_enable(GL_DEPTH_TEST);
+
+    // the simulation's latest, however far along it is
+    const sim_snapshot *snap = sim_acquire();
+    frame_uniforms frame;
+
+    vec3 eye;
+    memcpy(eye, snap->eye, sizeof(eye));
+    glm_lookat(eye,
                (vec3){0.0, 0.0, 0.0},
                (vec3){0.0, 1.0, 0.0},
-               view_mat);  
+               frame.view_mat);
 
-    mat4 proj_mat;
     glm_perspective(glm_rad(60.0f),
                     (float)DISP_WIDTH / (float)DISP_HEIGHT,
                     1.0f,
                     1000.f,
-                    proj_mat);
-
-    mat4 mv_mat;
-    glm_mul(view_mat, model_mat, mv_mat);
-    mat4 normal_mat;
-    glm_mat4_inv(mv_mat, normal_mat);
-    glUniformMatrix4fv(mv_mat_loc, 1, GL_FALSE, (GLfloat *) mv_mat);
-    glUniformMatrix4fv(normal_mat_loc, 1, GL_FALSE, (GLfloat *) normal_mat);
-    glUniformMatrix4fv(proj_mat_loc, 1, GL_FALSE, (GLfloat *) proj_mat);
-    glUniform3fv(light_pos_loc,
-                 1,
-                 (GLfloat *) (vec3) {cam_pos_x + 50.0f,
-                                     cam_pos_y + 80.0f,
-                                     cam_pos_z});
-    glUniform3fv(ambient_col_loc,
-                 1,
-                 (GLfloat *) (vec3) {0.85f, 0.85f, 0.85f});
-
-    // draw and animate
-    active_object(gd->earth);
-    mat4 rot_model_mat;
-    glm_rotate_x(model_mat, 90, rot_model_mat);
-
-    mat4 r_model_mat;
-    glm_mul(rot_model_mat, rot_model_mat, r_model_mat);
-    glm_mul(view_mat, r_model_mat, mv_mat);
-    glm_mat4_inv(mv_mat, normal_mat);
-    glUniformMatrix4fv(mv_mat_loc, 1, GL_FALSE, (GLfloat *) mv_mat);
-    glUniformMatrix4fv(normal_mat_loc, 1, GL_FALSE, (GLfloat *) normal_mat);
-    glDrawElements(GL_TRIANGLES,
-                   gd->earth->indices_size,
-                   GL_UNSIGNED_INT,
-                   (void *)0);
-    inactive_object(gd->earth);
-    
-    active_object(gd->moon);
-    glm_mul(model_mat, model_mat, r_model_mat);
-    glm_mul(view_mat, r_model_mat, mv_mat);
-    glm_mat4_inv(mv_mat, normal_mat);
-    glUniformMatrix4fv(mv_mat_loc, 1, GL_FALSE, (GLfloat *) mv_mat);
-    glUniformMatrix4fv(normal_mat_loc, 1, GL_FALSE, (GLfloat *) normal_mat);
-
-    glDrawElements(GL_TRIANGLES,
-                   gd->moon->indices_size,
-                   GL_UNSIGNED_INT,
-                   (void *)0);
-    inactive_object(gd->moon);
-        
+                    frame.proj_mat);
+
+    // fixed in view space, up and to the right of the eye
+    glm_vec4_copy((vec4){50.0f, 80.0f, 150.0f, 1.0f}, frame.light_position);
+    glm_vec4_copy((vec4){0.85f, 0.85f, 0.85f, 1.0f}, frame.ambient_colour);
+    // diffuse_colour has never been set here; keep the look for now
+    glm_vec4_zero(frame.diffuse_colour);
+    glm_vec4_copy((vec4){snap->time, 0.0f, 0.0f, 0.0f}, frame.time);
+
+    // every body into view space in one pass, rather than per vertex
+    static rigid_batch model_views;
+    rigid_batch_load(&model_views, snap->models, gd->body_count);
+    rigid_batch_compose(frame.view_mat, &model_views, &model_views);
+    instance_data placed[MAX_BODIES];
+    for (unsigned int i = 0; i < gd->body_count; i++)
+        body_instance(&gd->bodies[i], &model_views, i, &placed[i]);
+
+    // the first bodies the scene gives eclipses cast the shadows, from
+    // view space
+    memset(frame.occluders, 0, sizeof(frame.occluders));
+    unsigned int occluder_count = 0;
+    for (unsigned int i = 0;
+         i < gd->body_count && occluder_count < FRAME_MAX_OCCLUDERS;
+         i++)
+    {
+        if (!(sky.features[i] & SHADER_ECLIPSE))
+            continue;
+        glm_vec3_copy(placed[i].model_view[3],
+                      frame.occluders[occluder_count]);
+        frame.occluders[occluder_count++][3] = gd->bodies[i].radius;
+    }
+
+    if (caps.ubo)
+        ubo_frame(&frame);
+
+    // pick each body's shader variant; far bodies go unlit
+    program *variant[MAX_BODIES];
+    program *used[SHADER_MAX_VARIANTS];
+    unsigned int used_features[SHADER_MAX_VARIANTS];
+    unsigned int used_count = 0;
+    for (unsigned int i = 0; i < gd->body_count; i++)
+    {
+        const body *b = &gd->bodies[i];
+        unsigned int features = b->features;
+        if (b->radius < FAR_BODY_RATIO *
+                        glm_vec3_norm(placed[i].model_view[3]))
+            features = SHADER_NO_LIGHTING;
+
+        // until its own variant is ready, a body is drawn unlit
+        variant[i] = body_program(features);
+        if (variant[i] == NULL)
+        {
+            features = SHADER_NO_LIGHTING;
+            variant[i] = body_program(features);
+        }
+        if (variant[i] == NULL)
+            continue;
+
+        unsigned int u = 0;
+        while (u < used_count && used[u] != variant[i])
+            u++;
+        if (u == used_count)
+        {
+            used[used_count] = variant[i];
+            used_features[used_count++] = features;
+        }
+
+        if (features & SHADER_VIRTUAL_TEXTURE)
+            vtex_update(&virtual_map,
+                        placed[i].model_view,
+                        b->radius,
+                        frame.proj_mat,
+                        height);
+    }
+
+    // instances grouped by variant, one instanced draw per group
+    instance_data instances[MAX_BODIES];
+    unsigned int first[SHADER_MAX_VARIANTS + 1];
+    unsigned int count = 0;
+    for (unsigned int u = 0; u < used_count; u++)
+    {
+        first[u] = count;
+        for (unsigned int i = 0; i < gd->body_count; i++)
+            if (variant[i] == used[u])
+                instances[count++] = placed[i];
+    }
+    first[used_count] = count;
+    instance_upload(instances, count);
+
+    // the bodies wait for their maps to be made again after an eviction
+    GLuint body_texture = texres_use(&gd->body_textures);
+    if (body_texture == 0)
+        used_count = 0;
+    else
+        gls_bind_texture(gd->body_textures.layers.target, body_texture);
+    active_object(gd->sphere);
+    for (unsigned int u = 0; u < used_count; u++)
+    {
+        gls_use_program(used[u]->id);
+        if (!caps.ubo)
+            set_frame_uniforms(gd, used[u], used_features[u], &frame);
+
+        instance_draw(gd->sphere->indices_size,
+                      gd->sphere->index_type,
+                      first[u],
+                      first[u + 1] - first[u]);
+    }
+
+    glstats_frame_end();
+    memstats_poll();
     glfwSwapBuffers(window);
     glfwPollEvents();
 }
@@ -750,11 +681,24 @@ int main()
     if (!glfwInit())
         exit(EXIT_FAILURE);
 
+    #ifdef __EMSCRIPTEN__
+    // ask for WebGL2, and settle for WebGL1 where that's all there is
+    glfwWindowHint(GLFW_CLIENT_API, GLFW_OPENGL_ES_API);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
     window = glfwCreateWindow(DISP_WIDTH,
                               DISP_HEIGHT,
                               "Earth and Moon Rotation",
                               NULL,
                               NULL);
+    if (!window)
+        glfwDefaultWindowHints();
+    #endif
+    if (!window)
+        window = glfwCreateWindow(DISP_WIDTH,
+                                  DISP_HEIGHT,
+                                  "Earth and Moon Rotation",
+                                  NULL,
+                                  NULL);
     if (!window)
     {
         glfwTerminate();
@@ -770,39 +714,151 @@ int main()
     }
     #endif
 
-    // load the shader program and set it for use
-    spc_shader_program = ShaderProgLoad("textures/spc_texture.vert",
-                                        "textures/spc_texture.frag");
+    // every asset after this comes out of the pack, where there is one,
+    // and is counted from the start
+    memstats_init();
+    if (asset_pack_open("textures/astro-pos.pack") != 0)
+        fprintf(stderr,
+                "WARNING: no asset pack in textures/astro-pos.pack, "
+                "reading loose files\n");
+
+    glcaps_init();
+    gls_reset();
+    progcache_init();
+    texcache_init();
+    shader_init();
+
+    // what there is to draw, and where its maps are
+    static const scene_word features[] = {
+        { "eclipse", SHADER_ECLIPSE },
+        { "atmosphere", SHADER_ATMOSPHERE },
+        { NULL, 0 }
+    };
+    if (scene_load(&sky, "textures/astro-pos.scene", features) != 0)
+    {
+        glfwTerminate();
+        exit(EXIT_FAILURE);
+    }
 
-    if(!spc_shader_program)
+    // the texture files load on the pool while the GL setup goes on
+    static const char *body_maps[TEXARRAY_MAX_LAYERS];
+    static const char *const space_map[] = { "textures/space.jpg" };
+    unsigned int map_count = 0;
+    int map_layer[SCENE_MAX_NODES];
+    int night_layer[SCENE_MAX_NODES];
+    for (unsigned int i = 0; i < sky.count; i++)
     {
-        fprintf(stderr, "Couldn't create a shader program.");
-        return EXIT_FAILURE;
+        // night maps are optional, and so is the shader variant using them
+        map_layer[i] = map_layer_of(sky.map[i], body_maps, &map_count);
+        night_layer[i] = -1;
+        if (sky.night_map[i][0] && asset_exists(sky.night_map[i]))
+            night_layer[i] = map_layer_of(sky.night_map[i],
+                                          body_maps,
+                                          &map_count);
     }
+    gl_data gld;
+
+    pool_start();
+    // a BMP loads the same way, e.g. textures/earth2048.bmp as a body
+    // map, but the JPEG looks better
+    texres_init(&gld.space_texture, space_map[0], space_map, 1,
+                TEXLOAD_MIPS, false);
+    texres_init(&gld.body_textures, "body textures", body_maps, map_count,
+                0, true);
 
-    obj_shader_program = ShaderProgLoad("textures/texture.vert",
-                                        "textures/texture.frag");
+    // fixed state, set once
+    gls_active_texture(GL_TEXTURE0);
+    glDepthFunc(GL_LEQUAL);
+    glClearDepthf(1.0f);
 
-    if(!obj_shader_program)
+    // the Frame block binding is part of every program's setup
+    ubo_init();
+
+    // start building the shader programs; the driver works on them while
+    // the textures and meshes load
+    shader_request(spc_vert, spc_frag, 0, spc_setup);
+
+    // zeroed, and freed with the scene
+    arena_init(&scene_arena, "scene");
+    gld.space = (astro_object *) arena_alloc(&scene_arena, sizeof(astro_object),
+                                             ARENA_OBJECTS);
+    gld.sphere = (astro_object *) arena_alloc(&scene_arena, sizeof(astro_object),
+                                              ARENA_OBJECTS);
+    gld.body_count = 0;
+
+    // a body for each node, in the scene's order, which the simulation's
+    // models are in too
+    for (unsigned int i = 0; i < sky.count; i++)
+        add_body(&gld,
+                 (unsigned int) map_layer[i],
+                 night_layer[i],
+                 sky.features[i] |
+                 (night_layer[i] >= 0 ? SHADER_NIGHT_LIGHTS : 0),
+                 sky.radius[i]);
+    unsigned int eclipse_count = 0;
+    for (unsigned int i = 0; i < sky.count; i++)
+        if (sky.features[i] & SHADER_ECLIPSE)
+            eclipse_count++;
+    if (eclipse_count > FRAME_MAX_OCCLUDERS)
+        fprintf(stderr,
+                "WARNING: %u bodies cast eclipses, only the first %d do\n",
+                eclipse_count, FRAME_MAX_OCCLUDERS);
+    // a baked pyramid beside the first body's map that has one takes over
+    // its colour, past what fits in one texture; the texture map stays for
+    // the far away variant
+    for (unsigned int i = 0; i < sky.count; i++)
     {
-        fprintf(stderr, "Couldn't create a shader program.");
-        return EXIT_FAILURE;
+        char vt_name[SCENE_PATH_LEN];
+        const char *dot = strrchr(sky.map[i], '.');
+        size_t stem = dot ? (size_t) (dot - sky.map[i]) : strlen(sky.map[i]);
+        if (stem + sizeof(".vt") > sizeof(vt_name))
+            continue;
+        memcpy(vt_name, sky.map[i], stem);
+        strcpy(vt_name + stem, ".vt");
+        if (vtex_open(&virtual_map, vt_name) == 0)
+        {
+            gld.bodies[i].features |= SHADER_VIRTUAL_TEXTURE;
+            texres_pin(vtex_bytes(&virtual_map));
+            break;
+        }
     }
 
-    gl_data gld;
-
-    gld.space = (astro_object *) malloc(sizeof(astro_object));
-    gld.earth = (astro_object *) malloc(sizeof(astro_object));
-    gld.moon = (astro_object *) malloc(sizeof(astro_object));
+    body_programs(&gld);
 
-    gld.space->texture = SetTexture("textures/space.jpg");
-    gld.earth->texture = SetTexture("textures/earth.jpg");
-    // BMP texture, but JPG image looks better
-    //gld.earth->texture = SetBMPTexture("textures/earth2048.bmp");
-    gld.moon->texture = SetTexture("textures/moon.jpg");
-    background(gld.space);
-    planetoid(gld.earth, 30.0f, 72, 36, 0);
-    planetoid(gld.moon, 5.0f, 72, 36, 50);
+    // baked geometry; without it the meshes are generated at startup
+    if (asset_load("textures/astro-pos.mesh", &mesh_file) != 0 ||
+        mesh_pack_init(&meshes,
+                       mesh_file.data,
+                       mesh_file.size,
+                       "textures/astro-pos.mesh") != 0)
+    {
+        fprintf(stderr,
+                "WARNING: no baked meshes in textures/astro-pos.mesh, "
+                "generating them\n");
+    }
+    // nothing reads the meshes back, so only the GPU keeps them
+    background(gld.space, false);
+    planetoid(gld.sphere, 72, 36, false);
+    memset(&meshes, 0, sizeof(meshes));
+    asset_release(&mesh_file);
+
+    upload_textures(&gld);
+    // everything is on the GPU now, bar the finer texture levels
+    memset(&glstats, 0, sizeof(glstats));
+
+    // glfwGetTime() counts from glfwInit(); run twice to compare a cold
+    // start with a warm program cache
+    unsigned int pending = shader_poll();
+    fprintf(stderr,
+            "startup: %.1f ms, programs %.1f ms "
+            "(%u cached, %u compiled, %u pending)\n",
+            glfwGetTime() * 1000.0,
+            progstats.seconds * 1000.0,
+            progstats.hits,
+            progstats.misses,
+            pending);
+
+    sim_start(&sky);
 
     #ifdef __EMSCRIPTEN__
     emscripten_set_main_loop_arg((em_arg_callback_func) draw,
@@ -815,22 +871,32 @@ int main()
         draw(&gld);
     }
     #endif
+    sim_stop();
+    memstats_report();
 
-    glDeleteTextures(1, &gld.earth->texture);
-    glDeleteBuffers(1, &gld.earth->ebo);
-    glDeleteBuffers(1, &gld.earth->vbo);
-    free(gld.earth->indices);
-
-    glDeleteTextures(1, &gld.moon->texture);
-    glDeleteBuffers(1, &gld.moon->ebo);
-    glDeleteBuffers(1, &gld.moon->vbo);
-    free(gld.moon->indices);
+    if (caps.vao)
+    {
+        gls_delete_vertex_array(gld.space->vao);
+        gls_delete_vertex_array(gld.sphere->vao);
+    }
 
-    glDeleteProgram(obj_shader_program);
+    vtex_close(&virtual_map);
+    texres_destroy(&gld.space_texture);
+    texres_destroy(&gld.body_textures);
+    pool_stop();
+    asset_pack_close();
+    gls_delete_buffer(gld.space->ebo);
+    gls_delete_buffer(gld.space->vbo);
+    gls_delete_buffer(gld.sphere->ebo);
+    gls_delete_buffer(gld.sphere->vbo);
+
+    instance_destroy();
+    ubo_destroy();
+    shader_variants_destroy();
     glfwDestroyWindow(window);
 
-    free(gld.earth);
-    free(gld.moon);
+    arena_report(&scene_arena);
+    arena_destroy(&scene_arena);
 
     glfwTerminate();
 
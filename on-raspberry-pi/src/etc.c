@@ -0,0 +1,191 @@
+#include <string.h>
+#include <limits.h>
+
+#include "etc.h"
+
+// ETC1 intensity modifiers, a and b of each table; the four pixel indices
+// select +a, +b, -a and -b.
+static const int etc_modifiers[8][2] =
+{
+    {  2,   8 }, {  5,  17 }, {  9,  29 }, { 13,  42 },
+    { 18,  60 }, { 24,  80 }, { 33, 106 }, { 47, 183 },
+};
+
+static int clamp255(int v)
+{
+    return v < 0 ? 0 : v > 255 ? 255 : v;
+}
+
+// The table and indices that fit the 8 pixels of a half block best around
+// base.
+typedef struct EtcFit
+{
+    unsigned int table;
+    unsigned char index[8];
+    unsigned int error;
+} etc_fit;
+
+static void etc_fit_half(const unsigned char pixels[8][3],
+                         const int base[3],
+                         etc_fit *fit)
+{
+    fit->error = UINT_MAX;
+
+    for (unsigned int t = 0; t < 8; t++)
+    {
+        unsigned int error = 0;
+        unsigned char index[8];
+
+        for (int p = 0; p < 8; p++)
+        {
+            unsigned int best = UINT_MAX;
+            for (int i = 0; i < 4; i++)
+            {
+                int m = etc_modifiers[t][i & 1] * (i & 2 ? -1 : 1);
+                unsigned int e = 0;
+                for (int c = 0; c < 3; c++)
+                {
+                    int d = clamp255(base[c] + m) - pixels[p][c];
+                    e += d * d;
+                }
+                if (e < best)
+                {
+                    best = e;
+                    index[p] = i;
+                }
+            }
+            error += best;
+        }
+
+        if (error < fit->error)
+        {
+            fit->table = t;
+            fit->error = error;
+            memcpy(fit->index, index, sizeof(index));
+        }
+    }
+}
+
+// Encode a 4x4 block of RGB pixels, row by row. Both split directions and
+// both colour modes are tried around the halves' average colours.
+static void etc_block(const unsigned char block[16][3], unsigned char out[8])
+{
+    unsigned int best_error = UINT_MAX;
+    uint32_t best_hi = 0;
+    uint32_t best_lo = 0;
+
+    for (unsigned int flip = 0; flip < 2; flip++)
+    {
+        // half 0 is the left (or with flip, top) 2x4 pixels
+        unsigned char half[2][8][3];
+        unsigned char where[2][8];      // x * 4 + y, the index bit
+        int n[2] = { 0, 0 };
+        float avg[2][3] = { { 0, 0, 0 }, { 0, 0, 0 } };
+
+        for (int y = 0; y < 4; y++)
+        {
+            for (int x = 0; x < 4; x++)
+            {
+                int h = flip ? y >= 2 : x >= 2;
+                memcpy(half[h][n[h]], block[y * 4 + x], 3);
+                where[h][n[h]++] = x * 4 + y;
+                for (int c = 0; c < 3; c++)
+                    avg[h][c] += block[y * 4 + x][c] / 8.0f;
+            }
+        }
+
+        for (unsigned int diff = 0; diff < 2; diff++)
+        {
+            int q[2][3];
+            int base[2][3];
+            int levels = diff ? 31 : 15;
+
+            for (int h = 0; h < 2; h++)
+            {
+                for (int c = 0; c < 3; c++)
+                {
+                    q[h][c] = (int) (avg[h][c] * levels / 255.0f + 0.5f);
+                    base[h][c] = diff ? (q[h][c] << 3) | (q[h][c] >> 2)
+                                      : q[h][c] * 17;
+                }
+            }
+
+            // the second colour is stored as a 3-bit difference
+            if (diff &&
+                (q[1][0] - q[0][0] < -4 || q[1][0] - q[0][0] > 3 ||
+                 q[1][1] - q[0][1] < -4 || q[1][1] - q[0][1] > 3 ||
+                 q[1][2] - q[0][2] < -4 || q[1][2] - q[0][2] > 3))
+                continue;
+
+            etc_fit fit[2];
+            etc_fit_half(half[0], base[0], &fit[0]);
+            etc_fit_half(half[1], base[1], &fit[1]);
+            if (fit[0].error + fit[1].error >= best_error)
+                continue;
+            best_error = fit[0].error + fit[1].error;
+
+            if (diff)
+                best_hi = (uint32_t) q[0][0] << 27 |
+                          (uint32_t) ((q[1][0] - q[0][0]) & 7) << 24 |
+                          (uint32_t) q[0][1] << 19 |
+                          (uint32_t) ((q[1][1] - q[0][1]) & 7) << 16 |
+                          (uint32_t) q[0][2] << 11 |
+                          (uint32_t) ((q[1][2] - q[0][2]) & 7) << 8;
+            else
+                best_hi = (uint32_t) q[0][0] << 28 |
+                          (uint32_t) q[1][0] << 24 |
+                          (uint32_t) q[0][1] << 20 |
+                          (uint32_t) q[1][1] << 16 |
+                          (uint32_t) q[0][2] << 12 |
+                          (uint32_t) q[1][2] << 8;
+            best_hi |= fit[0].table << 5 | fit[1].table << 2 |
+                       diff << 1 | flip;
+
+            best_lo = 0;
+            for (int h = 0; h < 2; h++)
+            {
+                for (int p = 0; p < 8; p++)
+                {
+                    uint32_t i = fit[h].index[p];
+                    best_lo |= (i >> 1) << (16 + where[h][p]) |
+                               (i & 1) << where[h][p];
+                }
+            }
+        }
+    }
+
+    // big endian
+    for (int b = 0; b < 4; b++)
+    {
+        out[b] = best_hi >> (24 - 8 * b);
+        out[4 + b] = best_lo >> (24 - 8 * b);
+    }
+}
+
+void etc_encode(const unsigned char *pixels,
+                uint32_t width,
+                uint32_t height,
+                unsigned char *out)
+{
+    for (uint32_t by = 0; by < height; by += 4)
+    {
+        for (uint32_t bx = 0; bx < width; bx += 4)
+        {
+            // blocks over the edge repeat the last row and column
+            unsigned char block[16][3];
+            for (uint32_t y = 0; y < 4; y++)
+            {
+                uint32_t sy = by + y < height ? by + y : height - 1;
+                for (uint32_t x = 0; x < 4; x++)
+                {
+                    uint32_t sx = bx + x < width ? bx + x : width - 1;
+                    memcpy(block[y * 4 + x],
+                           &pixels[((size_t) sy * width + sx) * 4],
+                           3);
+                }
+            }
+            etc_block(block, out);
+            out += 8;
+        }
+    }
+}
@@ -0,0 +1,16 @@
+#ifndef ASTRO_ETC_H
+#define ASTRO_ETC_H
+
+#include <stdint.h>
+
+// ETC1 encoding, for the bakers and the texture cache. The blocks are valid
+// ETC2 RGB as well, which is what the files say they hold.
+
+// Encode the RGB of width x height RGBA8 pixels into 8 byte blocks, row by
+// row; blocks over the edge repeat the last row and column.
+void etc_encode(const unsigned char *pixels,
+                uint32_t width,
+                uint32_t height,
+                unsigned char *out);
+
+#endif
@@ -0,0 +1,333 @@
+#include <string.h>
+
+#include "glstate.h"
+#include "glstats.h"
+#include "memstats.h"
+
+#define GLS_UNKNOWN       0xffffffffu
+#define GLS_MAX_ATTRIBS   16
+#define GLS_UNIFORM_BINDINGS 4
+
+enum
+{
+    GLS_ARRAY_BUFFER,
+    GLS_ELEMENT_BUFFER,
+    GLS_UNIFORM_BUFFER,
+    GLS_BUFFER_TARGETS
+};
+enum { GLS_TEXTURE_2D, GLS_TEXTURE_2D_ARRAY, GLS_TEXTURE_TARGETS };
+enum { GLS_DEPTH_TEST, GLS_CULL_FACE, GLS_BLEND, GLS_CAPS };
+
+static struct
+{
+    GLuint program;
+    GLuint vao;
+    GLuint buffers[GLS_BUFFER_TARGETS];
+    struct
+    {
+        GLuint buffer;
+        GLintptr offset;
+        GLsizeiptr size;
+    } uniform_ranges[GLS_UNIFORM_BINDINGS];
+    GLenum active_unit;
+    GLuint textures[GLS_TEXTURE_UNITS][GLS_TEXTURE_TARGETS];
+    int enabled[GLS_CAPS];          // -1 while unknown
+    GLint viewport[4];
+    bool viewport_known;
+    unsigned int attribs;           // enabled arrays of VAO 0
+    bool attribs_known;
+    unsigned int divisors;          // per-instance arrays of VAO 0
+    bool divisors_known;
+} state;
+
+static int buffer_slot(GLenum target)
+{
+    switch (target)
+    {
+    case GL_ARRAY_BUFFER:         return GLS_ARRAY_BUFFER;
+    case GL_ELEMENT_ARRAY_BUFFER: return GLS_ELEMENT_BUFFER;
+    case GL_UNIFORM_BUFFER:       return GLS_UNIFORM_BUFFER;
+    default:                      return -1;
+    }
+}
+
+static int texture_slot(GLenum target)
+{
+    switch (target)
+    {
+    case GL_TEXTURE_2D:       return GLS_TEXTURE_2D;
+    case GL_TEXTURE_2D_ARRAY: return GLS_TEXTURE_2D_ARRAY;
+    default:                  return -1;
+    }
+}
+
+static int cap_slot(GLenum cap)
+{
+    switch (cap)
+    {
+    case GL_DEPTH_TEST: return GLS_DEPTH_TEST;
+    case GL_CULL_FACE:  return GLS_CULL_FACE;
+    case GL_BLEND:      return GLS_BLEND;
+    default:            return -1;
+    }
+}
+
+// true if the call has to go to the driver; updates the cached value
+static bool changed(GLuint *cached, GLuint value)
+{
+    if (*cached == value)
+    {
+        glstats.elided++;
+        return false;
+    }
+    *cached = value;
+    glstats.calls++;
+    return true;
+}
+
+void gls_reset(void)
+{
+    state.program = GLS_UNKNOWN;
+    // without VAO support everything happens on the default one
+    state.vao = caps.vao ? GLS_UNKNOWN : 0;
+    for (int i = 0; i < GLS_BUFFER_TARGETS; i++)
+        state.buffers[i] = GLS_UNKNOWN;
+    for (int i = 0; i < GLS_UNIFORM_BINDINGS; i++)
+        state.uniform_ranges[i].buffer = GLS_UNKNOWN;
+    state.active_unit = GLS_UNKNOWN;
+    for (int u = 0; u < GLS_TEXTURE_UNITS; u++)
+        for (int t = 0; t < GLS_TEXTURE_TARGETS; t++)
+            state.textures[u][t] = GLS_UNKNOWN;
+    for (int i = 0; i < GLS_CAPS; i++)
+        state.enabled[i] = -1;
+    state.viewport_known = false;
+    state.attribs_known = false;
+    state.divisors_known = false;
+}
+
+void gls_use_program(GLuint program)
+{
+    if (changed(&state.program, program))
+        glUseProgram(program);
+}
+
+void gls_bind_vertex_array(GLuint vao)
+{
+    if (changed(&state.vao, vao))
+    {
+        glBindVertexArray(vao);
+        state.buffers[GLS_ELEMENT_BUFFER] = GLS_UNKNOWN;
+    }
+}
+
+void gls_bind_buffer(GLenum target, GLuint buffer)
+{
+    int slot = buffer_slot(target);
+
+    if (slot < 0)
+    {
+        glstats.calls++;
+        glBindBuffer(target, buffer);
+    }
+    else if (changed(&state.buffers[slot], buffer))
+    {
+        glBindBuffer(target, buffer);
+    }
+}
+
+void gls_bind_buffer_range(GLenum target,
+                           GLuint index,
+                           GLuint buffer,
+                           GLintptr offset,
+                           GLsizeiptr size)
+{
+    if (target == GL_UNIFORM_BUFFER && index < GLS_UNIFORM_BINDINGS)
+    {
+        if (state.uniform_ranges[index].buffer == buffer &&
+            state.uniform_ranges[index].offset == offset &&
+            state.uniform_ranges[index].size == size)
+        {
+            glstats.elided++;
+            return;
+        }
+        state.uniform_ranges[index].buffer = buffer;
+        state.uniform_ranges[index].offset = offset;
+        state.uniform_ranges[index].size = size;
+    }
+
+    // binding a range also binds the buffer to the generic binding point
+    int slot = buffer_slot(target);
+    if (slot >= 0)
+        state.buffers[slot] = buffer;
+
+    glstats.calls++;
+    glBindBufferRange(target, index, buffer, offset, size);
+}
+
+void gls_active_texture(GLenum unit)
+{
+    if (changed(&state.active_unit, unit))
+        glActiveTexture(unit);
+}
+
+void gls_bind_texture(GLenum target, GLuint texture)
+{
+    int slot = texture_slot(target);
+    GLuint unit = state.active_unit - GL_TEXTURE0;
+
+    if (slot < 0 || state.active_unit == GLS_UNKNOWN ||
+        unit >= GLS_TEXTURE_UNITS)
+    {
+        glstats.calls++;
+        glBindTexture(target, texture);
+    }
+    else if (changed(&state.textures[unit][slot], texture))
+    {
+        glBindTexture(target, texture);
+    }
+}
+
+static void set_cap(GLenum cap, int enable)
+{
+    int slot = cap_slot(cap);
+
+    if (slot >= 0 && state.enabled[slot] == enable)
+    {
+        glstats.elided++;
+        return;
+    }
+    if (slot >= 0)
+        state.enabled[slot] = enable;
+
+    glstats.calls++;
+    if (enable)
+        glEnable(cap);
+    else
+        glDisable(cap);
+}
+
+void gls_enable(GLenum cap)
+{
+    set_cap(cap, 1);
+}
+
+void gls_disable(GLenum cap)
+{
+    set_cap(cap, 0);
+}
+
+void gls_viewport(GLint x, GLint y, GLsizei width, GLsizei height)
+{
+    GLint vp[4] = { x, y, width, height };
+
+    if (state.viewport_known && memcmp(vp, state.viewport, sizeof(vp)) == 0)
+    {
+        glstats.elided++;
+        return;
+    }
+    memcpy(state.viewport, vp, sizeof(vp));
+    state.viewport_known = true;
+    glstats.calls++;
+    glViewport(x, y, width, height);
+}
+
+void gls_vertex_attrib_arrays(unsigned int mask)
+{
+    // only VAO 0 is tracked; on any other the arrays are being recorded
+    // into a fresh VAO, where everything starts out disabled
+    bool tracked = state.vao == 0;
+    unsigned int current = !tracked            ? 0
+                         : state.attribs_known ? state.attribs
+                                               : ~mask;
+
+    for (GLuint i = 0; i < GLS_MAX_ATTRIBS; i++)
+    {
+        unsigned int bit = 1u << i;
+
+        if ((mask & bit) == (current & bit))
+        {
+            if (mask & bit)
+                glstats.elided++;
+            continue;
+        }
+        glstats.calls++;
+        if (mask & bit)
+            glEnableVertexAttribArray(i);
+        else
+            glDisableVertexAttribArray(i);
+    }
+
+    if (tracked)
+    {
+        state.attribs = mask;
+        state.attribs_known = true;
+    }
+}
+
+void gls_vertex_attrib_divisors(unsigned int mask)
+{
+    // as above, a VAO being recorded starts with every divisor at 0
+    bool tracked = state.vao == 0;
+    unsigned int current = !tracked             ? 0
+                         : state.divisors_known ? state.divisors
+                                                : ~mask;
+
+    for (GLuint i = 0; i < GLS_MAX_ATTRIBS; i++)
+    {
+        unsigned int bit = 1u << i;
+
+        if ((mask & bit) == (current & bit))
+        {
+            if (mask & bit)
+                glstats.elided++;
+            continue;
+        }
+        glstats.calls++;
+        glcaps_vertex_attrib_divisor(i, (mask & bit) ? 1 : 0);
+    }
+
+    if (tracked)
+    {
+        state.divisors = mask;
+        state.divisors_known = true;
+    }
+}
+
+void gls_delete_program(GLuint program)
+{
+    // a deleted program stays in use until replaced, so keep the cache
+    glDeleteProgram(program);
+}
+
+void gls_delete_vertex_array(GLuint vao)
+{
+    // the element buffer binding is the VAO's, and reverts with VAO 0
+    if (state.vao == vao)
+    {
+        state.vao = 0;
+        state.buffers[GLS_ELEMENT_BUFFER] = GLS_UNKNOWN;
+    }
+    glDeleteVertexArrays(1, &vao);
+}
+
+void gls_delete_buffer(GLuint buffer)
+{
+    for (int i = 0; i < GLS_BUFFER_TARGETS; i++)
+        if (state.buffers[i] == buffer)
+            state.buffers[i] = 0;
+    for (int i = 0; i < GLS_UNIFORM_BINDINGS; i++)
+        if (state.uniform_ranges[i].buffer == buffer)
+            state.uniform_ranges[i].buffer = 0;
+    memstats_gl_delete(MEM_BUFFER, buffer);
+    glDeleteBuffers(1, &buffer);
+}
+
+void gls_delete_texture(GLuint texture)
+{
+    for (int u = 0; u < GLS_TEXTURE_UNITS; u++)
+        for (int t = 0; t < GLS_TEXTURE_TARGETS; t++)
+            if (state.textures[u][t] == texture)
+                state.textures[u][t] = 0;
+    memstats_gl_delete(MEM_TEXTURE, texture);
+    glDeleteTextures(1, &texture);
+}
@@ -0,0 +1,37 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "glstats.h"
+
+gl_stats glstats;
+
+void glstats_frame_end(void)
+{
+    static int enabled = -1;
+
+    if (enabled < 0)
+        enabled = getenv("ASTRO_GL_STATS") != NULL;
+
+    glstats.total_calls += glstats.calls;
+    glstats.total_draws += glstats.draws;
+    glstats.total_elided += glstats.elided;
+    glstats.calls = 0;
+    glstats.draws = 0;
+    glstats.elided = 0;
+
+    if (++glstats.frames < GL_STATS_INTERVAL)
+        return;
+
+    if (enabled)
+    {
+        fprintf(stderr,
+                "gl: %.1f calls/frame, %.1f draws/frame, %.1f elided/frame\n",
+                (double) glstats.total_calls / glstats.frames,
+                (double) glstats.total_draws / glstats.frames,
+                (double) glstats.total_elided / glstats.frames);
+    }
+    glstats.total_calls = 0;
+    glstats.total_draws = 0;
+    glstats.total_elided = 0;
+    glstats.frames = 0;
+}
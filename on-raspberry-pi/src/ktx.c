@@ -0,0 +1,247 @@
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "ktx.h"
+
+size_t ktx_level_size(uint32_t vk_format, uint32_t width, uint32_t height)
+{
+    // in 64 bits, as a header's sizes overflow a 32 bit size_t: texels or
+    // blocks, which fit, then checked before the bytes of each
+    uint64_t units;
+    uint64_t unit_bytes;
+    switch (vk_format)
+    {
+    case KTX_VK_FORMAT_R8G8B8A8_UNORM:
+        units = (uint64_t) width * height;
+        unit_bytes = 4;
+        break;
+    case KTX_VK_FORMAT_ETC2_R8G8B8_UNORM:
+        units = ((uint64_t) width + 3) / 4 * (((uint64_t) height + 3) / 4);
+        unit_bytes = 8;
+        break;
+    default:
+        return 0;
+    }
+    return units > SIZE_MAX / unit_bytes ? 0 : (size_t) (units * unit_bytes);
+}
+
+uint32_t ktx_level_alignment(uint32_t vk_format)
+{
+    return vk_format == KTX_VK_FORMAT_ETC2_R8G8B8_UNORM ? 8 : 4;
+}
+
+static uint32_t level_dimension(uint32_t size, unsigned int level)
+{
+    size >>= level;
+    return size ? size : 1;
+}
+
+unsigned int ktx_chain_length(uint32_t width, uint32_t height)
+{
+    unsigned int levels = 1;
+
+    while (width > 1 || height > 1)
+    {
+        width /= 2;
+        height /= 2;
+        levels++;
+    }
+    return levels;
+}
+
+static int ktx_validate(ktx_file *ktx, const char *filename)
+{
+    const ktx_header *hdr = (const ktx_header *) ktx->base;
+
+    if (ktx->size < sizeof(*hdr) ||
+        memcmp(hdr->identifier, KTX_IDENTIFIER, KTX_IDENTIFIER_LEN) != 0)
+    {
+        fprintf(stderr, "Bad KTX2 file %s\n", filename);
+        return -1;
+    }
+    if (hdr->pixel_width == 0 || hdr->pixel_height == 0 ||
+        hdr->pixel_depth != 0 || hdr->layer_count != 0 ||
+        hdr->face_count != 1 || hdr->supercompression_scheme != 0 ||
+        hdr->level_count == 0 || hdr->level_count > KTX_MAX_LEVELS ||
+        ktx_level_size(hdr->vk_format, 1, 1) == 0)
+    {
+        fprintf(stderr, "Unsupported KTX2 file %s\n", filename);
+        return -1;
+    }
+
+    size_t index_end = sizeof(*hdr) +
+                       hdr->level_count * sizeof(ktx_level_index);
+    if (index_end > ktx->size)
+    {
+        fprintf(stderr, "Truncated KTX2 file %s\n", filename);
+        return -1;
+    }
+
+    const ktx_level_index *levels =
+        (const ktx_level_index *) (ktx->base + sizeof(*hdr));
+    for (uint32_t l = 0; l < hdr->level_count; l++)
+    {
+        size_t expected =
+            ktx_level_size(hdr->vk_format,
+                           level_dimension(hdr->pixel_width, l),
+                           level_dimension(hdr->pixel_height, l));
+        if (expected == 0 || levels[l].length != expected ||
+            levels[l].offset % ktx_level_alignment(hdr->vk_format) != 0 ||
+            levels[l].offset > ktx->size ||
+            levels[l].length > ktx->size - levels[l].offset)
+        {
+            fprintf(stderr, "Bad level %u in KTX2 file %s\n", l, filename);
+            return -1;
+        }
+    }
+
+    ktx->header = hdr;
+    ktx->levels = levels;
+    return 0;
+}
+
+int ktx_init(ktx_file *ktx, const void *data, size_t size, const char *name)
+{
+    memset(ktx, 0, sizeof(*ktx));
+    ktx->base = (const unsigned char *) data;
+    ktx->size = size;
+
+    if (ktx_validate(ktx, name) != 0)
+    {
+        memset(ktx, 0, sizeof(*ktx));
+        return -1;
+    }
+    return 0;
+}
+
+void ktx_level_get(const ktx_file *ktx, unsigned int level, ktx_level *out)
+{
+    out->data = ktx->base + ktx->levels[level].offset;
+    out->size = ktx->levels[level].length;
+    out->width = level_dimension(ktx->header->pixel_width, level);
+    out->height = level_dimension(ktx->header->pixel_height, level);
+}
+
+// Data format descriptor of the two formats: colour model, block size in
+// texels and bytes, then the samples.
+static size_t dfd(uint32_t vk_format, uint32_t *words)
+{
+    bool etc2 = vk_format == KTX_VK_FORMAT_ETC2_R8G8B8_UNORM;
+    uint32_t samples = etc2 ? 1 : 4;
+    uint32_t block_size = 24 + 16 * samples;
+
+    words[0] = 4 + block_size;                  // dfdTotalSize
+    words[1] = 0;                               // Khronos, basic format
+    words[2] = 2 | block_size << 16;            // version 1.3
+    // model (RGBSDA or ETC2), BT.709 primaries, linear transfer; the GL
+    // textures are not sRGB either
+    words[3] = (etc2 ? 161 : 1) | 1 << 8 | 1 << 16;
+    words[4] = etc2 ? 3 | 3 << 8 : 0;           // block size minus one
+    words[5] = etc2 ? 8 : 4;                    // bytes per block
+    words[6] = 0;
+
+    if (etc2)
+    {
+        // all 64 bits are ETC2 colour
+        words[7] = 0 | 63 << 16 | 2 << 24;
+        words[8] = 0;
+        words[9] = 0;
+        words[10] = 0xffffffffu;
+    }
+    else
+    {
+        // R, G, B and alpha (15) bytes
+        static const uint32_t channels[4] = { 0, 1, 2, 15 };
+        for (uint32_t s = 0; s < 4; s++)
+        {
+            words[7 + s * 4] = s * 8 | 7 << 16 | channels[s] << 24;
+            words[8 + s * 4] = 0;
+            words[9 + s * 4] = 0;
+            words[10 + s * 4] = 255;
+        }
+    }
+    return words[0];
+}
+
+static uint32_t align_up(uint32_t offset, uint32_t align)
+{
+    return (offset + align - 1) / align * align;
+}
+
+static int write_at(FILE *fp, uint32_t offset, const void *data, size_t size)
+{
+    if (fseek(fp, offset, SEEK_SET) != 0)
+        return -1;
+    return fwrite(data, size, 1, fp) == 1 || size == 0 ? 0 : -1;
+}
+
+int ktx_write(const char *path,
+              uint32_t vk_format,
+              uint32_t width,
+              uint32_t height,
+              unsigned int levels,
+              const void *const *data,
+              const char *writer)
+{
+    if (levels == 0 || levels > KTX_MAX_LEVELS ||
+        ktx_level_size(vk_format, 1, 1) == 0)
+        return -1;
+
+    ktx_header hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.identifier, KTX_IDENTIFIER, KTX_IDENTIFIER_LEN);
+    hdr.vk_format = vk_format;
+    hdr.type_size = 1;
+    hdr.pixel_width = width;
+    hdr.pixel_height = height;
+    hdr.face_count = 1;
+    hdr.level_count = levels;
+
+    uint32_t dfd_words[4 + 7 + 16];
+    char kvd[64];
+    uint32_t kvd_entry = (uint32_t) snprintf(kvd, sizeof(kvd), "KTXwriter%c%s",
+                                             '\0', writer) + 1;
+    if (kvd_entry > sizeof(kvd))
+        kvd_entry = sizeof(kvd);
+
+    hdr.dfd_offset = sizeof(hdr) + levels * sizeof(ktx_level_index);
+    hdr.dfd_length = dfd(vk_format, dfd_words);
+    hdr.kvd_offset = hdr.dfd_offset + hdr.dfd_length;
+    hdr.kvd_length = align_up(4 + kvd_entry, 4);
+
+    // level data goes smallest first, after everything else
+    ktx_level_index index[KTX_MAX_LEVELS];
+    uint32_t offset = hdr.kvd_offset + hdr.kvd_length;
+    uint32_t align = ktx_level_alignment(vk_format);
+    for (int l = levels - 1; l >= 0; l--)
+    {
+        offset = align_up(offset, align);
+        index[l].offset = offset;
+        index[l].length = ktx_level_size(vk_format,
+                                         level_dimension(width, l),
+                                         level_dimension(height, l));
+        index[l].uncompressed_length = index[l].length;
+        offset += index[l].length;
+    }
+
+    FILE *fp = fopen(path, "wb");
+    if (fp == NULL)
+        return -1;
+
+    int err = write_at(fp, 0, &hdr, sizeof(hdr));
+    err |= write_at(fp, sizeof(hdr), index,
+                    levels * sizeof(ktx_level_index));
+    err |= write_at(fp, hdr.dfd_offset, dfd_words, hdr.dfd_length);
+    err |= write_at(fp, hdr.kvd_offset, &kvd_entry, 4);
+    err |= write_at(fp, hdr.kvd_offset + 4, kvd, kvd_entry);
+    for (unsigned int l = 0; l < levels && err == 0; l++)
+        err |= write_at(fp, index[l].offset, data[l], index[l].length);
+
+    if (fclose(fp) != 0 || err != 0)
+    {
+        remove(path);
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,99 @@
+#ifndef ASTRO_KTX_H
+#define ASTRO_KTX_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// The subset of KTX2 that texbake and the texture cache write and astro-pos
+// reads: one 2D image
+// (no layers, faces or depth), no supercompression, with its mip chain.
+//
+//   ktx_header
+//   ktx_level_index[level_count]     level 0, the largest, first
+//   data format descriptor, key/value data
+//   level data, smallest level first, each aligned to its format's
+//   ktx_level_alignment()
+//
+// Formats are Vulkan ones, as KTX2 has them: ETC2 RGB for GLES3 / WebGL2 and
+// the Pi, RGBA8 where there is no ETC2.
+#define KTX_IDENTIFIER      "\xabKTX 20\xbb\r\n\x1a\n"
+#define KTX_IDENTIFIER_LEN  12
+#define KTX_MAX_LEVELS      16
+
+#define KTX_VK_FORMAT_R8G8B8A8_UNORM        37
+#define KTX_VK_FORMAT_ETC2_R8G8B8_UNORM     147
+
+typedef struct KtxHeader
+{
+    unsigned char identifier[KTX_IDENTIFIER_LEN];
+    uint32_t vk_format;
+    uint32_t type_size;
+    uint32_t pixel_width;
+    uint32_t pixel_height;
+    uint32_t pixel_depth;
+    uint32_t layer_count;
+    uint32_t face_count;
+    uint32_t level_count;
+    uint32_t supercompression_scheme;
+    uint32_t dfd_offset;
+    uint32_t dfd_length;
+    uint32_t kvd_offset;
+    uint32_t kvd_length;
+    uint64_t sgd_offset;
+    uint64_t sgd_length;
+} ktx_header;
+
+typedef struct KtxLevelIndex
+{
+    uint64_t offset;
+    uint64_t length;
+    uint64_t uncompressed_length;
+} ktx_level_index;
+
+// A KTX2 file in memory, owned by the caller.
+typedef struct KtxFile
+{
+    const unsigned char *base;
+    size_t size;
+    const ktx_header *header;
+    const ktx_level_index *levels;
+} ktx_file;
+
+// One mip level, pointing into the file.
+typedef struct KtxLevel
+{
+    const void *data;
+    size_t size;
+    uint32_t width;
+    uint32_t height;
+} ktx_level;
+
+// Bytes of a width x height level of vk_format; 0 for other formats, and
+// for a level too large to hold in memory.
+size_t ktx_level_size(uint32_t vk_format, uint32_t width, uint32_t height);
+
+// Alignment of level data: the lcm of the format's block size and 4.
+uint32_t ktx_level_alignment(uint32_t vk_format);
+
+// Levels from width x height down to 1 x 1.
+unsigned int ktx_chain_length(uint32_t width, uint32_t height);
+
+// Take the size bytes at data, which stay the caller's, as a KTX2 file.
+// Returns 0 on success, -1 if they aren't one this reader takes, in which
+// case ktx is left empty. name is for the messages.
+int ktx_init(ktx_file *ktx, const void *data, size_t size, const char *name);
+
+void ktx_level_get(const ktx_file *ktx, unsigned int level, ktx_level *out);
+
+// Write a width x height image of vk_format with levels mip levels to path,
+// level l from data[l], ktx_level_size() bytes of it. writer names the
+// program in the file. Returns -1, with nothing left at path, on failure.
+int ktx_write(const char *path,
+              uint32_t vk_format,
+              uint32_t width,
+              uint32_t height,
+              unsigned int levels,
+              const void *const *data,
+              const char *writer);
+
+#endif
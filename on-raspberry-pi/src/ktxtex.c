@@ -0,0 +1,122 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ktxtex.h"
+#include "texture.h"
+#include "glstate.h"
+
+// image_file with its extension replaced by suffix
+static void ktx_path(char *path,
+                     size_t size,
+                     const char *image_file,
+                     const char *suffix)
+{
+    const char *dot = strrchr(image_file, '.');
+    const char *slash = strrchr(image_file, '/');
+    int stem = dot && (!slash || dot > slash) ? (int) (dot - image_file)
+                                              : (int) strlen(image_file);
+
+    snprintf(path, size, "%.*s%s", stem, image_file, suffix);
+}
+
+// The KTX2 file at path, if there is one and it's good.
+static int open_file(ktx_file *ktx, asset_span *file, const char *path)
+{
+    if (asset_load(path, file) != 0)
+        return -1;
+    if (ktx_init(ktx, file->data, file->size, path) != 0)
+    {
+        asset_release(file);
+        return -1;
+    }
+    return 0;
+}
+
+int ktxtex_open(ktx_file *ktx, asset_span *file, const char *image_file)
+{
+    char path[256];
+
+    if (caps.etc2)
+    {
+        ktx_path(path, sizeof(path), image_file, ".etc2.ktx2");
+        if (open_file(ktx, file, path) == 0)
+            return 0;
+    }
+    ktx_path(path, sizeof(path), image_file, ".rgba.ktx2");
+    return open_file(ktx, file, path);
+}
+
+void ktxtex_image_2d(GLenum target,
+                     GLint gl_level,
+                     const ktx_file *ktx,
+                     const ktx_level *level)
+{
+    if (ktx->header->vk_format == KTX_VK_FORMAT_ETC2_R8G8B8_UNORM)
+        glCompressedTexImage2D(target, gl_level, GL_COMPRESSED_RGB8_ETC2,
+                               level->width, level->height, 0,
+                               level->size, level->data);
+    else
+        glTexImage2D(target, gl_level, GL_RGBA,
+                     level->width, level->height, 0,
+                     GL_RGBA, GL_UNSIGNED_BYTE, level->data);
+}
+
+GLuint ktxtex_create(const ktx_file *ktx,
+                     unsigned int drop,
+                     tex_stream *ts,
+                     const char *name)
+{
+    const ktx_header *hdr = ktx->header;
+    // mipmapping needs the whole chain, down to 1 x 1
+    unsigned int levels = 1;
+    if (hdr->level_count == ktx_chain_length(hdr->pixel_width,
+                                             hdr->pixel_height) &&
+        texture_mipmappable(hdr->pixel_width, hdr->pixel_height))
+        levels = hdr->level_count;
+    if (drop >= levels)
+        drop = levels - 1;
+    levels -= drop;
+
+    GLuint texture = 0;
+    glGenTextures(1, &texture);
+    gls_bind_texture(GL_TEXTURE_2D, texture);
+    // WebGL1 only repeats power of two sizes
+    GLint wrap = texture_mipmappable(hdr->pixel_width, hdr->pixel_height)
+                 ? GL_REPEAT : GL_CLAMP_TO_EDGE;
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrap);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, wrap);
+    texture_filter(GL_TEXTURE_2D, levels);
+
+    // storage first; the data goes up with the stream
+    bool etc2 = hdr->vk_format == KTX_VK_FORMAT_ETC2_R8G8B8_UNORM;
+    ktx_level top;
+    ktx_level_get(ktx, drop, &top);
+    texstream_init(ts, name, texture, GL_TEXTURE_2D,
+                   etc2 ? GL_COMPRESSED_RGB8_ETC2 : GL_RGBA,
+                   top.width, top.height, levels, 1);
+    for (unsigned int l = 0; l < levels; l++)
+    {
+        ktx_level level;
+        ktx_level_get(ktx, drop + l, &level);
+        texstream_source(ts, 0, l, level.data);
+        level.data = NULL;
+        ktxtex_image_2d(GL_TEXTURE_2D, l, ktx, &level);
+    }
+    return texture;
+}
+
+GLuint ktxtex_load(const char *image_file)
+{
+    ktx_file ktx;
+    asset_span file;
+    if (ktxtex_open(&ktx, &file, image_file) != 0)
+        return 0;
+
+    tex_stream ts;
+    GLuint texture = ktxtex_create(&ktx, 0, &ts, image_file);
+    texstream_start(&ts, NULL, 0);
+    texstream_finish(&ts);
+    asset_release(&file);
+    return texture;
+}
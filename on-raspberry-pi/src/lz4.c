@@ -0,0 +1,165 @@
+#include <stdint.h>
+#include <string.h>
+
+#include "lz4.h"
+
+#define MIN_MATCH       4
+#define LAST_LITERALS   5       // the block ends with at least these
+#define MATCH_LIMIT     12      // no match starts closer to the end
+#define MAX_OFFSET      65535
+#define HASH_BITS       12
+
+static uint32_t read32(const unsigned char *p)
+{
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static uint32_t hash(uint32_t v)
+{
+    return (v * 2654435761u) >> (32 - HASH_BITS);
+}
+
+// A length past its token's 15, in 255s and a remainder.
+static unsigned char *put_length(unsigned char *out, size_t length)
+{
+    while (length >= 255)
+    {
+        *out++ = 255;
+        length -= 255;
+    }
+    *out++ = (unsigned char) length;
+    return out;
+}
+
+static int get_length(const unsigned char **in,
+                      const unsigned char *end,
+                      size_t *length)
+{
+    unsigned char b;
+    do
+    {
+        if (*in == end)
+            return -1;
+        b = *(*in)++;
+        *length += b;
+    } while (b == 255);
+    return 0;
+}
+
+static unsigned char *put_sequence(unsigned char *out,
+                                   const unsigned char *literals,
+                                   size_t literal_count,
+                                   size_t offset,
+                                   size_t match)
+{
+    unsigned char *token = out++;
+    *token = (unsigned char) ((literal_count < 15 ? literal_count : 15) << 4);
+    if (literal_count >= 15)
+        out = put_length(out, literal_count - 15);
+    memcpy(out, literals, literal_count);
+    out += literal_count;
+
+    // literals only, to finish the block
+    if (match == 0)
+        return out;
+
+    *out++ = (unsigned char) (offset & 0xff);
+    *out++ = (unsigned char) (offset >> 8);
+    match -= MIN_MATCH;
+    *token |= (unsigned char) (match < 15 ? match : 15);
+    if (match >= 15)
+        out = put_length(out, match - 15);
+    return out;
+}
+
+size_t lz4_bound(size_t size)
+{
+    return size + size / 255 + 16;
+}
+
+size_t lz4_encode(const unsigned char *src, size_t size, unsigned char *dst)
+{
+    uint32_t table[1 << HASH_BITS];
+    unsigned char *out = dst;
+    size_t anchor = 0;
+    size_t i = 0;
+
+    memset(table, 0, sizeof(table));
+    while (size >= MATCH_LIMIT + 1 && i + MATCH_LIMIT <= size)
+    {
+        uint32_t h = hash(read32(src + i));
+        size_t candidate = table[h];
+        table[h] = (uint32_t) i;
+
+        if (candidate >= i || i - candidate > MAX_OFFSET ||
+            read32(src + candidate) != read32(src + i))
+        {
+            i++;
+            continue;
+        }
+
+        size_t match = MIN_MATCH;
+        while (i + match < size - LAST_LITERALS &&
+               src[candidate + match] == src[i + match])
+            match++;
+
+        out = put_sequence(out, src + anchor, i - anchor, i - candidate,
+                           match);
+        i += match;
+        anchor = i;
+    }
+
+    out = put_sequence(out, src + anchor, size - anchor, 0, 0);
+    return (size_t) (out - dst);
+}
+
+int lz4_decode(const unsigned char *src,
+               size_t src_size,
+               unsigned char *dst,
+               size_t dst_size)
+{
+    const unsigned char *in = src;
+    const unsigned char *end = src + src_size;
+    size_t out = 0;
+
+    while (in < end)
+    {
+        unsigned char token = *in++;
+
+        size_t literal_count = token >> 4;
+        if (literal_count == 15 && get_length(&in, end, &literal_count) != 0)
+            return -1;
+        if (literal_count > (size_t) (end - in) ||
+            literal_count > dst_size - out)
+            return -1;
+        memcpy(dst + out, in, literal_count);
+        in += literal_count;
+        out += literal_count;
+
+        // the last sequence has no match
+        if (in == end)
+            break;
+
+        if (end - in < 2)
+            return -1;
+        size_t offset = in[0] | (size_t) in[1] << 8;
+        in += 2;
+        size_t match = token & 15;
+        if (match == 15 && get_length(&in, end, &match) != 0)
+            return -1;
+        match += MIN_MATCH;
+        if (offset == 0 || offset > out || match > dst_size - out)
+            return -1;
+
+        // a match overlapping its own output repeats it, byte by byte
+        if (offset >= match)
+            memcpy(dst + out, dst + out - offset, match);
+        else
+            for (size_t k = 0; k < match; k++)
+                dst[out + k] = dst[out + k - offset];
+        out += match;
+    }
+    return out == dst_size ? 0 : -1;
+}
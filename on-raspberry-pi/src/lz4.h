@@ -0,0 +1,27 @@
+#ifndef ASTRO_LZ4_H
+#define ASTRO_LZ4_H
+
+#include <stddef.h>
+
+// The LZ4 block format, without the frame around it, for the compressed
+// entries of the asset pack (see asset.h). Each sequence is a token, its
+// literals and a match of at least 4 bytes up to 64 KB back; the last one
+// is literals only. Decoding is fast enough to beat reading the bytes saved
+// from an SD card, and it is bounds checked, so a corrupt pack fails instead
+// of scribbling.
+
+// Worst case size of size bytes encoded.
+size_t lz4_bound(size_t size);
+
+// Encode size bytes of src into dst, which holds lz4_bound(size) bytes.
+// Returns the encoded size. Greedy and single pass; it is for the host tools.
+size_t lz4_encode(const unsigned char *src, size_t size, unsigned char *dst);
+
+// Decode src into exactly dst_size bytes of dst. Returns 0 on success, -1 if
+// src is corrupt or doesn't decode to dst_size bytes.
+int lz4_decode(const unsigned char *src,
+               size_t src_size,
+               unsigned char *dst,
+               size_t dst_size);
+
+#endif
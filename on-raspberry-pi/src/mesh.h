@@ -0,0 +1,104 @@
+#ifndef ASTRO_MESH_H
+#define ASTRO_MESH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Baked mesh file layout (little endian, as on the Pi and in wasm):
+//
+//   mesh_file_header
+//   mesh_file_entry[entry_count]
+//   vertex and index blobs, each starting on a MESH_ALIGN boundary
+//
+// Vertex blobs are arrays of astro_attributes, so they can be handed to
+// glBufferData() untouched. Index blobs are 16-bit whenever the vertex count
+// allows it (always valid on GLES2), otherwise 32-bit.
+#define MESH_MAGIC        "APMS"
+#define MESH_FILE_VERSION 1
+#define MESH_ALIGN        64
+#define MESH_NAME_LEN     32
+
+typedef struct AstroAttributes
+{
+    float positions[3];
+    float textures[2];
+    float normals[3];
+} astro_attributes;
+
+typedef struct MeshFileHeader
+{
+    char magic[4];
+    uint32_t version;
+    uint32_t entry_count;
+    uint32_t entry_offset;
+    uint32_t file_size;
+    uint32_t vertex_stride;
+    uint32_t reserved[2];
+} mesh_file_header;
+
+typedef struct MeshFileEntry
+{
+    char name[MESH_NAME_LEN];
+    uint32_t vertex_offset;
+    uint32_t vertex_count;
+    uint32_t index_offset;
+    uint32_t index_count;
+    uint32_t index_size;        // bytes per index, 2 or 4
+    uint32_t reserved[3];
+} mesh_file_entry;
+
+// A mesh ready for upload; the pointers refer either into a mesh_pack or
+// into buffers owned by whoever built the mesh.
+typedef struct MeshData
+{
+    const astro_attributes *vertexes;
+    uint32_t vertex_count;
+    const void *indices;
+    uint32_t index_count;
+    uint32_t index_size;
+} mesh_data;
+
+// A baked mesh file in memory, owned by the caller.
+typedef struct MeshPack
+{
+    const unsigned char *base;
+    size_t size;
+    const mesh_file_header *header;
+    const mesh_file_entry *entries;
+} mesh_pack;
+
+// Take the size bytes at data, which stay the caller's, as a baked mesh
+// file. Returns 0 on success, -1 if they fail validation, in which case the
+// pack is left empty. name is for the messages.
+int mesh_pack_init(mesh_pack *pack,
+                   const void *data,
+                   size_t size,
+                   const char *name);
+
+// Look up a mesh by name. Returns 0 and fills mesh on success, -1 otherwise.
+int mesh_pack_find(const mesh_pack *pack, const char *name, mesh_data *mesh);
+
+// Name under which a sphere LOD is baked, e.g. "sphere_72x36".
+void mesh_sphere_name(char *name, size_t len,
+                      unsigned int stacks,
+                      unsigned int sectors);
+
+// Procedural generators, shared by the baking tool and the runtime fallback.
+// Spheres are unit spheres; radius and placement belong to the model matrix.
+uint32_t mesh_sphere_vertex_count(unsigned int stacks, unsigned int sectors);
+uint32_t mesh_sphere_index_count(unsigned int stacks, unsigned int sectors);
+uint32_t mesh_index_size(uint32_t vertex_count);
+
+void mesh_build_sphere(astro_attributes *vertexes,
+                       void *indices,
+                       uint32_t index_size,
+                       unsigned int stacks,
+                       unsigned int sectors);
+
+#define MESH_QUAD_VERTEXES 4
+#define MESH_QUAD_INDICES  6
+
+// Full screen quad used for the background, with 16-bit indices.
+void mesh_build_quad(astro_attributes *vertexes, uint16_t *indices);
+
+#endif
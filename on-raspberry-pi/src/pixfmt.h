@@ -0,0 +1,42 @@
+#ifndef ASTRO_PIXFMT_H
+#define ASTRO_PIXFMT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Conversions between the channel orders of image files and the RGB8 and
+// RGBA8 GL takes, count pixels at a time.
+//
+// Each has a 16 byte SIMD kernel where the compiler targets one: SSSE3,
+// NEON (on the 32 bit Pi OS only with EXTRA_CFLAGS=-mfpu=neon) or wasm
+// SIMD128, with plain C for the last few pixels and everywhere else. The
+// kernels load and store unaligned, so rows can start anywhere.
+
+// What the conversions run on here, e.g. "neon", for reports.
+const char *pixfmt_kernels(void);
+
+// dst may be src.
+void pixfmt_bgr_to_rgb(const unsigned char *src,
+                       unsigned char *dst,
+                       size_t count);
+
+// Alpha is 255.
+void pixfmt_bgr_to_rgba(const unsigned char *src,
+                        unsigned char *dst,
+                        size_t count);
+
+// dst may be src.
+void pixfmt_bgra_to_rgba(const unsigned char *src,
+                         unsigned char *dst,
+                         size_t count);
+
+// As pixfmt_bgra_to_rgba(), for files whose fourth byte is padding: alpha
+// is 255. dst may be src.
+void pixfmt_bgrx_to_rgba(const unsigned char *src,
+                         unsigned char *dst,
+                         size_t count);
+
+// Turn rows of stride bytes upside down, in place.
+void pixfmt_flip_rows(unsigned char *pixels, size_t stride, uint32_t rows);
+
+#endif
@@ -0,0 +1,79 @@
+#ifndef ASTRO_POOL_H
+#define ASTRO_POOL_H
+
+#include <stdbool.h>
+#include <stdatomic.h>
+
+// A few worker threads for the CPU work, so it overlaps the GL work on the
+// main thread: the texture decodes and transcodes, the tile reads, and
+// whatever splits into pieces with pool_parallel_for().
+//
+// Each worker has a deque of its own. Jobs a worker submits go on its deque,
+// and it takes them back newest first, while a worker with nothing to do
+// steals the oldest from the others. Jobs from other threads go on a queue
+// the workers share, and start in the order they're submitted. A thread
+// waiting for a job runs others meanwhile, so jobs may wait for jobs they
+// submit. pool_submit_after() holds a job back until others are done.
+//
+// ASTRO_THREADS sets the number of workers; by default it is one less than
+// the cores, at least one and at most POOL_MAX_THREADS. The web build has
+// workers when it is built with Emscripten pthreads (make THREADS=1).
+// Without threads, or when none can be started, pool_submit() runs the job
+// there and then.
+#define POOL_MAX_THREADS        4
+#define POOL_DEQUE_SIZE         256     // per worker; the rest go shared
+#define POOL_MAX_SUCCESSORS     8
+#define POOL_FOR_CHUNKS         32
+
+#if !defined(__EMSCRIPTEN__) || defined(__EMSCRIPTEN_PTHREADS__)
+#define POOL_THREADS            1
+#endif
+
+typedef void (*pool_func)(void *arg);
+// The items of a pool_parallel_for() from begin up to end.
+typedef void (*pool_range_func)(void *arg,
+                                unsigned int begin,
+                                unsigned int end);
+
+// Owned by the caller until the job is done.
+typedef struct PoolJob
+{
+    pool_func func;
+    void *arg;
+    atomic_bool done;
+    atomic_uint pending;        // jobs it waits for, and its submission
+    struct PoolJob *successors[POOL_MAX_SUCCESSORS];
+    unsigned int successor_count;
+    struct PoolJob *next;       // in the shared queue
+} pool_job;
+
+void pool_start(void);
+// Finish the jobs queued and join the workers.
+void pool_stop(void);
+unsigned int pool_threads(void);
+
+void pool_submit(pool_job *job, pool_func func, void *arg);
+// Submit a job that starts once the count jobs in deps, which have been
+// submitted already, are done. At most POOL_MAX_SUCCESSORS jobs can wait for
+// any one job.
+void pool_submit_after(pool_job *job,
+                       pool_func func,
+                       void *arg,
+                       pool_job *const *deps,
+                       unsigned int count);
+bool pool_done(pool_job *job);
+void pool_wait(pool_job *job);
+
+// Run func over the count items from 0, in chunks of at least grain items
+// across the workers and the calling thread, and return once all are done.
+void pool_parallel_for(unsigned int count,
+                       unsigned int grain,
+                       pool_range_func func,
+                       void *arg);
+
+// Jobs done so far; pool_wait_finished() blocks until more than count are,
+// so nothing that finishes in between is missed.
+unsigned int pool_finished(void);
+void pool_wait_finished(unsigned int count);
+
+#endif
@@ -0,0 +1,69 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "rigid.h"
+
+void rigid_batch_load(rigid_batch *b, const mat4 *m, unsigned int count)
+{
+    if (count > RIGID_BATCH_MAX)
+    {
+        fprintf(stderr, "ERROR: Too many transforms.");
+        exit(EXIT_FAILURE);
+    }
+    b->count = count;
+    for (unsigned int i = 0; i < count; i++)
+    {
+        for (int c = 0; c < 3; c++)
+        {
+            for (int k = 0; k < 3; k++)
+                b->r[c * 3 + k][i] = m[i][c][k];
+            b->t[c][i] = m[i][3][c];
+        }
+    }
+}
+
+void rigid_batch_compose(const mat4 a, const rigid_batch *b, rigid_batch *out)
+{
+    // a's elements in locals, so nothing in the loop can alias them
+    const float a00 = a[0][0], a01 = a[0][1], a02 = a[0][2];
+    const float a10 = a[1][0], a11 = a[1][1], a12 = a[1][2];
+    const float a20 = a[2][0], a21 = a[2][1], a22 = a[2][2];
+    const float a30 = a[3][0], a31 = a[3][1], a32 = a[3][2];
+    unsigned int count = b->count;
+
+    // each column of b's rotation, then its translation, turned by a; the
+    // inputs of an element are read before its outputs are written, so out
+    // may be b
+    for (int c = 0; c < 4; c++)
+    {
+        const float *x = c < 3 ? b->r[c * 3] : b->t[0];
+        const float *y = c < 3 ? b->r[c * 3 + 1] : b->t[1];
+        const float *z = c < 3 ? b->r[c * 3 + 2] : b->t[2];
+        float *ox = c < 3 ? out->r[c * 3] : out->t[0];
+        float *oy = c < 3 ? out->r[c * 3 + 1] : out->t[1];
+        float *oz = c < 3 ? out->r[c * 3 + 2] : out->t[2];
+        // only the translation is moved
+        const float w = c < 3 ? 0.0f : 1.0f;
+
+        for (unsigned int i = 0; i < count; i++)
+        {
+            float vx = x[i], vy = y[i], vz = z[i];
+            ox[i] = a00 * vx + a10 * vy + a20 * vz + a30 * w;
+            oy[i] = a01 * vx + a11 * vy + a21 * vz + a31 * w;
+            oz[i] = a02 * vx + a12 * vy + a22 * vz + a32 * w;
+        }
+    }
+    out->count = count;
+}
+
+void rigid_batch_store(const rigid_batch *b, unsigned int i, mat4 m)
+{
+    for (int c = 0; c < 3; c++)
+    {
+        for (int k = 0; k < 3; k++)
+            m[c][k] = b->r[c * 3 + k][i];
+        m[c][3] = 0.0f;
+        m[3][c] = b->t[c][i];
+    }
+    m[3][3] = 1.0f;
+}
@@ -0,0 +1,33 @@
+#ifndef ASTRO_RIGID_H
+#define ASTRO_RIGID_H
+
+#include <cglm/cglm.h>
+
+// Rigid transforms, rotation and translation only, as every model and view
+// matrix here is (a body's size is its radius, a uniform scale kept apart).
+// Their product is rigid too, and its normal matrix is its own rotation: no
+// inverse or transpose is needed, and a uniform scale only changes the
+// length of the normals, which the shaders normalize anyway.
+//
+// A batch holds them one array per element, so composing one transform with
+// all of them is a single loop over plain float arrays that the compiler
+// runs 4 (NEON, SSE, wasm SIMD) or 8 (AVX) at a time.
+#define RIGID_BATCH_MAX     256
+
+typedef struct RigidBatch
+{
+    unsigned int count;
+    float r[9][RIGID_BATCH_MAX];        // rotation, column by column
+    float t[3][RIGID_BATCH_MAX];        // translation
+} rigid_batch;
+
+// The count rigid matrices m into b.
+void rigid_batch_load(rigid_batch *b, const mat4 *m, unsigned int count);
+
+// out = a times each of b. a must be rigid; out may be b.
+void rigid_batch_compose(const mat4 a, const rigid_batch *b, rigid_batch *out);
+
+// Matrix i of b as a mat4.
+void rigid_batch_store(const rigid_batch *b, unsigned int i, mat4 m);
+
+#endif
@@ -0,0 +1,299 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "scene.h"
+#include "asset.h"
+
+#define SCENE_LINE_LEN      512
+#define SCENE_FIELDS        10          // before the features
+
+// A node as read, before the parents are found and the nodes sorted.
+typedef struct SceneLine
+{
+    char parent[SCENE_NAME_LEN];
+    unsigned int line;
+    int index;                  // of the parent, then of the node once sorted
+    unsigned int depth;
+} scene_line;
+
+static int copy_word(char *dst, size_t size, const char *word,
+                     const char *file, unsigned int line)
+{
+    if (strlen(word) >= size)
+    {
+        fprintf(stderr, "ERROR: %s:%u: %s is too long\n", file, line, word);
+        return -1;
+    }
+    strcpy(dst, word);
+    return 0;
+}
+
+// Fills node n of s, bar its parent, from the words of one line.
+static int parse_line(scene *s,
+                      unsigned int n,
+                      char **words,
+                      unsigned int count,
+                      scene_line *l,
+                      const char *file,
+                      const scene_word *known)
+{
+    if (count < SCENE_FIELDS)
+    {
+        fprintf(stderr, "ERROR: %s:%u: expected at least %d fields\n",
+                file, l->line, SCENE_FIELDS);
+        return -1;
+    }
+
+    float numbers[6];
+    for (unsigned int i = 0; i < 6; i++)
+    {
+        char *end;
+        numbers[i] = strtof(words[2 + i], &end);
+        if (*end != '\0' || !isfinite(numbers[i]))
+        {
+            fprintf(stderr, "ERROR: %s:%u: %s isn't a number\n",
+                    file, l->line, words[2 + i]);
+            return -1;
+        }
+    }
+
+    if (copy_word(s->name[n], SCENE_NAME_LEN, words[0], file, l->line) ||
+        copy_word(l->parent, SCENE_NAME_LEN,
+                  strcmp(words[1], "-") ? words[1] : "", file, l->line) ||
+        copy_word(s->map[n], SCENE_PATH_LEN, words[8], file, l->line) ||
+        copy_word(s->night_map[n], SCENE_PATH_LEN,
+                  strcmp(words[9], "-") ? words[9] : "", file, l->line))
+        return -1;
+    if (scene_find(s, s->name[n]) != (int) n)
+    {
+        fprintf(stderr, "ERROR: %s:%u: there's already a %s\n",
+                file, l->line, s->name[n]);
+        return -1;
+    }
+
+    s->radius[n] = numbers[0];
+    s->orbit[n] = numbers[1];
+    s->orbit_period[n] = numbers[2];
+    s->phase[n] = glm_rad(numbers[3]);
+    s->spin_period[n] = numbers[4];
+    s->tilt[n] = glm_rad(numbers[5]);
+
+    s->features[n] = 0;
+    for (unsigned int i = SCENE_FIELDS; i < count; i++)
+    {
+        const scene_word *w = known;
+        while (w && w->name && strcmp(w->name, words[i]) != 0)
+            w++;
+        if (w == NULL || w->name == NULL)
+        {
+            fprintf(stderr, "ERROR: %s:%u: no such feature as %s\n",
+                    file, l->line, words[i]);
+            return -1;
+        }
+        s->features[n] |= w->bit;
+    }
+    return 0;
+}
+
+// Node i into place to of sorted, with its parent's new index.
+static void move_node(scene *sorted, unsigned int to,
+                      const scene *s, unsigned int i, int parent)
+{
+    memcpy(sorted->name[to], s->name[i], SCENE_NAME_LEN);
+    sorted->parent[to] = parent;
+    sorted->radius[to] = s->radius[i];
+    sorted->orbit[to] = s->orbit[i];
+    sorted->orbit_period[to] = s->orbit_period[i];
+    sorted->phase[to] = s->phase[i];
+    sorted->spin_period[to] = s->spin_period[i];
+    sorted->tilt[to] = s->tilt[i];
+    memcpy(sorted->map[to], s->map[i], SCENE_PATH_LEN);
+    memcpy(sorted->night_map[to], s->night_map[i], SCENE_PATH_LEN);
+    sorted->features[to] = s->features[i];
+}
+
+// Find every parent and put the nodes in order of depth, each depth in the
+// order of the file.
+static int link_nodes(scene *s, scene_line *lines, const char *file)
+{
+    unsigned int count = s->count;
+    for (unsigned int i = 0; i < count; i++)
+    {
+        lines[i].index = SCENE_NONE;
+        if (lines[i].parent[0] == '\0')
+            continue;
+        lines[i].index = scene_find(s, lines[i].parent);
+        if (lines[i].index == SCENE_NONE)
+        {
+            fprintf(stderr, "ERROR: %s:%u: no such parent as %s\n",
+                    file, lines[i].line, lines[i].parent);
+            return -1;
+        }
+    }
+
+    // a chain longer than there are nodes goes round in a circle
+    unsigned int max_depth = 0;
+    for (unsigned int i = 0; i < count; i++)
+    {
+        unsigned int depth = 0;
+        for (int p = lines[i].index; p != SCENE_NONE; p = lines[p].index)
+        {
+            if (++depth > count)
+            {
+                fprintf(stderr, "ERROR: %s:%u: %s orbits itself\n",
+                        file, lines[i].line, s->name[i]);
+                return -1;
+            }
+        }
+        lines[i].depth = depth;
+        if (depth > max_depth)
+            max_depth = depth;
+    }
+
+    scene *sorted = (scene *) malloc(sizeof(scene));
+    if (sorted == NULL)
+    {
+        fprintf(stderr, "ERROR: Out of memory.");
+        exit(EXIT_FAILURE);
+    }
+    int order[SCENE_MAX_NODES];
+    unsigned int to = 0;
+    for (unsigned int depth = 0; depth <= max_depth; depth++)
+    {
+        for (unsigned int i = 0; i < count; i++)
+        {
+            if (lines[i].depth != depth)
+                continue;
+            int parent = lines[i].index;
+            move_node(sorted, to, s, i,
+                      parent == SCENE_NONE ? SCENE_NONE : order[parent]);
+            order[i] = (int) to++;
+        }
+    }
+    sorted->count = count;
+    memcpy(s, sorted, sizeof(scene));
+    free(sorted);
+    return 0;
+}
+
+int scene_parse(scene *s,
+                const char *text,
+                size_t size,
+                const char *file,
+                const scene_word *words)
+{
+    static scene_line lines[SCENE_MAX_NODES];
+    unsigned int line = 0;
+    s->count = 0;
+
+    const char *end = text + size;
+    while (text < end)
+    {
+        const char *eol = memchr(text, '\n', end - text);
+        size_t len = (eol ? eol : end) - text;
+        line++;
+        if (len >= SCENE_LINE_LEN)
+        {
+            fprintf(stderr, "ERROR: %s:%u: line too long\n", file, line);
+            return -1;
+        }
+        char buffer[SCENE_LINE_LEN];
+        memcpy(buffer, text, len);
+        buffer[len] = '\0';
+        text += len + 1;
+
+        char *comment = strchr(buffer, '#');
+        if (comment)
+            *comment = '\0';
+        char *fields[SCENE_LINE_LEN / 2];
+        unsigned int count = 0;
+        char *save;
+        for (char *w = strtok_r(buffer, " \t\r", &save);
+             w;
+             w = strtok_r(NULL, " \t\r", &save))
+            fields[count++] = w;
+        if (count == 0)
+            continue;
+
+        if (s->count == SCENE_MAX_NODES)
+        {
+            fprintf(stderr, "ERROR: %s:%u: more than %d nodes\n",
+                    file, line, SCENE_MAX_NODES);
+            return -1;
+        }
+        unsigned int n = s->count;
+        lines[n].line = line;
+        s->count++;
+        if (parse_line(s, n, fields, count, &lines[n], file, words) != 0)
+            return -1;
+    }
+
+    if (s->count == 0)
+    {
+        fprintf(stderr, "ERROR: %s: no nodes\n", file);
+        return -1;
+    }
+    if (link_nodes(s, lines, file) != 0)
+        return -1;
+    scene_update(s, 0.0);
+    return 0;
+}
+
+int scene_load(scene *s, const char *file, const scene_word *words)
+{
+    asset_span span;
+    if (asset_load(file, &span) != 0)
+    {
+        fprintf(stderr, "ERROR: Could not open %s\n", file);
+        return -1;
+    }
+    int result = scene_parse(s, (const char *) span.data, span.size,
+                             file, words);
+    asset_release(&span);
+    return result;
+}
+
+int scene_find(const scene *s, const char *name)
+{
+    for (unsigned int i = 0; i < s->count; i++)
+        if (strcmp(s->name[i], name) == 0)
+            return (int) i;
+    return SCENE_NONE;
+}
+
+// The angle gone round in time over period, from phase.
+static float turn(float phase, float period, double time)
+{
+    if (period == 0.0f)
+        return phase;
+    return phase + (float) fmod(2.0 * M_PI * time / period, 2.0 * M_PI);
+}
+
+void scene_update(scene *s, double time)
+{
+    // the mesh's poles on z, turned to y
+    mat4 upright;
+    glm_mat4_identity(upright);
+    glm_rotate_x(upright, -GLM_PI_2f, upright);
+
+    // parents first, so each world is made from a finished one
+    for (unsigned int i = 0; i < s->count; i++)
+    {
+        float a = turn(s->phase[i], s->orbit_period[i], time);
+        glm_mat4_identity(s->local[i]);
+        s->local[i][3][0] = s->orbit[i] * cosf(a);
+        s->local[i][3][2] = s->orbit[i] * sinf(a);
+
+        if (s->parent[i] == SCENE_NONE)
+            glm_mat4_copy(s->local[i], s->world[i]);
+        else
+            glm_mat4_mul(s->world[s->parent[i]], s->local[i], s->world[i]);
+
+        glm_rotate_z(s->world[i], s->tilt[i], s->model[i]);
+        glm_rotate_y(s->model[i], turn(0.0f, s->spin_period[i], time),
+                     s->model[i]);
+        glm_mat4_mul(s->model[i], upright, s->model[i]);
+    }
+}
@@ -0,0 +1,69 @@
+#ifndef ASTRO_SCENE_H
+#define ASTRO_SCENE_H
+
+#include <stddef.h>
+
+#include <cglm/cglm.h>
+
+// The bodies and what they orbit, read from a text file (see
+// textures/astro-pos.scene), so a body is added by adding a line:
+//
+//   name parent radius orbit period phase spin tilt map night [features]
+//
+// parent is "-" for none, and so is night for no night map. Lengths are in
+// scene units, times in seconds and angles in degrees; a period of 0 stands
+// still, and a negative one goes backwards. features are words the caller
+// names, each for a bit.
+//
+// The nodes are kept in arrays, one per field, sorted so every parent comes
+// before its children. scene_update() then places them all in one pass in
+// order: the local matrix of a node is its place on its orbit, its world
+// matrix the parent's world times its local one. Those are what children
+// inherit; the model matrix adds the body's own tilt and spin, and stands the
+// unit sphere of mesh.h, which has its poles on z, upright. All are rigid.
+#define SCENE_MAX_NODES     256
+#define SCENE_NAME_LEN      32
+#define SCENE_PATH_LEN      64
+#define SCENE_NONE          (-1)
+
+typedef struct SceneWord
+{
+    const char *name;           // NULL at the end of the list
+    unsigned int bit;
+} scene_word;
+
+typedef struct Scene
+{
+    unsigned int count;
+    char name[SCENE_MAX_NODES][SCENE_NAME_LEN];
+    int parent[SCENE_MAX_NODES];            // a lower index, or SCENE_NONE
+    float radius[SCENE_MAX_NODES];
+    float orbit[SCENE_MAX_NODES];           // radius around the parent
+    float orbit_period[SCENE_MAX_NODES];
+    float phase[SCENE_MAX_NODES];           // radians, along the orbit
+    float spin_period[SCENE_MAX_NODES];
+    float tilt[SCENE_MAX_NODES];            // radians
+    char map[SCENE_MAX_NODES][SCENE_PATH_LEN];
+    char night_map[SCENE_MAX_NODES][SCENE_PATH_LEN];    // "" for none
+    unsigned int features[SCENE_MAX_NODES];
+    mat4 local[SCENE_MAX_NODES];
+    mat4 world[SCENE_MAX_NODES];
+    mat4 model[SCENE_MAX_NODES];
+} scene;
+
+// Read the scene file, with features out of words. Returns -1, having said
+// why, if there is no such file or it doesn't make a scene.
+int scene_load(scene *s, const char *file, const scene_word *words);
+int scene_parse(scene *s,
+                const char *text,
+                size_t size,
+                const char *file,
+                const scene_word *words);
+
+// The index of the node called name, or SCENE_NONE.
+int scene_find(const scene *s, const char *name);
+
+// Place every node at time seconds.
+void scene_update(scene *s, double time);
+
+#endif
@@ -0,0 +1,440 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "shader.h"
+#include "progcache.h"
+#include "glstate.h"
+#include "asset.h"
+
+#define GLFW_INCLUDE_NONE
+#include <GLFW/glfw3.h>
+
+// Fixed attribute locations. Desktop GL draws nothing unless attribute 0 is
+// an array, and the instance attributes may be constants, so position is 0.
+static const struct
+{
+    GLuint location;
+    const char *name;
+} attrib_layout[] =
+{
+    { SHADER_ATTRIB_POSITION,            "vertex_position" },
+    { SHADER_ATTRIB_TEXTURE,             "vertex_texture" },
+    { SHADER_ATTRIB_NORMAL,              "vertex_normal" },
+    { SHADER_ATTRIB_INSTANCE_MODEL_VIEW, "instance_model_view" },
+    { SHADER_ATTRIB_INSTANCE_PARAMS,     "instance_params" },
+};
+#define ATTRIB_LAYOUT_SIZE (sizeof(attrib_layout) / sizeof(attrib_layout[0]))
+
+static const char *const feature_names[] =
+{
+    "NO_LIGHTING",
+    "NIGHT_LIGHTS",
+    "ECLIPSE",
+    "ATMOSPHERE",
+    "VIRTUAL_TEXTURE",
+};
+#define FEATURE_COUNT (sizeof(feature_names) / sizeof(feature_names[0]))
+
+typedef struct Variant
+{
+    const char *vert_filename;
+    const char *frag_filename;
+    unsigned int features;
+    shader_state state;
+    shader_setup setup;
+    uint64_t key;               // program cache key
+    GLuint vert_shader;         // while pending
+    GLuint frag_shader;
+    GLuint id;
+    char label[64];
+    program prog;
+} variant;
+
+static variant variants[SHADER_MAX_VARIANTS];
+static unsigned int variant_count;
+
+// Growing, always terminated text.
+typedef struct Text
+{
+    char *data;
+    size_t length;
+    size_t capacity;
+} text;
+
+static void append(text *t, const char *s, size_t n)
+{
+    if (t->length + n + 1 > t->capacity)
+    {
+        size_t capacity = t->capacity ? t->capacity : 4096;
+        while (t->length + n + 1 > capacity)
+            capacity *= 2;
+        t->data = (char *) realloc(t->data, capacity);
+        if (t->data == NULL)
+        {
+            fprintf(stderr, "ERROR: Couldn't allocate shader source.");
+            exit(EXIT_FAILURE);
+        }
+        t->capacity = capacity;
+    }
+    memcpy(t->data + t->length, s, n);
+    t->length += n;
+    t->data[t->length] = '\0';
+}
+
+static void bind_attribs(GLuint program)
+{
+    for (unsigned int i = 0; i < ATTRIB_LAYOUT_SIZE; i++)
+        glBindAttribLocation(program,
+                             attrib_layout[i].location,
+                             attrib_layout[i].name);
+}
+
+static GLuint compile(const char *src, GLenum shader_type)
+{
+    GLuint shader = glCreateShader(shader_type);
+    glShaderSource(shader, 1, &src, NULL);
+    glCompileShader(shader);
+    return shader;
+}
+
+// Report why shader didn't compile, if it didn't.
+static void compile_log(GLuint shader, const char *filename)
+{
+    GLint compiled = GL_FALSE;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &compiled);
+    if (compiled)
+        return;
+
+    char log[1024] = "";
+    glGetShaderInfoLog(shader, sizeof(log), NULL, log);
+    fprintf(stderr, "Compilation of shader %s failed:\n%s\n", filename, log);
+}
+
+// Append filename to out, replacing each #include "name" line with the
+// named file, found next to the including one.
+static int expand(text *out, const char *filename, int depth)
+{
+    if (depth > SHADER_MAX_DEPTH)
+    {
+        fprintf(stderr, "%s: #include nested too deep\n", filename);
+        return -1;
+    }
+
+    asset_span src;
+    if (asset_load(filename, &src) != 0)
+    {
+        fprintf(stderr, "Couldn't read shader %s\n", filename);
+        return -1;
+    }
+    const char *src_end = (const char *) src.data + src.size;
+
+    const char *slash = strrchr(filename, '/');
+    int dir_length = slash ? (int) (slash - filename + 1) : 0;
+    int result = 0;
+
+    // the asset's bytes have no terminating NUL
+    for (const char *line = (const char *) src.data;
+         line < src_end && result == 0; )
+    {
+        const char *end = memchr(line, '\n', src_end - line);
+        size_t length = end ? (size_t) (end - line + 1)
+                            : (size_t) (src_end - line);
+        const char *p = line;
+        while (p < line + length && (*p == ' ' || *p == '\t'))
+            p++;
+
+        if ((size_t) (line + length - p) < 8 ||
+            strncmp(p, "#include", 8) != 0)
+        {
+            append(out, line, length);
+        }
+        else
+        {
+            const char *open = memchr(p, '"', line + length - p);
+            const char *close = open ? memchr(open + 1,
+                                              '"',
+                                              line + length - open - 1)
+                                     : NULL;
+            char path[256];
+
+            if (close == NULL ||
+                snprintf(path, sizeof(path), "%.*s%.*s",
+                         dir_length, filename,
+                         (int) (close - open - 1), open + 1)
+                    >= (int) sizeof(path))
+            {
+                fprintf(stderr, "%s: bad #include\n", filename);
+                result = -1;
+            }
+            else
+            {
+                result = expand(out, path, depth + 1);
+            }
+        }
+        line += length;
+    }
+
+    // the next file starts on a line of its own
+    if (result == 0 && out->length && out->data[out->length - 1] != '\n')
+        append(out, "\n", 1);
+
+    asset_release(&src);
+    return result;
+}
+
+char *shader_source(const char *filename, const char *defines)
+{
+    text body = { NULL, 0, 0 };
+    if (expand(&body, filename, 0) != 0)
+    {
+        free(body.data);
+        return NULL;
+    }
+
+    // #version has to stay the first line
+    size_t version = 0;
+    if (strncmp(body.data, "#version", 8) == 0)
+    {
+        const char *nl = strchr(body.data, '\n');
+        version = nl ? (size_t) (nl - body.data + 1) : body.length;
+    }
+
+    text out = { NULL, 0, 0 };
+    append(&out, body.data, version);
+    if (defines)
+        append(&out, defines, strlen(defines));
+    append(&out, body.data + version, body.length - version);
+    free(body.data);
+    return out.data;
+}
+
+void shader_init(void)
+{
+    // let the driver use as many compiler threads as it likes
+    #ifndef __EMSCRIPTEN__
+    if (!caps.parallel_compile)
+        return;
+    if (GLAD_GL_KHR_parallel_shader_compile)
+        glMaxShaderCompilerThreadsKHR(0xffffffffu);
+    else
+        glMaxShaderCompilerThreadsARB(0xffffffffu);
+    #endif
+}
+
+// Start building v's program: a cached binary is ready at once, otherwise
+// the sources are compiled and linked without asking how that went, so the
+// driver can get on with it while the caller does other work.
+static void build_start(variant *v, const char *defines)
+{
+    double start = glfwGetTime();
+    char *vert_src = shader_source(v->vert_filename, defines);
+    char *frag_src = shader_source(v->frag_filename, defines);
+
+    v->state = SHADER_FAILED;
+    if (vert_src && frag_src)
+    {
+        // everything the linked program depends on
+        char layout[256] = "";
+        for (unsigned int i = 0; i < ATTRIB_LAYOUT_SIZE; i++)
+            snprintf(layout + strlen(layout), sizeof(layout) - strlen(layout),
+                     "%s=%u ", attrib_layout[i].name,
+                     attrib_layout[i].location);
+        const char *key_parts[] = { vert_src, frag_src, defines, layout };
+        v->key = progcache_key(key_parts, 4);
+
+        v->id = progcache_load(v->key);
+        if (v->id)
+        {
+            progstats.hits++;
+            v->state = SHADER_READY;
+        }
+        else
+        {
+            v->vert_shader = compile(vert_src, GL_VERTEX_SHADER);
+            v->frag_shader = compile(frag_src, GL_FRAGMENT_SHADER);
+            v->id = glCreateProgram();
+            glAttachShader(v->id, v->vert_shader);
+            glAttachShader(v->id, v->frag_shader);
+            bind_attribs(v->id);
+            progcache_prepare(v->id);
+            glLinkProgram(v->id);
+            v->state = SHADER_PENDING;
+        }
+    }
+
+    free(vert_src);
+    free(frag_src);
+    progstats.seconds += glfwGetTime() - start;
+}
+
+// Whether v's build has finished; without caps.parallel_compile the
+// status query that follows waits for it instead.
+static bool build_done(const variant *v)
+{
+    if (!caps.parallel_compile)
+        return true;
+
+    GLint done = GL_FALSE;
+    glGetProgramiv(v->id, GL_COMPLETION_STATUS_KHR, &done);
+    return done;
+}
+
+// Collect the result of a pending build.
+static void build_finish(variant *v)
+{
+    double start = glfwGetTime();
+    GLint linked = GL_FALSE;
+    glGetProgramiv(v->id, GL_LINK_STATUS, &linked);
+    if (linked)
+    {
+        progstats.misses++;
+        progcache_store(v->key, v->id);
+        v->state = SHADER_READY;
+    }
+    else
+    {
+        compile_log(v->vert_shader, v->vert_filename);
+        compile_log(v->frag_shader, v->frag_filename);
+
+        char log[1024] = "";
+        glGetProgramInfoLog(v->id, sizeof(log), NULL, log);
+        fprintf(stderr, "Linking shader failed (vert: %s, frag: %s):\n%s\n",
+                v->vert_filename, v->frag_filename, log);
+        glDeleteProgram(v->id);
+        v->id = 0;
+        v->state = SHADER_FAILED;
+    }
+
+    // don't need these any more
+    if (v->id)
+    {
+        glDetachShader(v->id, v->vert_shader);
+        glDetachShader(v->id, v->frag_shader);
+    }
+    glDeleteShader(v->vert_shader);
+    glDeleteShader(v->frag_shader);
+    v->vert_shader = v->frag_shader = 0;
+    progstats.seconds += glfwGetTime() - start;
+}
+
+static void ready(variant *v)
+{
+    program_reflect(&v->prog, v->id, v->label);
+    if (v->setup)
+        v->setup(&v->prog, v->features);
+}
+
+static variant *find_variant(const char *vert_filename,
+                             const char *frag_filename,
+                             unsigned int features)
+{
+    for (unsigned int i = 0; i < variant_count; i++)
+    {
+        variant *v = &variants[i];
+
+        if (v->features == features &&
+            strcmp(v->vert_filename, vert_filename) == 0 &&
+            strcmp(v->frag_filename, frag_filename) == 0)
+            return v;
+    }
+    return NULL;
+}
+
+// an unlit variant has nothing for the lighting features to change
+static unsigned int normalise(unsigned int features)
+{
+    return features & SHADER_NO_LIGHTING ? SHADER_NO_LIGHTING : features;
+}
+
+shader_state shader_request(const char *vert_filename,
+                            const char *frag_filename,
+                            unsigned int features,
+                            shader_setup setup)
+{
+    features = normalise(features);
+
+    variant *v = find_variant(vert_filename, frag_filename, features);
+    if (v)
+        return v->state;
+
+    if (variant_count == SHADER_MAX_VARIANTS)
+    {
+        fprintf(stderr, "WARNING: no room for another shader variant\n");
+        return SHADER_FAILED;
+    }
+
+    v = &variants[variant_count++];
+    memset(v, 0, sizeof(*v));
+    char defines[256] = "";
+    for (unsigned int f = 0; f < FEATURE_COUNT; f++)
+        if (features & (1u << f))
+            snprintf(defines + strlen(defines),
+                     sizeof(defines) - strlen(defines),
+                     "#define %s\n", feature_names[f]);
+
+    v->vert_filename = vert_filename;
+    v->frag_filename = frag_filename;
+    v->features = features;
+    v->setup = setup;
+    snprintf(v->label, sizeof(v->label), "%s[%x]", vert_filename, features);
+
+    build_start(v, defines);
+    if (v->state == SHADER_READY)
+        ready(v);
+    return v->state;
+}
+
+program *shader_variant(const char *vert_filename,
+                        const char *frag_filename,
+                        unsigned int features,
+                        shader_setup setup)
+{
+    if (shader_request(vert_filename, frag_filename, features, setup)
+            != SHADER_READY)
+        return NULL;
+
+    return &find_variant(vert_filename,
+                         frag_filename,
+                         normalise(features))->prog;
+}
+
+unsigned int shader_poll(void)
+{
+    unsigned int pending = 0;
+
+    for (unsigned int i = 0; i < variant_count; i++)
+    {
+        variant *v = &variants[i];
+
+        if (v->state != SHADER_PENDING)
+            continue;
+        if (!build_done(v))
+        {
+            pending++;
+            continue;
+        }
+
+        build_finish(v);
+        if (v->state == SHADER_READY)
+            ready(v);
+    }
+    return pending;
+}
+
+void shader_variants_destroy(void)
+{
+    for (unsigned int i = 0; i < variant_count; i++)
+    {
+        variant *v = &variants[i];
+
+        if (v->state == SHADER_PENDING)
+        {
+            glDeleteShader(v->vert_shader);
+            glDeleteShader(v->frag_shader);
+        }
+        if (v->id)
+            gls_delete_program(v->id);
+    }
+    variant_count = 0;
+}
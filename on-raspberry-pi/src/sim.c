@@ -0,0 +1,140 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <time.h>
+#include <math.h>
+
+#include "sim.h"
+#include "pool.h"
+
+#ifdef POOL_THREADS
+#include <pthread.h>
+#endif
+
+#define GLFW_INCLUDE_NONE
+#include <GLFW/glfw3.h>
+
+// set in the middle index while the snapshot there is yet to be drawn
+#define SIM_FRESH   4u
+
+sim_stats simstats;
+
+static scene graph;
+static sim_snapshot buffers[3];
+static atomic_uint middle;
+static unsigned int back;               // the simulation's
+static unsigned int front;              // draw()'s
+
+#ifdef POOL_THREADS
+static pthread_t thread;
+static atomic_bool stopping;
+static bool running;
+#endif
+
+static void step(void)
+{
+    sim_snapshot *s = &buffers[back];
+    s->step = simstats.steps++;
+    s->time = glfwGetTime();
+
+    // the camera circles the origin
+    s->eye[0] = (float) (sin(0.2 * s->time) * 100.0);
+    s->eye[1] = 0.0f;
+    s->eye[2] = (float) (cos(0.2 * s->time) * 100.0);
+
+    scene_update(&graph, s->time);
+    s->body_count = graph.count;
+    memcpy(s->models, graph.model, graph.count * sizeof(mat4));
+
+    unsigned int old = atomic_exchange_explicit(&middle, back | SIM_FRESH,
+                                                memory_order_acq_rel);
+    if (old & SIM_FRESH)
+        simstats.dropped++;
+    back = old & ~SIM_FRESH;
+}
+
+#ifdef POOL_THREADS
+static void *run(void *arg)
+{
+    (void) arg;
+    double hz = SIM_HZ;
+    const char *env = getenv("ASTRO_SIM_HZ");
+    if (env && *env && strtod(env, NULL) > 0.0)
+        hz = strtod(env, NULL);
+    long period = (long) (1e9 / hz);
+
+    // on a fixed schedule, however long a step takes
+    struct timespec next;
+    clock_gettime(CLOCK_MONOTONIC, &next);
+    while (!atomic_load(&stopping))
+    {
+        next.tv_nsec += period;
+        while (next.tv_nsec >= 1000000000L)
+        {
+            next.tv_nsec -= 1000000000L;
+            next.tv_sec++;
+        }
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+        step();
+    }
+    return NULL;
+}
+#endif
+
+void sim_start(const scene *s)
+{
+    memcpy(&graph, s, sizeof(graph));
+    memset(&simstats, 0, sizeof(simstats));
+
+    front = 0;
+    atomic_store(&middle, 1);
+    back = 2;
+    step();
+
+    #ifdef POOL_THREADS
+    atomic_store(&stopping, false);
+    running = pthread_create(&thread, NULL, run, NULL) == 0;
+    if (!running)
+        fprintf(stderr, "WARNING: no simulation thread, stepping per frame\n");
+    #endif
+}
+
+void sim_stop(void)
+{
+    #ifdef POOL_THREADS
+    if (running)
+    {
+        atomic_store(&stopping, true);
+        pthread_join(thread, NULL);
+        running = false;
+    }
+    #endif
+    fprintf(stderr,
+            "simulation: %lu steps, %lu dropped; %lu frames, %lu reused\n",
+            simstats.steps, simstats.dropped,
+            simstats.frames, simstats.reused);
+}
+
+const sim_snapshot *sim_acquire(void)
+{
+    #ifdef POOL_THREADS
+    if (!running)
+        step();
+    #else
+    step();
+    #endif
+
+    simstats.frames++;
+    if (atomic_load_explicit(&middle, memory_order_relaxed) & SIM_FRESH)
+    {
+        unsigned int old = atomic_exchange_explicit(&middle, front,
+                                                    memory_order_acq_rel);
+        front = old & ~SIM_FRESH;
+    }
+    else
+    {
+        simstats.reused++;
+    }
+    return &buffers[front];
+}
@@ -0,0 +1,54 @@
+#ifndef ASTRO_SIM_H
+#define ASTRO_SIM_H
+
+#include <stdbool.h>
+
+#include <cglm/cglm.h>
+
+#include "scene.h"
+
+// The simulation: where the bodies and the camera are at a time. It steps
+// on a thread of its own at SIM_HZ (or ASTRO_SIM_HZ), so it never waits for
+// the swap, and draw() never waits for it.
+//
+// Each step fills a snapshot and publishes it through a triple buffer: the
+// simulation writes the back one and swaps it with the middle one, draw()
+// swaps the middle one with the front one it reads if there is a newer one,
+// both with one atomic exchange. A snapshot replaced before draw() took it
+// is dropped; a frame that finds nothing newer reuses the one it has. Both
+// are counted in simstats, which is printed at sim_stop().
+//
+// Without threads (the web build without pthreads) sim_acquire() steps the
+// simulation itself.
+#define SIM_HZ              120
+#define SIM_MAX_BODIES      SCENE_MAX_NODES
+
+typedef struct SimSnapshot
+{
+    unsigned long step;         // the step that made it
+    double time;                // on the glfwGetTime() clock
+    vec3 eye;
+    unsigned int body_count;
+    mat4 models[SIM_MAX_BODIES];  // of the scene's nodes, in its order
+} sim_snapshot;
+
+// Each field is counted by one thread; read them after sim_stop().
+typedef struct SimStats
+{
+    unsigned long steps;
+    unsigned long dropped;      // published, and replaced before drawn
+    unsigned long frames;
+    unsigned long reused;       // frames drawn from the last one again
+} sim_stats;
+
+extern sim_stats simstats;
+
+// Start stepping the scene, which is copied and updated each step. The
+// first snapshot is there before this returns.
+void sim_start(const scene *s);
+void sim_stop(void);
+
+// The newest snapshot, the caller's until the next call. Render thread only.
+const sim_snapshot *sim_acquire(void);
+
+#endif
@@ -0,0 +1,310 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "texarray.h"
+#include "ktx.h"
+#include "texture.h"
+#include "pixels.h"
+#include "texload.h"
+#include "glstate.h"
+
+// Create the texture for ta's size and layers, with levels mip levels to
+// sample.
+static void texarray_create(tex_array *ta, unsigned int levels)
+{
+    ta->target = caps.texture_array ? GL_TEXTURE_2D_ARRAY : GL_TEXTURE_2D;
+    ta->levels = levels;
+
+    glGenTextures(1, &ta->texture);
+    gls_bind_texture(ta->target, ta->texture);
+    texture_filter(ta->target, levels);
+    if (caps.texture_array)
+    {
+        glTexParameteri(ta->target, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(ta->target, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    }
+    else
+    {
+        // an atlas of any other number of layers is NPOT, which GLES2 can
+        // only sample with clamping
+        glTexParameteri(ta->target, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(ta->target, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    }
+}
+
+// The atlas stacks the layers, so it has to fit all of them. Then drop
+// halves it some more.
+static void texarray_fit(tex_array *ta,
+                         unsigned int count,
+                         GLint max_size,
+                         unsigned int drop)
+{
+    unsigned int rows = caps.texture_array ? 1 : count;
+
+    while (ta->width > 1 && ta->height > 1 &&
+           (ta->width > max_size || ta->height * (GLint) rows > max_size ||
+            drop > 0))
+    {
+        if (ta->width <= max_size && ta->height * (GLint) rows <= max_size)
+            drop--;
+        ta->width /= 2;
+        ta->height /= 2;
+    }
+}
+
+// Layers from the images' KTX2 versions, taking from each the level of the
+// common size and the levels below it, untouched. Returns -1, with nothing
+// created, unless every layer has a KTX2 file of the same format and a
+// level of that size.
+static int texarray_load_ktx(tex_array *ta,
+                             tex_image *images,
+                             unsigned int count,
+                             GLint max_size,
+                             unsigned int drop)
+{
+    const ktx_file *ktx[TEXARRAY_MAX_LAYERS];
+    unsigned int first[TEXARRAY_MAX_LAYERS];
+
+    if (count == 0 || !images[0].has_ktx)
+        return -1;
+    uint32_t vk_format = images[0].ktx.header->vk_format;
+    for (unsigned int l = 0; l < count; l++)
+    {
+        ktx[l] = &images[l].ktx;
+        if (!images[l].has_ktx || ktx[l]->header->vk_format != vk_format)
+            return -1;
+
+        const ktx_header *hdr = ktx[l]->header;
+        if (l == 0 || (int) hdr->pixel_width < ta->width)
+            ta->width = hdr->pixel_width;
+        if (l == 0 || (int) hdr->pixel_height < ta->height)
+            ta->height = hdr->pixel_height;
+    }
+    texarray_fit(ta, count, max_size, drop);
+
+    bool etc2 = vk_format == KTX_VK_FORMAT_ETC2_R8G8B8_UNORM;
+    // compressed layers of the atlas have to start on a block
+    if (etc2 && !caps.texture_array && ta->height % 4 != 0)
+        return -1;
+
+    // the array can be mipmapped if every layer has the rest of the chain;
+    // the atlas would bleed layers into each other
+    unsigned int levels = ktx_chain_length(ta->width, ta->height);
+    if (!caps.texture_array || !texture_mipmappable(ta->width, ta->height))
+        levels = 1;
+    for (unsigned int l = 0; l < count; l++)
+    {
+        const ktx_header *hdr = ktx[l]->header;
+
+        first[l] = 0;
+        while (first[l] < hdr->level_count &&
+               (hdr->pixel_width >> first[l]) != (uint32_t) ta->width)
+            first[l]++;
+        if (first[l] == hdr->level_count ||
+            (hdr->pixel_height >> first[l]) != (uint32_t) ta->height)
+            return -1;
+        if (hdr->level_count - first[l] < levels)
+            levels = 1;
+    }
+
+    ta->layers = count;
+    texarray_create(ta, levels);
+    texstream_init(&ta->stream, "body textures", ta->texture, ta->target,
+                   etc2 ? GL_COMPRESSED_RGB8_ETC2 : GL_RGBA,
+                   ta->width, ta->height, levels, count);
+
+    for (unsigned int m = 0; m < levels; m++)
+    {
+        GLsizei w = ta->width >> m ? ta->width >> m : 1;
+        GLsizei h = ta->height >> m ? ta->height >> m : 1;
+        size_t layer_size = ktx_level_size(vk_format, w, h);
+        ta->bytes += layer_size * count;
+
+        // storage first; the data streams in layer by layer from the files
+        if (caps.texture_array && etc2)
+            glCompressedTexImage3D(ta->target, m, GL_COMPRESSED_RGB8_ETC2,
+                                   w, h, count, 0,
+                                   layer_size * count, NULL);
+        else if (caps.texture_array)
+            glTexImage3D(ta->target, m, GL_RGBA8, w, h, count,
+                         0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+        else if (etc2)
+            glCompressedTexImage2D(ta->target, m, GL_COMPRESSED_RGB8_ETC2,
+                                   w, h * count, 0,
+                                   layer_size * count, NULL);
+        else
+            glTexImage2D(ta->target, m, GL_RGBA, w, h * count,
+                         0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+
+        for (unsigned int l = 0; l < count; l++)
+        {
+            ktx_level level;
+            ktx_level_get(ktx[l], first[l] + m, &level);
+            texstream_source(&ta->stream, l, m, level.data);
+        }
+    }
+    texstream_start(&ta->stream, images, count);
+    return 0;
+}
+
+int texarray_load_images(tex_array *ta,
+                         tex_image *images,
+                         unsigned int count,
+                         unsigned int drop)
+{
+    memset(ta, 0, sizeof(*ta));
+    if (count == 0 || count > TEXARRAY_MAX_LAYERS)
+    {
+        fprintf(stderr, "ERROR: %u texture layers, at most %d\n",
+                count, TEXARRAY_MAX_LAYERS);
+        return -1;
+    }
+
+    GLint max_size = 0;
+    GLint max_layers = 1;
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &max_size);
+    if (caps.texture_array)
+        glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &max_layers);
+    if (caps.texture_array && (GLint) count > max_layers)
+    {
+        fprintf(stderr, "ERROR: %u texture layers, GL allows %d\n",
+                count, max_layers);
+        return -1;
+    }
+
+    if (texarray_load_ktx(ta, images, count, max_size, drop) == 0)
+        return 0;
+    memset(ta, 0, sizeof(*ta));
+
+    // common size; layers that came from KTX2 files are decoded after all
+    for (unsigned int l = 0; l < count; l++)
+    {
+        tex_image *img = &images[l];
+        if (img->status != 0 ||
+            (img->pixels == NULL && texload_decode(img) != 0))
+        {
+            fprintf(stderr, "Failed to load texture %s\n", img->file);
+            return -1;
+        }
+        if (l == 0 || (int) img->width < ta->width)
+            ta->width = img->width;
+        if (l == 0 || (int) img->height < ta->height)
+            ta->height = img->height;
+    }
+
+    texarray_fit(ta, count, max_size, drop);
+
+    // the array gets its mips made here; the atlas has none
+    unsigned int levels = 1;
+    if (caps.texture_array && texture_mipmappable(ta->width, ta->height))
+        levels = texture_levels(ta->width, ta->height);
+
+    ta->layers = count;
+    texarray_create(ta, levels);
+    for (unsigned int m = 0; m < levels; m++)
+        ta->bytes += (size_t) (ta->width >> m ? ta->width >> m : 1) *
+                     (ta->height >> m ? ta->height >> m : 1) * 4 * count;
+    if (caps.texture_array)
+    {
+        for (unsigned int m = 0; m < levels; m++)
+            glTexImage3D(ta->target, m, GL_RGBA8,
+                         ta->width >> m ? ta->width >> m : 1,
+                         ta->height >> m ? ta->height >> m : 1,
+                         count, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    }
+    else
+    {
+        glTexImage2D(ta->target, 0, GL_RGBA,
+                     ta->width, ta->height * count,
+                     0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    }
+
+    // the resized layer, then the two levels being made from each other
+    // level 1 is the largest made; a side of 1 doesn't halve
+    size_t layer_size = (size_t) ta->width * ta->height * 4;
+    uint32_t mip_w, mip_h;
+    pixels_half_size(ta->width, ta->height, &mip_w, &mip_h);
+    size_t mip_size = (size_t) mip_w * mip_h * 4;
+    unsigned char *resized = (unsigned char *) malloc(layer_size);
+    unsigned char *mips[2];
+    mips[0] = (unsigned char *) malloc(mip_size);
+    mips[1] = (unsigned char *) malloc(mip_size);
+    if (resized == NULL || mips[0] == NULL || mips[1] == NULL)
+    {
+        fprintf(stderr, "ERROR: Couldn't allocate texture layer.");
+        exit(EXIT_FAILURE);
+    }
+
+    for (unsigned int l = 0; l < count; l++)
+    {
+        const tex_image *img = &images[l];
+        const unsigned char *pixels = img->pixels;
+        if ((int) img->width != ta->width || (int) img->height != ta->height)
+        {
+            pixels_resize_rgba(img->pixels, img->width, img->height,
+                               resized, ta->width, ta->height);
+            pixels = resized;
+        }
+
+        if (caps.texture_array)
+            glTexSubImage3D(ta->target, 0, 0, 0, l,
+                            ta->width, ta->height, 1,
+                            GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+        else
+            glTexSubImage2D(ta->target, 0, 0, l * ta->height,
+                            ta->width, ta->height,
+                            GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+
+        uint32_t w_m = ta->width;
+        uint32_t h_m = ta->height;
+        for (unsigned int m = 1; m < levels; m++)
+        {
+            unsigned char *mip = mips[m & 1];
+            pixels_downsample_srgb(pixels, w_m, h_m, mip);
+            pixels_half_size(w_m, h_m, &w_m, &h_m);
+            glTexSubImage3D(ta->target, m, 0, 0, l, w_m, h_m, 1,
+                            GL_RGBA, GL_UNSIGNED_BYTE, mip);
+            pixels = mip;
+        }
+    }
+
+    free(resized);
+    free(mips[0]);
+    free(mips[1]);
+    for (unsigned int l = 0; l < count; l++)
+        texload_release(&images[l]);
+    return 0;
+}
+
+int texarray_load(tex_array *ta, const char *const *files, unsigned int count)
+{
+    tex_image images[TEXARRAY_MAX_LAYERS];
+    // texarray_load_images() turns away any other count
+    unsigned int loading = count <= TEXARRAY_MAX_LAYERS ? count : 0;
+
+    for (unsigned int l = 0; l < loading; l++)
+        texload_request(&images[l], files[l], 0);
+    for (unsigned int l = 0; l < loading; l++)
+        texload_wait(&images[l]);
+
+    // the images are on the stack, so the stream can't wait for later
+    int result = texarray_load_images(ta, images, count, 0);
+    texstream_finish(&ta->stream);
+    for (unsigned int l = 0; l < loading; l++)
+        texload_release(&images[l]);
+    return result;
+}
+
+void texarray_destroy(tex_array *ta)
+{
+    texstream_cancel(&ta->stream);
+    if (ta->texture)
+        gls_delete_texture(ta->texture);
+    ta->texture = 0;
+}
+
+float texarray_layer_scale(const tex_array *ta)
+{
+    return ta->layers ? 1.0f / ta->layers : 1.0f;
+}
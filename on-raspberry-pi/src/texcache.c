@@ -0,0 +1,172 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <stdatomic.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "texcache.h"
+#include "glcaps.h"
+#include "pixels.h"
+#include "etc.h"
+#include "pool.h"
+
+static bool enabled;
+static const char *cache_dir;
+static uint32_t vk_format;
+static atomic_uint store_count;         // for the temporary files' names
+
+// 64-bit FNV-1a, continuing from h
+static uint64_t hash_bytes(uint64_t h, const void *data, size_t size)
+{
+    const unsigned char *p = (const unsigned char *) data;
+
+    for (size_t i = 0; i < size; i++)
+    {
+        h ^= p[i];
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+// One level being ETC encoded, a band of block rows at a time.
+typedef struct EtcLevel
+{
+    const unsigned char *pixels;
+    uint32_t width;
+    uint32_t height;
+    unsigned char *out;
+} etc_level;
+
+static void encode_rows(void *arg, unsigned int begin, unsigned int end)
+{
+    const etc_level *level = (const etc_level *) arg;
+    uint32_t top = begin * 4;
+    uint32_t bottom = end * 4 < level->height ? end * 4 : level->height;
+
+    // only the last band has blocks over the bottom edge
+    etc_encode(level->pixels + (size_t) top * level->width * 4,
+               level->width, bottom - top,
+               level->out + (size_t) begin * ((level->width + 3) / 4) * 8);
+}
+
+static void entry_path(char *path, size_t size, uint64_t key)
+{
+    snprintf(path, size, "%s/%016llx.ktx2", cache_dir,
+             (unsigned long long) key);
+}
+
+void texcache_init(void)
+{
+    #ifdef __EMSCRIPTEN__
+    enabled = false;
+    #else
+    cache_dir = getenv("ASTRO_CACHE_DIR");
+    if (cache_dir == NULL || *cache_dir == '\0')
+        cache_dir = "cache";
+    enabled = mkdir(cache_dir, 0755) == 0 || errno == EEXIST;
+    if (!enabled)
+        fprintf(stderr, "WARNING: no texture cache, can't create %s\n",
+                cache_dir);
+    vk_format = caps.etc2 ? KTX_VK_FORMAT_ETC2_R8G8B8_UNORM
+                          : KTX_VK_FORMAT_R8G8B8A8_UNORM;
+    #endif
+}
+
+bool texcache_enabled(void)
+{
+    return enabled;
+}
+
+uint64_t texcache_key(const void *data, size_t size)
+{
+    uint32_t target[3] = { TEXCACHE_VERSION, vk_format, caps.npot };
+    uint64_t h = hash_bytes(14695981039346656037ull, target, sizeof(target));
+    return hash_bytes(h, data, size);
+}
+
+int texcache_open(uint64_t key, ktx_file *ktx, asset_span *file)
+{
+    if (!enabled)
+        return -1;
+
+    char path[256];
+    entry_path(path, sizeof(path), key);
+    if (asset_load(path, file) != 0)
+        return -1;
+    if (ktx_init(ktx, file->data, file->size, path) != 0 ||
+        ktx->header->vk_format != vk_format)
+    {
+        asset_release(file);
+        return -1;
+    }
+    return 0;
+}
+
+int texcache_store(uint64_t key,
+                   const unsigned char *chain,
+                   uint32_t width,
+                   uint32_t height,
+                   unsigned int levels)
+{
+    if (!enabled || levels > KTX_MAX_LEVELS)
+        return -1;
+
+    const void *data[KTX_MAX_LEVELS];
+    unsigned char *encoded = NULL;
+    bool etc2 = vk_format == KTX_VK_FORMAT_ETC2_R8G8B8_UNORM;
+    if (etc2)
+    {
+        // the encoded levels go one after another
+        size_t size = 0;
+        uint32_t lw = width;
+        uint32_t lh = height;
+        for (unsigned int l = 0; l < levels; l++)
+        {
+            size += ktx_level_size(vk_format, lw, lh);
+            pixels_half_size(lw, lh, &lw, &lh);
+        }
+        encoded = (unsigned char *) malloc(size);
+        if (encoded == NULL)
+            return -1;
+    }
+
+    unsigned char *block = encoded;
+    uint32_t w = width;
+    uint32_t h = height;
+    for (unsigned int l = 0; l < levels; l++)
+    {
+        data[l] = chain;
+        if (etc2)
+        {
+            // the block rows encode apart, across the pool
+            etc_level level = { chain, w, h, block };
+            pool_parallel_for((h + 3) / 4, TEXCACHE_ETC_ROWS, encode_rows,
+                              &level);
+            data[l] = block;
+            block += ktx_level_size(vk_format, w, h);
+        }
+        chain += (size_t) w * h * 4;
+        pixels_half_size(w, h, &w, &h);
+    }
+
+    // written aside and renamed, so a crash or another thread or process
+    // writing the same entry never leaves half a file
+    char path[256];
+    char tmp[300];
+    entry_path(path, sizeof(path), key);
+    snprintf(tmp, sizeof(tmp), "%s.%ld.%u.tmp", path, (long) getpid(),
+             atomic_fetch_add(&store_count, 1));
+    int err = ktx_write(tmp, vk_format, width, height, levels, data,
+                        "astro-pos texcache");
+    if (err == 0 && rename(tmp, path) != 0)
+    {
+        remove(tmp);
+        err = -1;
+    }
+    if (err != 0)
+        fprintf(stderr, "WARNING: couldn't write %s\n", path);
+    free(encoded);
+    return err;
+}
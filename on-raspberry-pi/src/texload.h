@@ -0,0 +1,52 @@
+#ifndef ASTRO_TEXLOAD_H
+#define ASTRO_TEXLOAD_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "ktx.h"
+#include "asset.h"
+#include "pool.h"
+
+// Texture files loaded on the worker pool while the main thread sets up GL,
+// which then only has to upload them: the KTX2 version ktxtex_open() picks
+// where there is one, else the one in the texture cache (see texcache.h),
+// transcoded into it on the first load, or else the image decoded to RGBA8.
+//
+// stb_image decodes a JPEG in one piece, so each image is one job and the
+// images decode side by side. The mip chain of a decoded image, the other
+// big piece of CPU work, is built on the worker too with TEXLOAD_MIPS.
+#define TEXLOAD_MIPS    1
+
+typedef struct TexImage
+{
+    pool_job job;
+    const char *file;
+    unsigned int flags;
+    int status;                 // 0 once loaded, -1 if it couldn't be
+    const char *source;         // where it came from, for the report
+    bool has_ktx;
+    ktx_file ktx;               // with has_ktx
+    asset_span ktx_file;        // its bytes
+    unsigned char *pixels;      // otherwise the levels, one after another
+    uint32_t width;
+    uint32_t height;
+    unsigned int levels;
+    double load_ms;             // time on the worker
+} tex_image;
+
+// Start loading file into img. flags are TEXLOAD_ ones.
+void texload_request(tex_image *img, const char *file, unsigned int flags);
+bool texload_ready(tex_image *img);
+// Wait for img to load; returns its status.
+int texload_wait(tex_image *img);
+
+// Decode the image of one that was loaded from its KTX2 version, for the
+// callers that need its pixels after all. Runs on the calling thread.
+int texload_decode(tex_image *img);
+
+// One line of what img was loaded from and how long it took.
+void texload_report(const tex_image *img);
+void texload_release(tex_image *img);
+
+#endif
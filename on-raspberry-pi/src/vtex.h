@@ -0,0 +1,84 @@
+#ifndef ASTRO_VTEX_H
+#define ASTRO_VTEX_H
+
+#include <stdint.h>
+
+#include <cglm/cglm.h>
+
+#include "glcaps.h"
+#include "program.h"
+#include "pool.h"
+#include "vtfile.h"
+
+// A virtual texture on a sphere: of a pyramid of tiles (see vtfile.h), only
+// those the camera needs are on the GPU, in the slots of an atlas.
+//
+// Each frame vtex_update() works out which tiles the view needs from the
+// sphere and the camera, coarse levels first, and marks them used. The tiles
+// missing are read on the pool, at most VTEX_MAX_LOADS at a time; at most
+// VTEX_UPLOADS of those read (or ASTRO_VT_UPLOADS) go into the atlas per
+// frame, each in the slot used longest ago. The one tile of the top level is
+// loaded at open and never leaves, so there is always something to show.
+//
+// The shader finds a tile through the indirection texture: one texel per
+// tile with a mip level per pyramid level, so the level the hardware picks
+// for a texel is the tile level it wants. Each texel names the atlas slot and
+// level of the finest tile loaded at or above it. See vtex.glsl.
+#define VTEX_ATLAS_SLOTS        15  // per side, 2040 texels
+#define VTEX_MAX_LOADS          16
+#define VTEX_UPLOADS            4
+#define VTEX_INDIRECTION_UNIT   1
+#define VTEX_ATLAS_UNIT         2
+#define VTEX_NONE               UINT32_MAX
+
+typedef struct VTexLoad
+{
+    pool_job job;
+    struct VTex *vt;
+    uint32_t tile;              // VTEX_NONE while the load is free
+    int status;
+    unsigned char *data;
+} vtex_load;
+
+typedef struct VTex
+{
+    vt_file file;
+    GLuint indirection;
+    GLuint atlas;
+    unsigned int slots;         // per side
+    uint32_t *slot_tile;        // tile in each slot, or VTEX_NONE
+    uint32_t *slot_used;        // frame it was last needed in
+    uint32_t *tile_slot;        // slot of each tile, or VTEX_NONE
+    unsigned char *loading;     // whether each tile is being read
+    unsigned char *entries[VT_MAX_LEVELS];  // the indirection texture
+    vtex_load loads[VTEX_MAX_LOADS];
+    uint32_t *wanted;           // this frame's tiles, coarse first
+    uint32_t frame;
+    unsigned int uploads;       // per frame
+    unsigned long loaded;       // tiles uploaded in all
+    unsigned long evicted;
+    unsigned int mem_asset;     // what it holds, in memstats
+    size_t heap_bytes;
+} vtex;
+
+// Open filename and create its textures. Returns -1, with nothing created,
+// if there is no such file or this context can't use it.
+int vtex_open(vtex *vt, const char *filename);
+// Does nothing to one that isn't open.
+void vtex_close(vtex *vt);
+
+// Bring in what a sphere of radius placed in view by the rigid model_view
+// matrix needs, and bind the textures to their units.
+void vtex_update(vtex *vt,
+                 mat4 model_view,
+                 float radius,
+                 mat4 proj,
+                 int viewport_height);
+
+// Constant state of a program sampling the virtual texture.
+void vtex_program(const vtex *vt, program *prog);
+
+// GPU bytes of its textures.
+size_t vtex_bytes(const vtex *vt);
+
+#endif
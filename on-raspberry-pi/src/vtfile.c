@@ -0,0 +1,113 @@
+// tiles of the big pyramids lie past 2 GB, even on a 32 bit Pi OS
+#define _FILE_OFFSET_BITS 64
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "vtfile.h"
+#include "ktx.h"
+
+static int power_of_two(uint32_t n)
+{
+    return n != 0 && (n & (n - 1)) == 0;
+}
+
+uint32_t vt_level_tiles_x(const vt_header *hdr, unsigned int level)
+{
+    return hdr->tiles_x >> level ? hdr->tiles_x >> level : 1;
+}
+
+uint32_t vt_level_tiles_y(const vt_header *hdr, unsigned int level)
+{
+    return hdr->tiles_y >> level ? hdr->tiles_y >> level : 1;
+}
+
+int vt_header_init(vt_header *hdr,
+                   uint32_t vk_format,
+                   uint32_t tiles_x,
+                   uint32_t tiles_y)
+{
+    memset(hdr, 0, sizeof(*hdr));
+    memcpy(hdr->magic, VT_MAGIC, VT_MAGIC_LEN);
+    hdr->vk_format = vk_format;
+    hdr->tiles_x = tiles_x;
+    hdr->tiles_y = tiles_y;
+    hdr->levels = ktx_chain_length(tiles_x, tiles_y);
+    hdr->tile_bytes = ktx_level_size(vk_format, VT_PHYSICAL, VT_PHYSICAL);
+    hdr->data_offset = sizeof(*hdr);
+
+    if (!power_of_two(tiles_x) || !power_of_two(tiles_y) ||
+        hdr->levels > VT_MAX_LEVELS || hdr->tile_bytes == 0)
+        return -1;
+    return 0;
+}
+
+int vt_open(vt_file *vt, const char *filename)
+{
+    memset(vt, 0, sizeof(*vt));
+    vt->fd = open(filename, O_RDONLY);
+    if (vt->fd < 0)
+        return -1;
+
+    vt_header *hdr = &vt->header;
+    vt_header expected;
+    struct stat st;
+    if (read(vt->fd, hdr, sizeof(*hdr)) != (ssize_t) sizeof(*hdr) ||
+        memcmp(hdr->magic, VT_MAGIC, VT_MAGIC_LEN) != 0 ||
+        vt_header_init(&expected,
+                       hdr->vk_format,
+                       hdr->tiles_x,
+                       hdr->tiles_y) != 0 ||
+        memcmp(hdr, &expected, sizeof(*hdr)) != 0)
+    {
+        fprintf(stderr, "%s is not a virtual texture file\n", filename);
+        vt_close(vt);
+        return -1;
+    }
+
+    for (unsigned int l = 0; l < hdr->levels; l++)
+    {
+        vt->level_first[l] = vt->tile_count;
+        vt->tile_count += vt_level_tiles_x(hdr, l) * vt_level_tiles_y(hdr, l);
+    }
+
+    if (fstat(vt->fd, &st) != 0 ||
+        st.st_size < (off_t) hdr->data_offset +
+                     (off_t) vt->tile_count * hdr->tile_bytes)
+    {
+        fprintf(stderr, "Virtual texture file %s is truncated\n", filename);
+        vt_close(vt);
+        return -1;
+    }
+    return 0;
+}
+
+void vt_close(vt_file *vt)
+{
+    if (vt->fd >= 0)
+        close(vt->fd);
+    memset(vt, 0, sizeof(*vt));
+    vt->fd = -1;
+}
+
+uint32_t vt_tile_index(const vt_file *vt,
+                       unsigned int level,
+                       uint32_t x,
+                       uint32_t y)
+{
+    return vt->level_first[level] +
+           y * vt_level_tiles_x(&vt->header, level) + x;
+}
+
+int vt_read_tile(const vt_file *vt, uint32_t index, void *out)
+{
+    off_t offset = (off_t) vt->header.data_offset +
+                   (off_t) index * vt->header.tile_bytes;
+    ssize_t size = vt->header.tile_bytes;
+
+    return pread(vt->fd, out, size, offset) == size ? 0 : -1;
+}
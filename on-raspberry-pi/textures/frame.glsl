@@ -0,0 +1,18 @@
+// Per-frame data of the GLES3 / WebGL2 shaders, written once per frame and
+// shared by all programs. ubo.h mirrors this layout.
+
+#ifndef MAX_OCCLUDERS
+#define MAX_OCCLUDERS 4
+#endif
+
+// Block members keep the same precision in both stages so they link
+layout(std140) uniform Frame
+{
+    highp mat4 view_mat;
+    highp mat4 proj_mat;
+    highp vec4 light_position;
+    highp vec4 ambient_colour;  // The light and object's combined ambient colour
+    highp vec4 diffuse_colour;  // The light and object's combined diffuse colour
+    highp vec4 occluders[MAX_OCCLUDERS];    // View space centre, radius in w
+    highp vec4 time;
+};
@@ -0,0 +1,51 @@
+// Lighting terms of the body shader variants, each only compiled in for
+// the variants using it. Everything is in view space.
+
+#ifndef MAX_OCCLUDERS
+#define MAX_OCCLUDERS 4
+#endif
+
+#ifdef ECLIPSE
+// How much of the light reaches position past the occluding spheres
+float eclipse(vec3 position,
+              vec3 light_direction,
+              vec4 occluders[MAX_OCCLUDERS])
+{
+    float light = 1.0;
+
+    for (int i = 0; i < MAX_OCCLUDERS; i++)
+    {
+        vec3 to_centre = occluders[i].xyz - position;
+        float radius = occluders[i].w;
+        float along = dot(to_centre, light_direction);
+
+        // unused slots have no radius, and a body doesn't shadow itself
+        if (radius > 0.0 && along > 0.0 &&
+            dot(to_centre, to_centre) > 1.02 * radius * radius)
+        {
+            float miss = length(to_centre - along * light_direction);
+            light *= smoothstep(0.8 * radius, 1.2 * radius, miss);
+        }
+    }
+    return light;
+}
+#endif
+
+#ifdef NIGHT_LIGHTS
+// City lights, fading in across the terminator
+vec3 night_lights(vec3 night_colour, float n_dot_l)
+{
+    return night_colour * (1.0 - smoothstep(-0.1, 0.1, n_dot_l));
+}
+#endif
+
+#ifdef ATMOSPHERE
+const vec3 rim_colour = vec3(0.35, 0.55, 1.0);
+
+// Light scattered by the atmosphere, strongest along the lit limb
+vec3 atmosphere_rim(vec3 normal, vec3 view_direction, float n_dot_l)
+{
+    float rim = 1.0 - max(dot(normal, view_direction), 0.0);
+    return rim_colour * rim * rim * rim * clamp(n_dot_l + 0.3, 0.0, 1.0);
+}
+#endif
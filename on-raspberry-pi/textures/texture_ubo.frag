@@ -0,0 +1,75 @@
+#version 300 es
+
+precision mediump float;
+
+#include "frame.glsl"
+#include "lighting.glsl"
+#include "vtex.glsl"
+
+in vec3 texture_coord;
+#ifndef NO_LIGHTING
+in vec3 normal;
+in vec3 light_vector;
+#endif
+#if defined(ECLIPSE) || defined(ATMOSPHERE)
+in vec3 surface_position;
+#endif
+#ifdef NIGHT_LIGHTS
+in vec3 night_coord;
+#endif
+#ifdef VIRTUAL_TEXTURE
+in VT_HIGHP vec2 virtual_coord;
+#endif
+
+out vec4 frag_colour;
+
+uniform mediump sampler2DArray texture_sampler;
+
+const float inv_radius_square = 0.00001;
+
+void main()
+{
+    // Base colour (from the diffuse texture)
+#ifdef VIRTUAL_TEXTURE
+    vec4 colour = virtual_texture(virtual_coord);
+#else
+    vec4 colour = texture(texture_sampler, texture_coord);
+#endif
+
+    // Ambient lighting
+    vec3 ambient = vec3(ambient_colour.xyz * colour.xyz);
+
+#ifdef NO_LIGHTING
+    frag_colour = vec4(ambient, colour.w);
+#else
+    // Calculate the light attenuation, and direction
+    float dist_square = dot(light_vector, light_vector);
+    float attenuation = clamp(1.0 - inv_radius_square * sqrt(dist_square),
+                              0.0,
+                              1.0);
+	attenuation *= attenuation;
+    vec3 light_direction = light_vector * inversesqrt(dist_square);
+    vec3 surface_normal = normalize(normal);
+    float n_dot_l = dot(light_direction, surface_normal);
+
+    // Diffuse lighting
+    vec3 diffuse = max(n_dot_l, 0.0) * diffuse_colour.xyz * colour.xyz;
+#ifdef ECLIPSE
+    diffuse *= eclipse(surface_position, light_direction, occluders);
+#endif
+
+    // The final colour
+    // NOTE: Alpha channel shouldn't be affected by lights
+    vec3 final_colour = (ambient + diffuse) * attenuation;
+#ifdef NIGHT_LIGHTS
+    final_colour += night_lights(texture(texture_sampler, night_coord).xyz,
+                                 n_dot_l);
+#endif
+#ifdef ATMOSPHERE
+    final_colour += atmosphere_rim(surface_normal,
+                                   normalize(-surface_position),
+                                   n_dot_l);
+#endif
+    frag_colour = vec4(final_colour, colour.w);
+#endif
+}
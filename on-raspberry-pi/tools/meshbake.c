@@ -0,0 +1,159 @@
+// Bakes every mesh astro-pos draws into one binary file (see mesh.h) so
+// that startup only has to map it and upload.
+//
+//   meshbake textures/astro-pos.mesh
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mesh.h"
+
+// Sphere LODs as stacks x sectors; the first one is what the bodies use.
+static const unsigned int sphere_lods[][2] =
+{
+    { 72, 36 },
+    { 36, 18 },
+    { 18,  9 },
+};
+
+#define LOD_COUNT (sizeof(sphere_lods) / sizeof(sphere_lods[0]))
+#define MESH_COUNT (LOD_COUNT + 1)
+
+typedef struct BakedMesh
+{
+    mesh_file_entry entry;
+    astro_attributes *vertexes;
+    void *indices;
+} baked_mesh;
+
+static uint32_t align_up(uint32_t offset)
+{
+    return (offset + MESH_ALIGN - 1) & ~(uint32_t)(MESH_ALIGN - 1);
+}
+
+static int write_at(FILE *fp, uint32_t offset, const void *data, size_t size)
+{
+    if (fseek(fp, offset, SEEK_SET) != 0)
+        return -1;
+    return fwrite(data, size, 1, fp) == 1 || size == 0 ? 0 : -1;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc != 2)
+    {
+        fprintf(stderr, "usage: %s <output.mesh>\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    baked_mesh meshes[MESH_COUNT];
+    memset(meshes, 0, sizeof(meshes));
+
+    for (size_t i = 0; i < LOD_COUNT; i++)
+    {
+        unsigned int stacks = sphere_lods[i][0];
+        unsigned int sectors = sphere_lods[i][1];
+        mesh_file_entry *e = &meshes[i].entry;
+
+        mesh_sphere_name(e->name, MESH_NAME_LEN, stacks, sectors);
+        e->vertex_count = mesh_sphere_vertex_count(stacks, sectors);
+        e->index_count = mesh_sphere_index_count(stacks, sectors);
+        e->index_size = mesh_index_size(e->vertex_count);
+
+        meshes[i].vertexes = malloc(e->vertex_count * sizeof(astro_attributes));
+        meshes[i].indices = malloc(e->index_count * e->index_size);
+        if (!meshes[i].vertexes || !meshes[i].indices)
+        {
+            fprintf(stderr, "Error allocating memory for %s\n", e->name);
+            return EXIT_FAILURE;
+        }
+        mesh_build_sphere(meshes[i].vertexes,
+                          meshes[i].indices,
+                          e->index_size,
+                          stacks,
+                          sectors);
+    }
+
+    baked_mesh *quad = &meshes[LOD_COUNT];
+    strcpy(quad->entry.name, "quad");
+    quad->entry.vertex_count = MESH_QUAD_VERTEXES;
+    quad->entry.index_count = MESH_QUAD_INDICES;
+    quad->entry.index_size = sizeof(uint16_t);
+    quad->vertexes = malloc(MESH_QUAD_VERTEXES * sizeof(astro_attributes));
+    quad->indices = malloc(MESH_QUAD_INDICES * sizeof(uint16_t));
+    if (!quad->vertexes || !quad->indices)
+    {
+        fprintf(stderr, "Error allocating memory for quad\n");
+        return EXIT_FAILURE;
+    }
+    mesh_build_quad(quad->vertexes, quad->indices);
+
+    // lay out the blobs after the entry table
+    mesh_file_header hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, MESH_MAGIC, 4);
+    hdr.version = MESH_FILE_VERSION;
+    hdr.entry_count = MESH_COUNT;
+    hdr.entry_offset = sizeof(mesh_file_header);
+    hdr.vertex_stride = sizeof(astro_attributes);
+
+    uint32_t offset = hdr.entry_offset + MESH_COUNT * sizeof(mesh_file_entry);
+    for (size_t i = 0; i < MESH_COUNT; i++)
+    {
+        mesh_file_entry *e = &meshes[i].entry;
+        e->vertex_offset = align_up(offset);
+        offset = e->vertex_offset + e->vertex_count * sizeof(astro_attributes);
+        e->index_offset = align_up(offset);
+        offset = e->index_offset + e->index_count * e->index_size;
+    }
+    hdr.file_size = align_up(offset);
+
+    FILE *fp = fopen(argv[1], "wb");
+    if (!fp)
+    {
+        fprintf(stderr, "Couldn't open %s for writing\n", argv[1]);
+        return EXIT_FAILURE;
+    }
+
+    int err = write_at(fp, 0, &hdr, sizeof(hdr));
+    for (size_t i = 0; i < MESH_COUNT && !err; i++)
+    {
+        const mesh_file_entry *e = &meshes[i].entry;
+        err = write_at(fp, hdr.entry_offset + i * sizeof(*e), e, sizeof(*e));
+        if (!err)
+            err = write_at(fp, e->vertex_offset, meshes[i].vertexes,
+                           e->vertex_count * sizeof(astro_attributes));
+        if (!err)
+            err = write_at(fp, e->index_offset, meshes[i].indices,
+                           e->index_count * e->index_size);
+    }
+    // pad to the recorded size so the last blob stays aligned
+    if (!err && hdr.file_size > offset)
+    {
+        static const unsigned char zero[MESH_ALIGN];
+        err = write_at(fp, offset, zero, hdr.file_size - offset);
+    }
+    if (fclose(fp) != 0)
+        err = -1;
+
+    if (err)
+    {
+        fprintf(stderr, "Error writing %s\n", argv[1]);
+        remove(argv[1]);
+        return EXIT_FAILURE;
+    }
+
+    for (size_t i = 0; i < MESH_COUNT; i++)
+    {
+        printf("%-16s %6u vertexes %6u indices (%u-bit)\n",
+               meshes[i].entry.name,
+               meshes[i].entry.vertex_count,
+               meshes[i].entry.index_count,
+               meshes[i].entry.index_size * 8);
+        free(meshes[i].vertexes);
+        free(meshes[i].indices);
+    }
+    printf("wrote %s, %u bytes\n", argv[1], hdr.file_size);
+    return EXIT_SUCCESS;
+}
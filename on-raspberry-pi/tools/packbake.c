@@ -0,0 +1,197 @@
+// Packs asset files into the one file astro-pos maps at startup (see
+// asset.h), each under the path it is given by:
+//
+//   packbake textures/astro-pos.pack textures/*.ktx2 textures/*.glsl ...
+//
+// Run it from where astro-pos runs, so the names are the paths astro-pos
+// asks for. An entry is LZ4 compressed when that makes it at least an eighth
+// smaller: the shaders and meshes, say, but never the JPEGs.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "asset.h"
+#include "lz4.h"
+
+typedef struct PackedAsset
+{
+    asset_entry entry;
+    unsigned char *data;        // as stored
+} packed_asset;
+
+static uint64_t align_up(uint64_t offset)
+{
+    return (offset + ASSET_ALIGN - 1) & ~(uint64_t)(ASSET_ALIGN - 1);
+}
+
+static int write_at(FILE *fp, uint64_t offset, const void *data, size_t size)
+{
+    if (fseeko(fp, (off_t) offset, SEEK_SET) != 0)
+        return -1;
+    return fwrite(data, size, 1, fp) == 1 || size == 0 ? 0 : -1;
+}
+
+static unsigned char *read_file(const char *filename, size_t *size)
+{
+    FILE *fp = fopen(filename, "rb");
+    if (fp == NULL)
+        return NULL;
+
+    unsigned char *data = NULL;
+    long length = -1;
+    if (fseek(fp, 0, SEEK_END) == 0)
+        length = ftell(fp);
+    if (length >= 0 && fseek(fp, 0, SEEK_SET) == 0)
+        data = (unsigned char *) malloc(length ? length : 1);
+    if (data && length && fread(data, length, 1, fp) != 1)
+    {
+        free(data);
+        data = NULL;
+    }
+    fclose(fp);
+
+    *size = (size_t) length;
+    return data;
+}
+
+static int compare_asset(const void *a, const void *b)
+{
+    return strcmp(((const packed_asset *) a)->entry.name,
+                  ((const packed_asset *) b)->entry.name);
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 3)
+    {
+        fprintf(stderr, "usage: %s <output.pack> <file>...\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    uint32_t count = argc - 2;
+    packed_asset *assets = (packed_asset *) calloc(count, sizeof(*assets));
+    if (assets == NULL)
+    {
+        fprintf(stderr, "ERROR: Couldn't allocate the table of contents.\n");
+        return EXIT_FAILURE;
+    }
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        const char *name = argv[i + 2];
+        asset_entry *e = &assets[i].entry;
+        if (strlen(name) >= ASSET_NAME_LEN)
+        {
+            fprintf(stderr, "Name %s is too long for the pack\n", name);
+            return EXIT_FAILURE;
+        }
+        strcpy(e->name, name);
+
+        size_t size;
+        unsigned char *data = read_file(name, &size);
+        if (data == NULL)
+        {
+            fprintf(stderr, "Couldn't read %s\n", name);
+            return EXIT_FAILURE;
+        }
+        e->uncompressed_size = size;
+
+        unsigned char *packed = (unsigned char *) malloc(lz4_bound(size));
+        if (packed == NULL)
+        {
+            fprintf(stderr, "ERROR: Couldn't allocate for %s.\n", name);
+            return EXIT_FAILURE;
+        }
+        size_t packed_size = lz4_encode(data, size, packed);
+        if (packed_size <= size - size / 8)
+        {
+            free(data);
+            assets[i].data = packed;
+            e->size = packed_size;
+            e->compression = ASSET_LZ4;
+        }
+        else
+        {
+            free(packed);
+            assets[i].data = data;
+            e->size = size;
+            e->compression = ASSET_STORED;
+        }
+    }
+
+    // sorted, so astro-pos can look names up with bsearch()
+    qsort(assets, count, sizeof(*assets), compare_asset);
+    for (uint32_t i = 1; i < count; i++)
+    {
+        if (strcmp(assets[i - 1].entry.name, assets[i].entry.name) == 0)
+        {
+            fprintf(stderr, "%s is in the pack twice\n",
+                    assets[i].entry.name);
+            return EXIT_FAILURE;
+        }
+    }
+
+    asset_pack_header hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, ASSET_MAGIC, 4);
+    hdr.version = ASSET_VERSION;
+    hdr.entry_count = count;
+    hdr.entry_offset = sizeof(asset_pack_header);
+
+    uint64_t offset = hdr.entry_offset +
+                      (uint64_t) count * sizeof(asset_entry);
+    for (uint32_t i = 0; i < count; i++)
+    {
+        asset_entry *e = &assets[i].entry;
+        e->offset = align_up(offset);
+        offset = e->offset + e->size;
+    }
+    hdr.file_size = align_up(offset);
+
+    FILE *fp = fopen(argv[1], "wb");
+    if (!fp)
+    {
+        fprintf(stderr, "Couldn't open %s for writing\n", argv[1]);
+        return EXIT_FAILURE;
+    }
+
+    int err = write_at(fp, 0, &hdr, sizeof(hdr));
+    for (uint32_t i = 0; i < count && !err; i++)
+    {
+        const asset_entry *e = &assets[i].entry;
+        err = write_at(fp, hdr.entry_offset + i * sizeof(*e), e, sizeof(*e));
+        if (!err)
+            err = write_at(fp, e->offset, assets[i].data, e->size);
+    }
+    // pad to the recorded size so the last entry stays aligned
+    if (!err && hdr.file_size > offset)
+    {
+        static const unsigned char zero[ASSET_ALIGN];
+        err = write_at(fp, offset, zero, hdr.file_size - offset);
+    }
+    if (fclose(fp) != 0)
+        err = -1;
+
+    if (err)
+    {
+        fprintf(stderr, "Error writing %s\n", argv[1]);
+        remove(argv[1]);
+        return EXIT_FAILURE;
+    }
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        const asset_entry *e = &assets[i].entry;
+        printf("%-32s %9llu bytes, %9llu %s\n",
+               e->name,
+               (unsigned long long) e->uncompressed_size,
+               (unsigned long long) e->size,
+               e->compression == ASSET_LZ4 ? "lz4" : "stored");
+        free(assets[i].data);
+    }
+    printf("%s: %u assets, %llu bytes\n",
+           argv[1], count, (unsigned long long) hdr.file_size);
+    free(assets);
+    return EXIT_SUCCESS;
+}
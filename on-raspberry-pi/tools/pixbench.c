@@ -0,0 +1,307 @@
+// Measures the pixel-format conversions of pixfmt.c and the BMP decoder
+// built on them, in MB/s of source bytes, against plain per-pixel loops and
+// stb_image. It checks their output against each other as it goes.
+//
+//   pixbench [width height]
+//
+// The conversions use whatever kernels the compiler targets, so build it
+// with -march=native (as `make bench` does) to see the SIMD ones.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// this stb_image's BMP reader asserts on an offset it keeps only for
+// callbacks, so it aborts on every 24 bit BMP in memory
+#define STBI_ASSERT(x) ((void) 0)
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+
+#include "pixfmt.h"
+#include "bmp.h"
+
+#define MIN_SECONDS 0.5
+
+typedef void (*convert_func)(const unsigned char *src,
+                             unsigned char *dst,
+                             size_t count);
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// The per-pixel loops the BMP loader had, for comparison.
+static void plain_bgr_to_rgb(const unsigned char *src,
+                             unsigned char *dst,
+                             size_t count)
+{
+    for (size_t i = 0; i < count * 3; i += 3)
+    {
+        unsigned char b = src[i];
+        dst[i] = src[i + 2];
+        dst[i + 1] = src[i + 1];
+        dst[i + 2] = b;
+    }
+}
+
+static void plain_bgr_to_rgba(const unsigned char *src,
+                              unsigned char *dst,
+                              size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        dst[i * 4] = src[i * 3 + 2];
+        dst[i * 4 + 1] = src[i * 3 + 1];
+        dst[i * 4 + 2] = src[i * 3];
+        dst[i * 4 + 3] = 255;
+    }
+}
+
+static void plain_bgra_to_rgba(const unsigned char *src,
+                               unsigned char *dst,
+                               size_t count)
+{
+    for (size_t i = 0; i < count * 4; i += 4)
+    {
+        unsigned char b = src[i];
+        dst[i] = src[i + 2];
+        dst[i + 1] = src[i + 1];
+        dst[i + 2] = b;
+        dst[i + 3] = src[i + 3];
+    }
+}
+
+// MB/s of src_bytes converted by func, run until MIN_SECONDS have passed.
+static double rate(convert_func func,
+                   const unsigned char *src,
+                   unsigned char *dst,
+                   size_t count,
+                   size_t src_bytes)
+{
+    unsigned int runs = 0;
+    double start = now();
+    double elapsed;
+    do
+    {
+        func(src, dst, count);
+        runs++;
+        elapsed = now() - start;
+    } while (elapsed < MIN_SECONDS);
+    return src_bytes * (double) runs / elapsed / 1e6;
+}
+
+static int compare(const char *name,
+                   convert_func plain,
+                   convert_func simd,
+                   const unsigned char *src,
+                   size_t count,
+                   size_t src_size,
+                   size_t dst_size)
+{
+    unsigned char *expected = (unsigned char *) malloc(count * dst_size);
+    unsigned char *got = (unsigned char *) malloc(count * dst_size);
+    if (expected == NULL || got == NULL)
+    {
+        fprintf(stderr, "ERROR: Couldn't allocate the output.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // odd counts too, for the scalar tails
+    int err = 0;
+    for (size_t n = count - 37; n <= count && !err; n++)
+    {
+        memset(expected, 0, n * dst_size);
+        memset(got, 0, n * dst_size);
+        plain(src, expected, n);
+        simd(src, got, n);
+        err = memcmp(expected, got, n * dst_size) != 0;
+    }
+    if (err)
+    {
+        fprintf(stderr, "%s: output differs from the plain loop\n", name);
+        return -1;
+    }
+
+    double plain_rate = rate(plain, src, expected, count, count * src_size);
+    double simd_rate = rate(simd, src, got, count, count * src_size);
+    printf("%-16s %8.0f MB/s plain %8.0f MB/s %s (x%.1f)\n",
+           name, plain_rate, simd_rate, pixfmt_kernels(),
+           simd_rate / plain_rate);
+    free(expected);
+    free(got);
+    return 0;
+}
+
+static void put16(unsigned char *p, uint32_t v)
+{
+    p[0] = v & 0xff;
+    p[1] = (v >> 8) & 0xff;
+}
+
+static void put32(unsigned char *p, uint32_t v)
+{
+    put16(p, v & 0xffff);
+    put16(p + 2, v >> 16);
+}
+
+// A bottom-up BMP of random pixels, its rows padded.
+static unsigned char *make_bmp(uint32_t width,
+                               uint32_t height,
+                               unsigned int bpp,
+                               size_t *size)
+{
+    size_t stride = ((size_t) width * bpp + 31) / 32 * 4;
+    *size = 54 + stride * height;
+    unsigned char *bmp = (unsigned char *) calloc(*size, 1);
+    if (bmp == NULL)
+    {
+        fprintf(stderr, "ERROR: Couldn't allocate the BMP.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    bmp[0] = 'B';
+    bmp[1] = 'M';
+    put32(bmp + 2, (uint32_t) *size);
+    put32(bmp + 10, 54);
+    put32(bmp + 14, 40);
+    put32(bmp + 18, width);
+    put32(bmp + 22, height);
+    put16(bmp + 26, 1);
+    put16(bmp + 28, bpp);
+    for (uint32_t y = 0; y < height; y++)
+        for (size_t x = 0; x < (size_t) width * bpp / 8; x++)
+            bmp[54 + y * stride + x] = (unsigned char) rand();
+    return bmp;
+}
+
+static int bench_bmp(uint32_t width, uint32_t height, unsigned int bpp)
+{
+    size_t size;
+    unsigned char *bmp = make_bmp(width, height, bpp, &size);
+
+    // stb_image agrees on the pixels, if not the alpha of 32 bit ones
+    uint32_t w, h;
+    int sw, sh, n;
+    unsigned char *ours = bmp_decode(bmp, size, "bench", &w, &h);
+    unsigned char *theirs = stbi_load_from_memory(bmp, (int) size,
+                                                  &sw, &sh, &n,
+                                                  STBI_rgb_alpha);
+    int err = ours == NULL || theirs == NULL ||
+              w != (uint32_t) sw || h != (uint32_t) sh;
+    for (size_t i = 0; !err && i < (size_t) w * h; i++)
+        err = memcmp(ours + i * 4, theirs + i * 4, 3) != 0 ||
+              ours[i * 4 + 3] != 255;
+    free(ours);
+    stbi_image_free(theirs);
+    if (err)
+    {
+        fprintf(stderr, "%u bit BMP: decoders disagree\n", bpp);
+        free(bmp);
+        return -1;
+    }
+
+    double stb_rate = 0.0, our_rate = 0.0;
+    for (int which = 0; which < 2; which++)
+    {
+        unsigned int runs = 0;
+        double start = now();
+        double elapsed;
+        do
+        {
+            unsigned char *pixels =
+                which == 0 ? stbi_load_from_memory(bmp, (int) size,
+                                                   &sw, &sh, &n,
+                                                   STBI_rgb_alpha)
+                           : bmp_decode(bmp, size, "bench", &w, &h);
+            free(pixels);
+            runs++;
+            elapsed = now() - start;
+        } while (elapsed < MIN_SECONDS);
+        *(which == 0 ? &stb_rate : &our_rate) =
+            size * (double) runs / elapsed / 1e6;
+    }
+    printf("bmp %2u bit       %8.0f MB/s stb   %8.0f MB/s bmp.c (x%.1f)\n",
+           bpp, stb_rate, our_rate, our_rate / stb_rate);
+    free(bmp);
+    return 0;
+}
+
+// Headers whose pixels wouldn't fit in memory, or in a 32 bit size_t, with
+// next to no data behind them: the decoder must turn them down rather than
+// allocate what the sizes wrap round to.
+static int check_too_large(void)
+{
+    static const int32_t sizes[][2] = {
+        { 65536, -16384 },          // 4 GB, 0 in 32 bits
+        { 65536, 65536 },
+        { 1, 65536 },
+    };
+    int err = 0;
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+    {
+        size_t size;
+        unsigned char *bmp = make_bmp(1, 1, 32, &size);
+        put32(bmp + 18, (uint32_t) sizes[i][0]);
+        put32(bmp + 22, (uint32_t) sizes[i][1]);
+        uint32_t w, h;
+        unsigned char *pixels = bmp_decode(bmp, size, "too large", &w, &h);
+        if (pixels)
+        {
+            fprintf(stderr, "%d x %d BMP of %zu bytes: decoded\n",
+                    sizes[i][0], sizes[i][1], size);
+            free(pixels);
+            err = -1;
+        }
+        free(bmp);
+    }
+    return err;
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t width = 4095;      // odd, for the row padding
+    uint32_t height = 2048;
+    if (argc == 3)
+    {
+        width = (uint32_t) atoi(argv[1]);
+        height = (uint32_t) atoi(argv[2]);
+    }
+    else if (argc != 1)
+    {
+        fprintf(stderr, "usage: %s [width height]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    size_t count = (size_t) width * height;
+    if (count < 64)
+    {
+        fprintf(stderr, "At least 64 pixels, please\n");
+        return EXIT_FAILURE;
+    }
+
+    unsigned char *src = (unsigned char *) malloc(count * 4);
+    if (src == NULL)
+    {
+        fprintf(stderr, "ERROR: Couldn't allocate the image.\n");
+        return EXIT_FAILURE;
+    }
+    for (size_t i = 0; i < count * 4; i++)
+        src[i] = (unsigned char) rand();
+
+    printf("%u x %u pixels\n", width, height);
+    int err = 0;
+    err |= compare("bgr -> rgb", plain_bgr_to_rgb, pixfmt_bgr_to_rgb,
+                   src, count, 3, 3);
+    err |= compare("bgr -> rgba", plain_bgr_to_rgba, pixfmt_bgr_to_rgba,
+                   src, count, 3, 4);
+    err |= compare("bgra -> rgba", plain_bgra_to_rgba, pixfmt_bgra_to_rgba,
+                   src, count, 4, 4);
+    err |= bench_bmp(width, height, 24);
+    err |= bench_bmp(width, height, 32);
+    err |= check_too_large();
+    free(src);
+    return err ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,151 @@
+// Measures the per-body transforms of a frame, in matrices a second: each
+// rigid model matrix into view space, and its normal matrix, the general way
+// with cglm (a 4x4 product, then the inverse transpose of its upper 3x3) and
+// the way rigid.c does it (a batch of rigid products whose rotations are the
+// normal matrices). It checks they agree first.
+//
+//   rigidbench [bodies]
+//
+// Build it with -march=native (as `make bench` does) for the vector units of
+// this machine.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#include <cglm/cglm.h>
+
+#include "rigid.h"
+
+#define MIN_SECONDS 0.5
+#define TOLERANCE   1e-4f
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static float random_float(float range)
+{
+    return range * (2.0f * rand() / (float) RAND_MAX - 1.0f);
+}
+
+// Rotated every which way, and moved.
+static void random_rigid(mat4 m)
+{
+    glm_mat4_identity(m);
+    glm_translate(m, (vec3){random_float(100.0f),
+                            random_float(100.0f),
+                            random_float(100.0f)});
+    glm_rotate_z(m, random_float(GLM_PIf), m);
+    glm_rotate_y(m, random_float(GLM_PIf), m);
+    glm_rotate_x(m, random_float(GLM_PIf), m);
+}
+
+// The general path: model-view, and the normal matrix as the inverse
+// transpose of its upper 3x3, for each body in turn.
+static void general(mat4 view,
+                    mat4 *models,
+                    unsigned int count,
+                    mat4 *model_views,
+                    mat3 *normals)
+{
+    for (unsigned int i = 0; i < count; i++)
+    {
+        mat4 inverse;
+        glm_mat4_mul(view, models[i], model_views[i]);
+        glm_mat4_inv(model_views[i], inverse);
+        glm_mat4_pick3(inverse, normals[i]);
+        glm_mat3_transpose(normals[i]);
+    }
+}
+
+static int agree(const rigid_batch *batch,
+                 mat4 *model_views,
+                 mat3 *normals,
+                 unsigned int count)
+{
+    for (unsigned int i = 0; i < count; i++)
+    {
+        mat4 mv;
+        rigid_batch_store(batch, i, mv);
+        for (int c = 0; c < 4; c++)
+            for (int k = 0; k < 4; k++)
+                if (fabsf(mv[c][k] - model_views[i][c][k]) >
+                    TOLERANCE * (1.0f + fabsf(model_views[i][c][k])))
+                    return 0;
+        for (int c = 0; c < 3; c++)
+            for (int k = 0; k < 3; k++)
+                if (fabsf(mv[c][k] - normals[i][c][k]) > TOLERANCE)
+                    return 0;
+    }
+    return 1;
+}
+
+int main(int argc, char **argv)
+{
+    unsigned int count = RIGID_BATCH_MAX;
+    if (argc == 2)
+    {
+        count = (unsigned int) atoi(argv[1]);
+    }
+    else if (argc != 1)
+    {
+        fprintf(stderr, "usage: %s [bodies]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    if (count < 1 || count > RIGID_BATCH_MAX)
+    {
+        fprintf(stderr, "1 to %d bodies, please\n", RIGID_BATCH_MAX);
+        return EXIT_FAILURE;
+    }
+
+    static mat4 models[RIGID_BATCH_MAX];
+    static mat4 model_views[RIGID_BATCH_MAX];
+    static mat3 normals[RIGID_BATCH_MAX];
+    static rigid_batch batch;
+    mat4 view;
+    random_rigid(view);
+    for (unsigned int i = 0; i < count; i++)
+        random_rigid(models[i]);
+
+    general(view, models, count, model_views, normals);
+    rigid_batch_load(&batch, models, count);
+    rigid_batch_compose(view, &batch, &batch);
+    if (!agree(&batch, model_views, normals, count))
+    {
+        fprintf(stderr, "the rigid batch differs from cglm\n");
+        return EXIT_FAILURE;
+    }
+
+    // the batch is loaded from the models each frame, as draw() does
+    double rates[2];
+    for (int which = 0; which < 2; which++)
+    {
+        unsigned long runs = 0;
+        double start = now();
+        double elapsed;
+        do
+        {
+            if (which == 0)
+            {
+                general(view, models, count, model_views, normals);
+            }
+            else
+            {
+                rigid_batch_load(&batch, models, count);
+                rigid_batch_compose(view, &batch, &batch);
+            }
+            runs++;
+            elapsed = now() - start;
+        } while (elapsed < MIN_SECONDS);
+        rates[which] = count * (double) runs / elapsed / 1e6;
+    }
+    printf("%u bodies: %8.1f M/s cglm %8.1f M/s rigid (x%.1f)\n",
+           count, rates[0], rates[1], rates[1] / rates[0]);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,98 @@
+// Bakes an image into a KTX2 file (see ktx.h) with its full mip chain, so
+// that startup only has to map it and upload.
+//
+//   texbake etc2 textures/earth.jpg textures/earth.etc2.ktx2
+//   texbake rgba textures/earth.jpg textures/earth.rgba.ktx2
+//
+// ETC2 is written as ETC1 blocks, which every ETC2 decoder takes: half a
+// byte per pixel against four for RGBA8, and no decoding at startup. RGBA8
+// is for contexts without ETC2.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+
+#include "ktx.h"
+#include "pixels.h"
+#include "etc.h"
+
+int main(int argc, char **argv)
+{
+    if (argc != 4 ||
+        (strcmp(argv[1], "etc2") != 0 && strcmp(argv[1], "rgba") != 0))
+    {
+        fprintf(stderr, "usage: %s etc2|rgba <image> <output.ktx2>\n",
+                argv[0]);
+        return EXIT_FAILURE;
+    }
+    uint32_t vk_format = strcmp(argv[1], "etc2") == 0
+                         ? KTX_VK_FORMAT_ETC2_R8G8B8_UNORM
+                         : KTX_VK_FORMAT_R8G8B8A8_UNORM;
+
+    int w, h, n;
+    unsigned char *pixels = stbi_load(argv[2], &w, &h, &n, STBI_rgb_alpha);
+    if (pixels == NULL)
+    {
+        fprintf(stderr, "Failed to load image %s\n", argv[2]);
+        return EXIT_FAILURE;
+    }
+    unsigned int levels = ktx_chain_length(w, h);
+    if (levels > KTX_MAX_LEVELS)
+    {
+        fprintf(stderr, "Image %s is too large\n", argv[2]);
+        return EXIT_FAILURE;
+    }
+
+    // the levels below, filtered in linear light, after it
+    size_t chain_size = pixels_chain_size(w, h, levels);
+    unsigned char *chain = (unsigned char *) realloc(pixels, chain_size);
+    if (chain == NULL)
+    {
+        fprintf(stderr, "ERROR: Couldn't allocate the mip levels.\n");
+        return EXIT_FAILURE;
+    }
+    pixels_build_chain(chain, w, h, levels);
+
+    const void *data[KTX_MAX_LEVELS];
+    unsigned char *encoded[KTX_MAX_LEVELS] = { NULL };
+    const unsigned char *level = chain;
+    uint32_t lw = w, lh = h;
+    size_t bytes = 0;
+    for (unsigned int l = 0; l < levels; l++)
+    {
+        size_t size = ktx_level_size(vk_format, lw, lh);
+        data[l] = level;
+        if (vk_format == KTX_VK_FORMAT_ETC2_R8G8B8_UNORM)
+        {
+            encoded[l] = (unsigned char *) malloc(size);
+            if (encoded[l] == NULL)
+            {
+                fprintf(stderr, "ERROR: Couldn't allocate a mip level.\n");
+                return EXIT_FAILURE;
+            }
+            etc_encode(level, lw, lh, encoded[l]);
+            data[l] = encoded[l];
+        }
+        bytes += size;
+        level += (size_t) lw * lh * 4;
+        pixels_half_size(lw, lh, &lw, &lh);
+    }
+
+    int err = ktx_write(argv[3], vk_format, w, h, levels, data,
+                        "astro-pos texbake");
+    for (unsigned int l = 0; l < levels; l++)
+        free(encoded[l]);
+    free(chain);
+    if (err != 0)
+    {
+        fprintf(stderr, "Error writing %s\n", argv[3]);
+        return EXIT_FAILURE;
+    }
+
+    printf("%s: %dx%d, %u levels, %s, %zu bytes of levels\n",
+           argv[3], w, h, levels, argv[1], bytes);
+    return EXIT_SUCCESS;
+}
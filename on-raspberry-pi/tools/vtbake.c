@@ -0,0 +1,264 @@
+// Cuts a very large image into the tiled mip pyramid of a virtual texture
+// (see vtfile.h), for images that don't fit on the GPU in one piece.
+//
+//   vtbake etc2 world.200408.3x21600x10800.jpg textures/earth.vt
+//   vtbake rgba textures/earth.jpg textures/earth.vt 32
+//   vtbake etc2 -grid 4x2 world.200408.3x21600x21600.{A,B,C,D}1.jpg
+//          world.200408.3x21600x21600.{A,B,C,D}2.jpg textures/earth.vt
+//
+// stb_image decodes no more than 2 GB of RGBA at once, about 23k x 11.5k
+// pixels, so a bigger image is given as a grid of pieces of one size, row by
+// row from the top left, e.g. the 86400 x 43200 Blue Marble as its eight
+// 21600 x 21600 tiles. The pieces are decoded one at a time.
+//
+// Level 0 is resized to the power of two number of tiles nearest the image
+// size, or to tiles_x across when it is given. A level 0 pixel whose box
+// straddles two pieces is averaged from the first. The whole of level 0 is
+// held in memory, 4 bytes a pixel (8 GB for 64k x 32k, which takes a 64 bit
+// host), and a piece besides, so run it where there is that much.
+
+// the big pyramids go on past 2 GB, even from a 32 bit host
+#define _FILE_OFFSET_BITS 64
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+
+#include "vtfile.h"
+#include "ktx.h"
+#include "pixels.h"
+#include "etc.h"
+
+// The power of two nearest n, in steps of doubling.
+static uint32_t nearest_power_of_two(double n)
+{
+    int shift = n > 1.0 ? (int) floor(log2(n) + 0.5) : 0;
+    return 1u << (shift < 20 ? shift : 20);
+}
+
+// One tile with its border, wrapping around in x and clamped in y.
+static void cut_tile(const unsigned char *level,
+                     uint32_t width,
+                     uint32_t height,
+                     uint32_t tx,
+                     uint32_t ty,
+                     unsigned char *tile)
+{
+    for (int y = 0; y < VT_PHYSICAL; y++)
+    {
+        int64_t sy = (int64_t) ty * VT_TILE_SIZE + y - VT_BORDER;
+        sy = sy < 0 ? 0 : sy >= height ? height - 1 : sy;
+        for (int x = 0; x < VT_PHYSICAL; x++)
+        {
+            int64_t sx = (int64_t) tx * VT_TILE_SIZE + x - VT_BORDER;
+            sx = (sx + width) % width;
+            memcpy(&tile[(y * VT_PHYSICAL + x) * 4],
+                   &level[((size_t) sy * width + sx) * 4],
+                   4);
+        }
+    }
+}
+
+static unsigned char *load_piece(const char *file)
+{
+    int w, h, n;
+    unsigned char *piece = stbi_load(file, &w, &h, &n, STBI_rgb_alpha);
+    if (piece == NULL)
+        fprintf(stderr,
+                "Failed to load image %s (%s); past 2 GB of RGBA, give it "
+                "as a -grid of pieces\n",
+                file, stbi_failure_reason());
+    return piece;
+}
+
+int main(int argc, char **argv)
+{
+    // vtbake format [-grid CxR] image... output [tiles_x]
+    uint32_t columns = 1;
+    uint32_t rows = 1;
+    int next = 2;
+    if (argc > 3 && strcmp(argv[2], "-grid") == 0)
+    {
+        if (sscanf(argv[3], "%ux%u", &columns, &rows) != 2 ||
+            columns == 0 || rows == 0 || columns * rows > 1024)
+            columns = rows = 0;
+        next = 4;
+    }
+    char **pieces = &argv[next];
+    int after = next + (int) (columns * rows);
+    if (columns == 0 || (argc != after + 1 && argc != after + 2) ||
+        (strcmp(argv[1], "etc2") != 0 && strcmp(argv[1], "rgba") != 0))
+    {
+        fprintf(stderr,
+                "usage: %s etc2|rgba [-grid <columns>x<rows>] <image>... "
+                "<output.vt> [tiles_x]\n",
+                argv[0]);
+        return EXIT_FAILURE;
+    }
+    const char *output = argv[after];
+    uint32_t vk_format = strcmp(argv[1], "etc2") == 0
+                         ? KTX_VK_FORMAT_ETC2_R8G8B8_UNORM
+                         : KTX_VK_FORMAT_R8G8B8A8_UNORM;
+
+    // the headers alone, to size the whole
+    int piece_w = 0, piece_h = 0;
+    for (uint32_t i = 0; i < columns * rows; i++)
+    {
+        int w, h, n;
+        if (!stbi_info(pieces[i], &w, &h, &n))
+        {
+            fprintf(stderr, "Failed to read image %s\n", pieces[i]);
+            return EXIT_FAILURE;
+        }
+        if (i > 0 && (w != piece_w || h != piece_h))
+        {
+            fprintf(stderr, "%s is %d x %d, not %d x %d like %s\n",
+                    pieces[i], w, h, piece_w, piece_h, pieces[0]);
+            return EXIT_FAILURE;
+        }
+        piece_w = w;
+        piece_h = h;
+    }
+    uint64_t w = (uint64_t) piece_w * columns;
+    uint64_t h = (uint64_t) piece_h * rows;
+    if (w > UINT32_MAX || h > UINT32_MAX)
+    {
+        fprintf(stderr, "The image is too large\n");
+        return EXIT_FAILURE;
+    }
+
+    uint32_t tiles_x = argc == after + 2 ? (uint32_t) atoi(argv[after + 1])
+                                         : nearest_power_of_two((double) w /
+                                                                VT_TILE_SIZE);
+    uint32_t tiles_y = nearest_power_of_two((double) tiles_x * h / w);
+    vt_header hdr;
+    if (vt_header_init(&hdr, vk_format, tiles_x, tiles_y) != 0)
+    {
+        fprintf(stderr, "Can't make %u x %u tiles\n", tiles_x, tiles_y);
+        return EXIT_FAILURE;
+    }
+
+    uint32_t width = tiles_x * VT_TILE_SIZE;
+    uint32_t height = tiles_y * VT_TILE_SIZE;
+    unsigned char *image = NULL;
+    unsigned char *level = NULL;
+    if (columns * rows == 1 && width == w && height == h)
+    {
+        // used as it is
+        image = load_piece(pieces[0]);
+        if (image == NULL)
+            return EXIT_FAILURE;
+        level = image;
+    }
+    else
+    {
+        uint64_t level_bytes = (uint64_t) width * height * 4;
+        if (level_bytes <= SIZE_MAX)
+            level = (unsigned char *) malloc((size_t) level_bytes);
+        if (level == NULL)
+        {
+            fprintf(stderr, "ERROR: Couldn't allocate level 0.\n");
+            return EXIT_FAILURE;
+        }
+        for (uint32_t i = 0; i < columns * rows; i++)
+        {
+            unsigned char *piece = load_piece(pieces[i]);
+            if (piece == NULL)
+                return EXIT_FAILURE;
+            pixels_resize_part(piece, piece_w, piece_h,
+                               (i % columns) * piece_w,
+                               (i / columns) * piece_h,
+                               (uint32_t) w, (uint32_t) h,
+                               level, width, height);
+            stbi_image_free(piece);
+        }
+    }
+
+    FILE *fp = fopen(output, "wb");
+    if (fp == NULL)
+    {
+        fprintf(stderr, "Couldn't create %s\n", output);
+        return EXIT_FAILURE;
+    }
+    int err = fwrite(&hdr, sizeof(hdr), 1, fp) != 1;
+
+    unsigned char *tile = (unsigned char *)
+        malloc(VT_PHYSICAL * VT_PHYSICAL * 4);
+    unsigned char *encoded = (unsigned char *) malloc(hdr.tile_bytes);
+    if (tile == NULL || encoded == NULL)
+    {
+        fprintf(stderr, "ERROR: Couldn't allocate a tile.\n");
+        return EXIT_FAILURE;
+    }
+
+    uint64_t tile_count = 0;
+    for (uint32_t l = 0; l < hdr.levels && err == 0; l++)
+    {
+        if (l > 0)
+        {
+            // halve both ways in linear light while there are tiles to
+            // halve; once one side is a single tile only the other shrinks
+            uint32_t next_width = vt_level_tiles_x(&hdr, l) * VT_TILE_SIZE;
+            uint32_t next_height = vt_level_tiles_y(&hdr, l) * VT_TILE_SIZE;
+            unsigned char *next = (unsigned char *)
+                malloc((size_t) next_width * next_height * 4);
+            if (next == NULL)
+            {
+                fprintf(stderr, "ERROR: Couldn't allocate level %u.\n", l);
+                return EXIT_FAILURE;
+            }
+            if (next_width == width / 2 && next_height == height / 2)
+                pixels_downsample_srgb(level, width, height, next);
+            else
+                pixels_resize_rgba(level, width, height,
+                                   next, next_width, next_height);
+
+            if (level == image)
+                stbi_image_free(image);
+            else
+                free(level);
+            level = next;
+            width = next_width;
+            height = next_height;
+        }
+
+        for (uint32_t ty = 0; ty < vt_level_tiles_y(&hdr, l) && !err; ty++)
+        {
+            for (uint32_t tx = 0; tx < vt_level_tiles_x(&hdr, l); tx++)
+            {
+                cut_tile(level, width, height, tx, ty, tile);
+                const unsigned char *data = tile;
+                if (vk_format == KTX_VK_FORMAT_ETC2_R8G8B8_UNORM)
+                {
+                    etc_encode(tile, VT_PHYSICAL, VT_PHYSICAL, encoded);
+                    data = encoded;
+                }
+                err |= fwrite(data, hdr.tile_bytes, 1, fp) != 1;
+                tile_count++;
+            }
+        }
+    }
+
+    free(tile);
+    free(encoded);
+    if (level == image)
+        stbi_image_free(image);
+    else
+        free(level);
+
+    if (fclose(fp) != 0 || err != 0)
+    {
+        fprintf(stderr, "Error writing %s\n", output);
+        remove(output);
+        return EXIT_FAILURE;
+    }
+
+    printf("%s: %u x %u tiles of %d, %u levels, %s, %llu tiles\n",
+           output, tiles_x, tiles_y, VT_TILE_SIZE, hdr.levels, argv[1],
+           (unsigned long long) tile_count);
+    return EXIT_SUCCESS;
+}
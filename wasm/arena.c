@@ -0,0 +1,127 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "arena.h"
+#include "memstats.h"
+
+#define KB  1024.0
+
+static const char *const category_names[ARENA_CATEGORIES] = {
+    "objects",
+    "meshes",
+    "scratch"
+};
+
+// The block's bytes start after its header, on an ARENA_ALIGN boundary.
+#define BLOCK_HEADER \
+    ((sizeof(arena_block) + ARENA_ALIGN - 1) & ~(size_t) (ARENA_ALIGN - 1))
+
+static unsigned char *block_data(arena_block *block)
+{
+    return (unsigned char *) block + BLOCK_HEADER;
+}
+
+static void free_blocks(arena *a, arena_block *until)
+{
+    while (a->blocks != until)
+    {
+        arena_block *block = a->blocks;
+        a->blocks = block->next;
+        a->reserved -= block->size;
+        memstats_sub(a->mem_asset, MEM_HEAP, BLOCK_HEADER + block->size);
+        free(block);
+    }
+}
+
+void arena_init(arena *a, const char *name)
+{
+    memset(a, 0, sizeof(*a));
+    a->name = name;
+    a->mem_asset = memstats_asset(name);
+}
+
+void arena_destroy(arena *a)
+{
+    free_blocks(a, NULL);
+    memset(a->bytes, 0, sizeof(a->bytes));
+}
+
+void *arena_alloc(arena *a, size_t size, arena_category category)
+{
+    size = (size + ARENA_ALIGN - 1) & ~(size_t) (ARENA_ALIGN - 1);
+
+    arena_block *block = a->blocks;
+    if (block == NULL || block->size - block->used < size)
+    {
+        // anything bigger than a block gets one of its own
+        size_t block_size = size > ARENA_BLOCK_SIZE ? size : ARENA_BLOCK_SIZE;
+        block = (arena_block *) malloc(BLOCK_HEADER + block_size);
+        if (block == NULL)
+        {
+            fprintf(stderr, "ERROR: Couldn't allocate %zu bytes in %s.",
+                    size, a->name);
+            exit(EXIT_FAILURE);
+        }
+        block->next = a->blocks;
+        block->size = block_size;
+        block->used = 0;
+        a->blocks = block;
+        a->reserved += block_size;
+        memstats_add(a->mem_asset, MEM_HEAP, BLOCK_HEADER + block_size);
+        if (a->reserved > a->peak_reserved)
+            a->peak_reserved = a->reserved;
+    }
+
+    void *p = block_data(block) + block->used;
+    block->used += size;
+    memset(p, 0, size);
+
+    a->bytes[category] += size;
+    a->allocations[category]++;
+    if (a->bytes[category] > a->peak[category])
+        a->peak[category] = a->bytes[category];
+    return p;
+}
+
+void arena_reset(arena *a)
+{
+    // the oldest block stays, the rest go
+    arena_block *first = a->blocks;
+    while (first && first->next)
+        first = first->next;
+    if (first)
+    {
+        free_blocks(a, first);
+        first->used = 0;
+    }
+    memset(a->bytes, 0, sizeof(a->bytes));
+}
+
+arena_mark arena_save(const arena *a)
+{
+    arena_mark mark;
+
+    mark.block = a->blocks;
+    mark.used = a->blocks ? a->blocks->used : 0;
+    memcpy(mark.bytes, a->bytes, sizeof(mark.bytes));
+    return mark;
+}
+
+void arena_rewind(arena *a, arena_mark mark)
+{
+    free_blocks(a, mark.block);
+    if (mark.block)
+        mark.block->used = mark.used;
+    memcpy(a->bytes, mark.bytes, sizeof(a->bytes));
+}
+
+void arena_report(const arena *a)
+{
+    fprintf(stderr, "memory %s: %.1f KB in blocks, at most %.1f KB\n",
+            a->name, a->reserved / KB, a->peak_reserved / KB);
+    for (unsigned int c = 0; c < ARENA_CATEGORIES; c++)
+        fprintf(stderr, "  %-8s %8.1f KB, at most %8.1f KB, %lu allocations\n",
+                category_names[c], a->bytes[c] / KB, a->peak[c] / KB,
+                a->allocations[c]);
+}
@@ -0,0 +1,68 @@
+#ifndef ASTRO_ARENA_H
+#define ASTRO_ARENA_H
+
+#include <stddef.h>
+
+// Bump allocator for the CPU side of a scene: its objects, and whatever they
+// keep of the meshes they were made from. Nothing in it is freed on its own;
+// arena_reset() drops everything at once, e.g. to load another scene, and
+// arena_destroy() gives the memory back.
+//
+// Temporaries, such as a mesh generated only to be uploaded, go in between
+// arena_save() and arena_rewind(), which frees what was allocated since the
+// mark. Every allocation is counted in a category, and arena_report() prints
+// the bytes in each and the most there ever were.
+#define ARENA_BLOCK_SIZE    (64 * 1024)
+#define ARENA_ALIGN         16
+
+typedef enum ArenaCategory
+{
+    ARENA_OBJECTS,
+    ARENA_MESHES,               // CPU copies of meshes kept after upload
+    ARENA_SCRATCH,              // rewound once used
+    ARENA_CATEGORIES
+} arena_category;
+
+typedef struct ArenaBlock
+{
+    struct ArenaBlock *next;    // the one before it
+    size_t size;
+    size_t used;
+} arena_block;
+
+typedef struct Arena
+{
+    const char *name;
+    arena_block *blocks;        // newest first
+    size_t reserved;            // of the blocks
+    size_t peak_reserved;
+    size_t bytes[ARENA_CATEGORIES];
+    size_t peak[ARENA_CATEGORIES];
+    unsigned long allocations[ARENA_CATEGORIES];
+    unsigned int mem_asset;     // the blocks, in memstats
+} arena;
+
+typedef struct ArenaMark
+{
+    arena_block *block;
+    size_t used;
+    size_t bytes[ARENA_CATEGORIES];
+} arena_mark;
+
+void arena_init(arena *a, const char *name);
+void arena_destroy(arena *a);
+
+// size bytes, zeroed and ARENA_ALIGN aligned, until the arena is reset.
+// Exits if there is no memory, as a scene can't do without it.
+void *arena_alloc(arena *a, size_t size, arena_category category);
+
+// Free everything, keeping one block for the next scene.
+void arena_reset(arena *a);
+
+arena_mark arena_save(const arena *a);
+// Free what was allocated since mark.
+void arena_rewind(arena *a, arena_mark mark);
+
+void arena_report(const arena *a);
+
+#endif
@@ -0,0 +1,201 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "asset.h"
+#include "lz4.h"
+#include "memstats.h"
+
+static struct
+{
+    asset_span file;
+    const asset_pack_header *header;
+    const asset_entry *entries;
+} pack;
+
+// Map filename whole, or read it where it can't be mapped.
+static int map_file(const char *filename, asset_span *span)
+{
+    memset(span, 0, sizeof(*span));
+
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0)
+        return -1;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0)
+    {
+        close(fd);
+        return -1;
+    }
+    span->size = (size_t) st.st_size;
+
+    void *base = mmap(NULL, span->size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (base != MAP_FAILED)
+    {
+        span->owned = base;
+        span->mapped = true;
+    }
+    else
+    {
+        // no mmap for this file system; fall back to one read
+        span->owned = malloc(span->size);
+        if (span->owned == NULL ||
+            read(fd, span->owned, span->size) != (ssize_t) span->size)
+        {
+            fprintf(stderr, "Error reading %s\n", filename);
+            free(span->owned);
+            close(fd);
+            memset(span, 0, sizeof(*span));
+            return -1;
+        }
+    }
+    close(fd);
+
+    span->data = (const unsigned char *) span->owned;
+    span->mem_asset = memstats_asset(filename);
+    memstats_add(span->mem_asset, span->mapped ? MEM_MAPPED : MEM_HEAP,
+                 span->size);
+    return 0;
+}
+
+static int pack_validate(const char *filename)
+{
+    const asset_pack_header *hdr = (const asset_pack_header *) pack.file.data;
+    size_t size = pack.file.size;
+
+    if (size < sizeof(*hdr) || memcmp(hdr->magic, ASSET_MAGIC, 4) != 0)
+    {
+        fprintf(stderr, "%s is not an asset pack\n", filename);
+        return -1;
+    }
+    if (hdr->version != ASSET_VERSION)
+    {
+        fprintf(stderr,
+                "%s has asset pack version %u, expected %u\n",
+                filename, hdr->version, ASSET_VERSION);
+        return -1;
+    }
+    if (hdr->file_size != size ||
+        hdr->entry_offset > size ||
+        hdr->entry_count > (size - hdr->entry_offset) / sizeof(asset_entry))
+    {
+        fprintf(stderr, "%s has a corrupt asset pack header\n", filename);
+        return -1;
+    }
+
+    const asset_entry *entries =
+        (const asset_entry *) (pack.file.data + hdr->entry_offset);
+    for (uint32_t i = 0; i < hdr->entry_count; i++)
+    {
+        const asset_entry *e = &entries[i];
+        if (e->offset % ASSET_ALIGN || e->offset > size ||
+            e->size > size - e->offset ||
+            (e->compression == ASSET_STORED &&
+             e->size != e->uncompressed_size) ||
+            (e->compression != ASSET_STORED &&
+             e->compression != ASSET_LZ4) ||
+            memchr(e->name, 0, ASSET_NAME_LEN) == NULL ||
+            (i > 0 && strcmp(entries[i - 1].name, e->name) >= 0))
+        {
+            fprintf(stderr, "%s: asset entry %u is corrupt\n", filename, i);
+            return -1;
+        }
+    }
+
+    pack.header = hdr;
+    pack.entries = entries;
+    return 0;
+}
+
+int asset_pack_open(const char *filename)
+{
+    if (map_file(filename, &pack.file) != 0)
+        return -1;
+    if (pack_validate(filename) != 0)
+    {
+        asset_pack_close();
+        return -1;
+    }
+    return 0;
+}
+
+void asset_pack_close(void)
+{
+    asset_release(&pack.file);
+    memset(&pack, 0, sizeof(pack));
+}
+
+static int compare_entry(const void *name, const void *entry)
+{
+    return strcmp((const char *) name, ((const asset_entry *) entry)->name);
+}
+
+static const asset_entry *find(const char *name)
+{
+    if (pack.header == NULL)
+        return NULL;
+    return (const asset_entry *) bsearch(name,
+                                         pack.entries,
+                                         pack.header->entry_count,
+                                         sizeof(asset_entry),
+                                         compare_entry);
+}
+
+int asset_load(const char *name, asset_span *span)
+{
+    const asset_entry *e = find(name);
+    if (e == NULL)
+        return map_file(name, span);
+
+    memset(span, 0, sizeof(*span));
+    const unsigned char *data = pack.file.data + e->offset;
+    if (e->compression == ASSET_STORED)
+    {
+        span->data = data;
+        span->size = e->size;
+        return 0;
+    }
+
+    unsigned char *out = (unsigned char *) malloc(e->uncompressed_size);
+    if (out == NULL)
+    {
+        fprintf(stderr, "ERROR: Couldn't allocate asset %s.", name);
+        exit(EXIT_FAILURE);
+    }
+    if (lz4_decode(data, e->size, out, e->uncompressed_size) != 0)
+    {
+        fprintf(stderr, "Asset %s is corrupt\n", name);
+        free(out);
+        return -1;
+    }
+    span->data = out;
+    span->size = e->uncompressed_size;
+    span->owned = out;
+    span->mem_asset = memstats_asset(name);
+    memstats_add(span->mem_asset, MEM_HEAP, span->size);
+    return 0;
+}
+
+void asset_release(asset_span *span)
+{
+    if (span->owned)
+    {
+        memstats_sub(span->mem_asset, span->mapped ? MEM_MAPPED : MEM_HEAP,
+                     span->size);
+        if (span->mapped)
+            munmap(span->owned, span->size);
+        else
+            free(span->owned);
+    }
+    memset(span, 0, sizeof(*span));
+}
+
+bool asset_exists(const char *name)
+{
+    return find(name) != NULL || access(name, R_OK) == 0;
+}
@@ -0,0 +1,74 @@
+#ifndef ASTRO_ASSET_H
+#define ASTRO_ASSET_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// The textures, shaders and meshes, packed into one file by packbake and
+// mapped once at startup (little endian, as on the Pi and in wasm):
+//
+//   asset_pack_header
+//   asset_entry[entry_count]       sorted by name
+//   entry data, each starting on an ASSET_ALIGN boundary
+//
+// Names are the paths the loose files have, e.g. "textures/moon.jpg". An
+// entry is stored as is, and then used in place in the mapping, or LZ4
+// compressed (see lz4.h) where that saves enough, and then expanded once
+// into memory of its own. Loaders take the bytes as a span, never a path,
+// so nothing is read or copied twice.
+//
+// A name missing from the pack, or every name without one, is mapped from
+// its loose file instead, so assets can be changed without repacking.
+#define ASSET_MAGIC         "APAK"
+#define ASSET_VERSION       1
+#define ASSET_ALIGN         64
+#define ASSET_NAME_LEN      64
+
+#define ASSET_STORED        0
+#define ASSET_LZ4           1
+
+typedef struct AssetPackHeader
+{
+    char magic[4];
+    uint32_t version;
+    uint32_t entry_count;
+    uint32_t entry_offset;
+    uint64_t file_size;
+    uint32_t reserved[2];
+} asset_pack_header;
+
+typedef struct AssetEntry
+{
+    char name[ASSET_NAME_LEN];
+    uint64_t offset;
+    uint64_t size;              // in the pack
+    uint64_t uncompressed_size;
+    uint32_t compression;       // ASSET_STORED or ASSET_LZ4
+    uint32_t reserved;
+} asset_entry;
+
+// The bytes of one asset, and what holds them.
+typedef struct AssetSpan
+{
+    const unsigned char *data;
+    size_t size;
+    void *owned;                // NULL for an entry used in place
+    bool mapped;                // owned is a mapping of size bytes
+    unsigned int mem_asset;     // what owned is counted against in memstats
+} asset_span;
+
+// Map the pack. Returns 0 on success, -1 if there is no such file or it
+// fails validation, in which case every asset comes from its loose file.
+// Call it before any thread loads an asset.
+int asset_pack_open(const char *filename);
+void asset_pack_close(void);
+
+// The bytes of the asset called name. Returns 0 on success, -1 if there is
+// no such asset, with span left empty.
+int asset_load(const char *name, asset_span *span);
+void asset_release(asset_span *span);
+
+bool asset_exists(const char *name);
+
+#endif
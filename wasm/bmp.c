@@ -0,0 +1,132 @@
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bmp.h"
+#include "pixfmt.h"
+
+#define FILE_HEADER_SIZE    14
+#define INFO_HEADER_SIZE    40      // BITMAPINFOHEADER; V4 and V5 add on
+#define BI_RGB              0
+#define BI_BITFIELDS        3
+#define MAX_DIMENSION       65536
+
+// The file is little endian, whatever the host.
+static uint32_t le16(const unsigned char *p)
+{
+    return p[0] | (uint32_t) p[1] << 8;
+}
+
+static uint32_t le32(const unsigned char *p)
+{
+    return p[0] | (uint32_t) p[1] << 8 | (uint32_t) p[2] << 16 |
+           (uint32_t) p[3] << 24;
+}
+
+// Whether 32 bit pixels carry alpha, going by the header's masks; -1 for
+// masks that aren't plain BGRA.
+static int masks_alpha(const unsigned char *data,
+                       size_t size,
+                       uint32_t header_size,
+                       uint32_t compression)
+{
+    if (compression == BI_RGB)
+        return 0;
+
+    // after a BITMAPINFOHEADER the colour masks follow it; the V4 and V5
+    // headers have them, and alpha's, inside
+    const unsigned char *masks = data + FILE_HEADER_SIZE + INFO_HEADER_SIZE;
+    size_t mask_count = header_size > INFO_HEADER_SIZE
+                        ? (header_size - INFO_HEADER_SIZE) / 4 : 3;
+    if (FILE_HEADER_SIZE + INFO_HEADER_SIZE + 12 > size || mask_count < 3)
+        return -1;
+    if (le32(masks) != 0x00ff0000 || le32(masks + 4) != 0x0000ff00 ||
+        le32(masks + 8) != 0x000000ff)
+        return -1;
+    if (mask_count < 4 || FILE_HEADER_SIZE + INFO_HEADER_SIZE + 16 > size)
+        return 0;
+    uint32_t alpha = le32(masks + 12);
+    return alpha == 0xff000000 ? 1 : alpha == 0 ? 0 : -1;
+}
+
+unsigned char *bmp_decode(const unsigned char *data,
+                          size_t size,
+                          const char *name,
+                          uint32_t *width,
+                          uint32_t *height)
+{
+    if (size < FILE_HEADER_SIZE + INFO_HEADER_SIZE ||
+        data[0] != 'B' || data[1] != 'M')
+    {
+        fprintf(stderr, "%s is not a BMP file\n", name);
+        return NULL;
+    }
+
+    const unsigned char *info = data + FILE_HEADER_SIZE;
+    uint32_t pixel_offset = le32(data + 10);
+    uint32_t header_size = le32(info);
+    int32_t w = (int32_t) le32(info + 4);
+    int32_t h = (int32_t) le32(info + 8);
+    uint32_t planes = le16(info + 12);
+    uint32_t bpp = le16(info + 14);
+    uint32_t compression = le32(info + 16);
+
+    int alpha = bpp == 32 ? masks_alpha(data, size, header_size, compression)
+                          : 0;
+    if (header_size < INFO_HEADER_SIZE || planes != 1 ||
+        (bpp != 24 && bpp != 32) || alpha < 0 ||
+        (compression != BI_RGB &&
+         (compression != BI_BITFIELDS || bpp != 32)) ||
+        w <= 0 || w > MAX_DIMENSION || h == 0 ||
+        h < -MAX_DIMENSION || h > MAX_DIMENSION)
+    {
+        fprintf(stderr,
+                "Unsupported BMP file %s: %u bits, compression %u\n",
+                name, bpp, compression);
+        return NULL;
+    }
+
+    // a positive height is stored bottom row first
+    bool bottom_up = h > 0;
+    uint32_t rows = bottom_up ? (uint32_t) h : (uint32_t) -h;
+    // rows are padded to 4 bytes; the sizes are worked out in 64 bits, as
+    // they overflow a 32 bit size_t long before MAX_DIMENSION
+    uint64_t stride = ((uint64_t) w * bpp + 31) / 32 * 4;
+    uint64_t pixel_bytes = (uint64_t) w * rows * 4;
+    if (pixel_bytes > SIZE_MAX)
+    {
+        fprintf(stderr, "BMP file %s is too large\n", name);
+        return NULL;
+    }
+    if (pixel_offset > size || stride * rows > size - pixel_offset)
+    {
+        fprintf(stderr, "Truncated BMP file %s\n", name);
+        return NULL;
+    }
+
+    unsigned char *pixels = (unsigned char *) malloc((size_t) pixel_bytes);
+    if (pixels == NULL)
+    {
+        fprintf(stderr, "ERROR: Couldn't allocate BMP %s.", name);
+        exit(EXIT_FAILURE);
+    }
+
+    const unsigned char *src = data + pixel_offset;
+    for (uint32_t y = 0; y < rows; y++, src += stride)
+    {
+        uint32_t row = bottom_up ? rows - 1 - y : y;
+        unsigned char *dst = pixels + (size_t) row * w * 4;
+        if (bpp == 24)
+            pixfmt_bgr_to_rgba(src, dst, w);
+        else if (alpha)
+            pixfmt_bgra_to_rgba(src, dst, w);
+        else
+            pixfmt_bgrx_to_rgba(src, dst, w);
+    }
+
+    *width = (uint32_t) w;
+    *height = rows;
+    return pixels;
+}
@@ -0,0 +1,22 @@
+#ifndef ASTRO_BMP_H
+#define ASTRO_BMP_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Uncompressed 24 and 32 bit BMP files, bottom-up or top-down.
+//
+// The rows are converted to RGBA8 straight from the file's bytes into their
+// place in the image, top row first, in one pass: the row padding is
+// stepped over and a bottom-up file is turned the right way up as it goes.
+// 32 bit files are opaque unless their header has an alpha mask.
+
+// Decode the size bytes at data. Returns the pixels, malloc()ed, or NULL if
+// data isn't a BMP this takes; name is for the messages.
+unsigned char *bmp_decode(const unsigned char *data,
+                          size_t size,
+                          const char *name,
+                          uint32_t *width,
+                          uint32_t *height);
+
+#endif
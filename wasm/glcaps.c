@@ -0,0 +1,117 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "glcaps.h"
+
+gl_caps caps;
+
+bool glcaps_has_extension(const char *name)
+{
+    const char *exts = (const char *) glGetString(GL_EXTENSIONS);
+    size_t len = strlen(name);
+
+    while (exts && (exts = strstr(exts, name)) != NULL)
+    {
+        if (exts[len] == ' ' || exts[len] == '\0')
+            return true;
+        exts += len;
+    }
+    return false;
+}
+
+// ASTRO_GL_DISABLE is a comma separated list of feature names to ignore.
+static bool disabled(const char *name)
+{
+    const char *list = getenv("ASTRO_GL_DISABLE");
+    size_t len = strlen(name);
+
+    while (list && *list)
+    {
+        if (strncmp(list, name, len) == 0 &&
+            (list[len] == ',' || list[len] == '\0'))
+            return true;
+        list = strchr(list, ',');
+        if (list)
+            list++;
+    }
+    return false;
+}
+
+void glcaps_init(void)
+{
+    const char *version = (const char *) glGetString(GL_VERSION);
+
+    memset(&caps, 0, sizeof(caps));
+    caps.es3 = version && strstr(version, "OpenGL ES 3") != NULL;
+
+    // the UBO shaders are GLSL ES 3.00, so they need ES3 shading as well
+    #ifdef __EMSCRIPTEN__
+    // WebGL1 extensions are mapped onto the WebGL2 entry points
+    caps.vao = caps.es3 || glcaps_has_extension("GL_OES_vertex_array_object");
+    caps.ubo = caps.es3;
+    caps.instancing = caps.es3 ||
+                      glcaps_has_extension("GL_ANGLE_instanced_arrays");
+    caps.texture_array = caps.es3;
+    // WebGL never exposes program binaries
+    caps.program_binary = false;
+    caps.parallel_compile =
+        glcaps_has_extension("GL_KHR_parallel_shader_compile");
+    // not part of WebGL2, unlike GLES3
+    caps.etc2 = glcaps_has_extension("GL_WEBGL_compressed_texture_etc");
+    // WebGL1 samples NPOT textures only without mips and clamped
+    caps.npot = caps.es3;
+    caps.base_level = caps.es3;
+    bool anisotropic =
+        glcaps_has_extension("GL_EXT_texture_filter_anisotropic");
+    #else
+    caps.vao = GLAD_GL_ARB_vertex_array_object;
+    caps.ubo = caps.es3 ||
+               (GLAD_GL_ARB_uniform_buffer_object &&
+                GLAD_GL_ARB_ES3_compatibility);
+    caps.instancing = GLAD_GL_ARB_instanced_arrays &&
+                      GLAD_GL_ARB_draw_instanced;
+    caps.texture_array = GLAD_GL_EXT_texture_array;
+    caps.program_binary = GLAD_GL_ARB_get_program_binary;
+    caps.parallel_compile = GLAD_GL_KHR_parallel_shader_compile ||
+                            GLAD_GL_ARB_parallel_shader_compile;
+    caps.etc2 = caps.es3 || GLAD_GL_ARB_ES3_compatibility;
+    // core since GL 2.0
+    caps.npot = true;
+    // core since GL 1.2
+    caps.base_level = true;
+    bool anisotropic = GLAD_GL_EXT_texture_filter_anisotropic ||
+                       GLAD_GL_ARB_texture_filter_anisotropic;
+    #endif
+
+    caps.vao = caps.vao && !disabled("vao");
+    caps.ubo = caps.ubo && !disabled("ubo");
+    caps.instancing = caps.instancing && !disabled("instancing");
+    caps.texture_array = caps.texture_array && !disabled("texture_array");
+    caps.program_binary = caps.program_binary && !disabled("program_binary");
+    caps.parallel_compile = caps.parallel_compile &&
+                            !disabled("parallel_compile");
+    caps.etc2 = caps.etc2 && !disabled("etc2");
+    caps.npot = caps.npot && !disabled("npot");
+    caps.base_level = caps.base_level && !disabled("base_level");
+    if (anisotropic && !disabled("anisotropy"))
+        glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT, &caps.anisotropy);
+
+    // the uniform buffer body shaders sample the texture array, and the
+    // GLSL ES 1.00 ones can't, so the two go together
+    caps.ubo = caps.texture_array = caps.ubo && caps.texture_array;
+
+    fprintf(stderr,
+            "GL: %s,%s%s%s%s%s%s%s%s%s, anisotropy %.0f\n",
+            version ? version : "unknown version",
+            caps.vao ? " vao" : "",
+            caps.ubo ? " ubo" : "",
+            caps.instancing ? " instancing" : "",
+            caps.texture_array ? " texture_array" : "",
+            caps.program_binary ? " program_binary" : "",
+            caps.parallel_compile ? " parallel_compile" : "",
+            caps.etc2 ? " etc2" : "",
+            caps.npot ? " npot" : "",
+            caps.base_level ? " base_level" : "",
+            caps.anisotropy);
+}
@@ -0,0 +1,54 @@
+#ifndef ASTRO_GLCAPS_H
+#define ASTRO_GLCAPS_H
+
+#include <stdbool.h>
+
+#ifdef __EMSCRIPTEN__
+#include <GLES3/gl3.h>
+#include <GLES2/gl2ext.h>
+#else
+#include <glad/glad.h>
+#endif
+
+// Instancing entry points: core on GLES3 / WebGL2, where emscripten also maps
+// WebGL1's ANGLE_instanced_arrays onto them, and ARB on the Pi's desktop GL.
+#ifdef __EMSCRIPTEN__
+#define glcaps_vertex_attrib_divisor    glVertexAttribDivisor
+#define glcaps_draw_elements_instanced  glDrawElementsInstanced
+#else
+#define glcaps_vertex_attrib_divisor    glVertexAttribDivisorARB
+#define glcaps_draw_elements_instanced  glDrawElementsInstancedARB
+#endif
+
+// KHR_parallel_shader_compile and ARB_parallel_shader_compile share it
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR        0x91B1
+#endif
+
+// Optional GL features, detected once the context is current.
+//
+// The wasm build asks for WebGL2 and may end up on WebGL1; the Pi build runs
+// a desktop GL 2.1 context through glad, where these come from extensions.
+// Any of them can be switched off for comparison runs with e.g.
+//   ASTRO_GL_DISABLE=vao ./bin/astro-pos
+typedef struct GLCaps
+{
+    bool es3;       // GLES3 / WebGL2 context
+    bool vao;       // vertex array objects
+    bool ubo;       // uniform buffers, with GLSL ES 3.00 shaders
+    bool instancing;    // instanced arrays and instanced draws
+    bool texture_array; // GL_TEXTURE_2D_ARRAY
+    bool program_binary;    // glGetProgramBinary / glProgramBinary
+    bool parallel_compile;  // non-blocking GL_COMPLETION_STATUS_KHR queries
+    bool etc2;      // GL_COMPRESSED_RGB8_ETC2 textures
+    bool npot;      // mipmapped, repeating non-power-of-two textures
+    bool base_level;    // GL_TEXTURE_BASE_LEVEL, to sample part of a chain
+    float anisotropy;   // most anisotropic filtering, 0 for none
+} gl_caps;
+
+extern gl_caps caps;
+
+void glcaps_init(void);
+bool glcaps_has_extension(const char *name);
+
+#endif
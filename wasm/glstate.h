@@ -0,0 +1,50 @@
+#ifndef ASTRO_GLSTATE_H
+#define ASTRO_GLSTATE_H
+
+#include "glcaps.h"
+
+// Thin cache over the GL binding and enable state used by astro-pos.
+//
+// All code binds programs, buffers, vertex arrays and textures through these
+// calls, so a change that matches the cached value is never sent to the
+// driver. Nothing is unbound after use; the next user just binds what it
+// needs. Issued and elided calls are counted in glstats.
+//
+// The element array binding belongs to the bound vertex array, so binding a
+// VAO makes it unknown, and uploads of index data must bind VAO 0 first.
+#define GLS_TEXTURE_UNITS 4
+
+// Forget all cached state; call after glcaps_init() and whenever GL state
+// may have been changed behind the cache's back.
+void gls_reset(void);
+
+void gls_use_program(GLuint program);
+void gls_bind_vertex_array(GLuint vao);
+void gls_bind_buffer(GLenum target, GLuint buffer);
+void gls_bind_buffer_range(GLenum target,
+                           GLuint index,
+                           GLuint buffer,
+                           GLintptr offset,
+                           GLsizeiptr size);
+void gls_active_texture(GLenum unit);
+void gls_bind_texture(GLenum target, GLuint texture);
+void gls_enable(GLenum cap);
+void gls_disable(GLenum cap);
+void gls_viewport(GLint x, GLint y, GLsizei width, GLsizei height);
+
+// Enable exactly the generic attribute arrays in mask (bit n = location n)
+// on VAO 0, disabling those left enabled by the previous user. With another
+// VAO bound, the arrays in mask are enabled as it is being recorded.
+void gls_vertex_attrib_arrays(unsigned int mask);
+
+// Same for the per-instance arrays (divisor 1) among them; the others get
+// divisor 0. Only used with caps.instancing.
+void gls_vertex_attrib_divisors(unsigned int mask);
+
+// Deleting a bound object unbinds it, so deletes go through the cache too.
+void gls_delete_program(GLuint program);
+void gls_delete_vertex_array(GLuint vao);
+void gls_delete_buffer(GLuint buffer);
+void gls_delete_texture(GLuint texture);
+
+#endif
@@ -0,0 +1,29 @@
+#ifndef ASTRO_GLSTATS_H
+#define ASTRO_GLSTATS_H
+
+// Per-frame GL call counters for profiling the draw path.
+//
+// Calls made through GL_CALL() and the glstate cache are counted, along with
+// the calls the cache found redundant and dropped. With ASTRO_GL_STATS set in
+// the environment the averages are printed every GL_STATS_INTERVAL frames.
+#define GL_STATS_INTERVAL 300
+
+typedef struct GLStats
+{
+    unsigned long calls;        // GL calls issued this frame
+    unsigned long draws;        // of which draw calls
+    unsigned long elided;       // redundant state changes not issued
+    unsigned long total_calls;
+    unsigned long total_draws;
+    unsigned long total_elided;
+    unsigned long frames;
+} gl_stats;
+
+extern gl_stats glstats;
+
+#define GL_CALL(call) (glstats.calls++, call)
+#define GL_DRAW(call) (glstats.calls++, glstats.draws++, call)
+
+void glstats_frame_end(void);
+
+#endif
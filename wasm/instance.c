@@ -0,0 +1,144 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "instance.h"
+#include "shader.h"
+#include "glstate.h"
+#include "glstats.h"
+#include "memstats.h"
+
+static GLuint buffer;
+// a mat4, so this and the next 3
+static const GLint model_loc = SHADER_ATTRIB_INSTANCE_MODEL_VIEW;
+static const GLint params_loc = SHADER_ATTRIB_INSTANCE_PARAMS;
+static int pointer_first = -1;  // instance the arrays currently start at
+
+// without instancing the instances are kept for the per-instance draws
+static instance_data staging[INSTANCE_MAX];
+
+void instance_init(void)
+{
+    pointer_first = -1;
+
+    if (!caps.instancing)
+        return;
+
+    glGenBuffers(1, &buffer);
+    gls_bind_buffer(GL_ARRAY_BUFFER, buffer);
+    glBufferData(GL_ARRAY_BUFFER,
+                 sizeof(instance_data) * INSTANCE_MAX,
+                 NULL,
+                 GL_STREAM_DRAW);
+    memstats_gl(MEM_BUFFER, buffer, "instances",
+                sizeof(instance_data) * INSTANCE_MAX);
+}
+
+void instance_destroy(void)
+{
+    if (!caps.instancing)
+        return;
+
+    gls_delete_buffer(buffer);
+    buffer = 0;
+}
+
+unsigned int instance_attrib_mask(void)
+{
+    if (!caps.instancing)
+        return 0;
+
+    return (0xfu << model_loc) | (1u << params_loc);
+}
+
+void instance_attribs(unsigned int first)
+{
+    if (!caps.instancing)
+        return;
+
+    GLintptr base = first * sizeof(instance_data);
+
+    gls_bind_buffer(GL_ARRAY_BUFFER, buffer);
+    for (int c = 0; c < 4; c++)
+    {
+        GL_CALL(glVertexAttribPointer(model_loc + c,
+                                      4,
+                                      GL_FLOAT,
+                                      GL_FALSE,
+                                      sizeof(instance_data),
+                                      (const GLvoid *)(base +
+                                          offsetof(instance_data, model_view) +
+                                          c * sizeof(vec4))));
+    }
+    GL_CALL(glVertexAttribPointer(params_loc,
+                                  3,
+                                  GL_FLOAT,
+                                  GL_FALSE,
+                                  sizeof(instance_data),
+                                  (const GLvoid *)(base +
+                                      offsetof(instance_data, params))));
+    pointer_first = first;
+}
+
+void instance_upload(const instance_data *instances, unsigned int count)
+{
+    if (count > INSTANCE_MAX)
+    {
+        fprintf(stderr, "WARNING: only %d instances fit the buffer\n",
+                INSTANCE_MAX);
+        count = INSTANCE_MAX;
+    }
+
+    if (!caps.instancing)
+    {
+        memcpy(staging, instances, count * sizeof(*instances));
+        return;
+    }
+
+    // re-specifying the store, at the size it was made and counted at,
+    // orphans last frame's copy instead of waiting for draws still reading
+    // it; this frame's instances go into the new one
+    gls_bind_buffer(GL_ARRAY_BUFFER, buffer);
+    GL_CALL(glBufferData(GL_ARRAY_BUFFER,
+                         sizeof(instance_data) * INSTANCE_MAX,
+                         NULL,
+                         GL_STREAM_DRAW));
+    GL_CALL(glBufferSubData(GL_ARRAY_BUFFER,
+                            0,
+                            count * sizeof(*instances),
+                            instances));
+}
+
+void instance_draw(GLsizei index_count,
+                   GLenum index_type,
+                   unsigned int first,
+                   unsigned int count)
+{
+    if (caps.instancing)
+    {
+        // ES3 has no base instance, so a batch further in moves the arrays
+        if (pointer_first != (int) first)
+            instance_attribs(first);
+
+        GL_DRAW(glcaps_draw_elements_instanced(GL_TRIANGLES,
+                                               index_count,
+                                               index_type,
+                                               (void *)0,
+                                               count));
+        return;
+    }
+
+    for (unsigned int i = first; i < first + count; i++)
+    {
+        for (int c = 0; c < 4; c++)
+            GL_CALL(glVertexAttrib4fv(model_loc + c,
+                                      staging[i].model_view[c]));
+        GL_CALL(glVertexAttrib4fv(params_loc, staging[i].params));
+
+        GL_DRAW(glDrawElements(GL_TRIANGLES,
+                               index_count,
+                               index_type,
+                               (void *)0));
+    }
+}
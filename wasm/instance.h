@@ -0,0 +1,47 @@
+#ifndef ASTRO_INSTANCE_H
+#define ASTRO_INSTANCE_H
+
+#include <cglm/cglm.h>
+
+#include "glcaps.h"
+
+// Per-instance data of the bodies, which are all drawn from one shared unit
+// sphere.
+//
+// With caps.instancing the instances of a frame are streamed into a single
+// buffer and read through attributes with divisor 1, so each batch is one
+// instanced draw. Without it the same attributes are set as constant vertex
+// attributes before one draw per instance, and the shaders are the same.
+#define INSTANCE_MAX 256
+
+typedef struct InstanceData
+{
+    mat4 model_view;            // rotation and translation only
+    vec4 params;                // x = radius, y = texture layer,
+                                // z = night map layer or -1, w unused
+} instance_data;
+
+// Create the buffer. The instance attributes are at the fixed locations of
+// shader.h in every program.
+void instance_init(void);
+void instance_destroy(void);
+
+// Attribute arrays (bit n = location n) holding instance data; 0 without
+// caps.instancing.
+unsigned int instance_attrib_mask(void);
+
+// Point the instance arrays at the buffer, starting at instance first. This
+// is part of the instanced mesh's attribute setup, so a VAO records it.
+void instance_attribs(unsigned int first);
+
+// Stream this frame's instances.
+void instance_upload(const instance_data *instances, unsigned int count);
+
+// Draw instances first to first + count - 1 of the instanced mesh, whose
+// attributes must be bound.
+void instance_draw(GLsizei index_count,
+                   GLenum index_type,
+                   unsigned int first,
+                   unsigned int count);
+
+#endif
@@ -0,0 +1,38 @@
+#ifndef ASTRO_KTXTEX_H
+#define ASTRO_KTXTEX_H
+
+#include "glcaps.h"
+#include "ktx.h"
+#include "asset.h"
+#include "texstream.h"
+
+// Textures from the KTX2 files texbake makes next to each image.
+//
+// For textures/earth.jpg those are textures/earth.etc2.ktx2, taken with
+// caps.etc2, and textures/earth.rgba.ktx2 otherwise. Levels go to GL straight
+// from the asset's bytes, so nothing is decoded at startup; callers fall back
+// to decoding the image when neither file is there.
+
+// Open the KTX2 version of image_file this context can use, holding its
+// bytes in file until asset_release(). Returns 0 on success, -1 if there is
+// none.
+int ktxtex_open(ktx_file *ktx, asset_span *file, const char *image_file);
+
+// Upload a level of ktx to level gl_level of the bound 2D target.
+void ktxtex_image_2d(GLenum target,
+                     GLint gl_level,
+                     const ktx_file *ktx,
+                     const ktx_level *level);
+
+// A GL_TEXTURE_2D of ktx, with the whole mip chain where it can be sampled,
+// less its top drop levels as long as there are levels left. Its levels are
+// left to ts, for the caller to texstream_start().
+GLuint ktxtex_create(const ktx_file *ktx,
+                     unsigned int drop,
+                     tex_stream *ts,
+                     const char *name);
+
+// ktxtex_create() on the KTX2 version of image_file, or 0.
+GLuint ktxtex_load(const char *image_file);
+
+#endif
@@ -0,0 +1,264 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+
+#include "memstats.h"
+#include "pool.h"
+
+#ifdef __EMSCRIPTEN__
+#include <emscripten.h>
+#endif
+#ifdef POOL_THREADS
+#include <pthread.h>
+#endif
+
+#define KB  1024.0
+
+typedef struct MemObject
+{
+    mem_kind kind;
+    GLuint object;
+    unsigned int asset;
+    size_t bytes;
+} mem_object;
+
+static const char *const kind_names[MEM_KINDS] = {
+    "heap",
+    "mapped",
+    "buffers",
+    "textures"
+};
+
+static mem_asset assets[MEMSTATS_MAX_ASSETS];
+static unsigned int asset_count;
+static mem_object *objects;
+static unsigned int object_count;
+static unsigned int object_capacity;
+static size_t totals[MEM_KINDS];
+static size_t peaks[MEM_KINDS];
+static volatile sig_atomic_t requested;
+
+// the pool's workers count what they load
+#ifdef POOL_THREADS
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+#define LOCK()      pthread_mutex_lock(&lock)
+#define UNLOCK()    pthread_mutex_unlock(&lock)
+#else
+#define LOCK()
+#define UNLOCK()
+#endif
+
+#ifndef __EMSCRIPTEN__
+static void on_signal(int sig)
+{
+    (void) sig;
+    requested = 1;
+}
+#else
+EMSCRIPTEN_KEEPALIVE
+void astro_memstats(void)
+{
+    requested = 1;
+}
+#endif
+
+void memstats_init(void)
+{
+    #ifndef __EMSCRIPTEN__
+    signal(SIGUSR1, on_signal);
+    #endif
+}
+
+static unsigned int find_asset(const char *name)
+{
+    for (unsigned int i = 0; i < asset_count; i++)
+        if (strcmp(assets[i].name, name) == 0)
+            return i;
+
+    // the last entry takes whatever there's no room for
+    if (asset_count == MEMSTATS_MAX_ASSETS)
+        return MEMSTATS_MAX_ASSETS - 1;
+    if (asset_count == MEMSTATS_MAX_ASSETS - 1)
+        name = "(others)";
+    snprintf(assets[asset_count].name, sizeof(assets[asset_count].name),
+             "%s", name);
+    return asset_count++;
+}
+
+unsigned int memstats_asset(const char *name)
+{
+    LOCK();
+    unsigned int asset = find_asset(name);
+    UNLOCK();
+    return asset;
+}
+
+static void add(unsigned int asset, mem_kind kind, size_t bytes)
+{
+    mem_asset *a = &assets[asset];
+    a->bytes[kind] += bytes;
+    if (a->bytes[kind] > a->peak[kind])
+        a->peak[kind] = a->bytes[kind];
+    totals[kind] += bytes;
+    if (totals[kind] > peaks[kind])
+        peaks[kind] = totals[kind];
+}
+
+static void sub(unsigned int asset, mem_kind kind, size_t bytes)
+{
+    mem_asset *a = &assets[asset];
+    a->bytes[kind] -= bytes < a->bytes[kind] ? bytes : a->bytes[kind];
+    totals[kind] -= bytes < totals[kind] ? bytes : totals[kind];
+}
+
+void memstats_add(unsigned int asset, mem_kind kind, size_t bytes)
+{
+    LOCK();
+    add(asset, kind, bytes);
+    UNLOCK();
+}
+
+void memstats_sub(unsigned int asset, mem_kind kind, size_t bytes)
+{
+    LOCK();
+    sub(asset, kind, bytes);
+    UNLOCK();
+}
+
+static mem_object *find_object(mem_kind kind, GLuint object)
+{
+    for (unsigned int i = 0; i < object_count; i++)
+        if (objects[i].kind == kind && objects[i].object == object)
+            return &objects[i];
+    return NULL;
+}
+
+void memstats_gl(mem_kind kind, GLuint object, const char *name, size_t bytes)
+{
+    LOCK();
+    mem_object *o = find_object(kind, object);
+    if (o)
+    {
+        sub(o->asset, kind, o->bytes);
+    }
+    else
+    {
+        if (object_count == object_capacity)
+        {
+            unsigned int capacity = object_capacity ? object_capacity * 2
+                                                    : MEMSTATS_OBJECTS;
+            mem_object *grown = (mem_object *) realloc(objects,
+                                                       capacity *
+                                                       sizeof(*objects));
+            if (grown == NULL)
+            {
+                fprintf(stderr, "ERROR: Couldn't allocate memory stats.");
+                exit(EXIT_FAILURE);
+            }
+            objects = grown;
+            object_capacity = capacity;
+        }
+        o = &objects[object_count++];
+        o->kind = kind;
+        o->object = object;
+    }
+    o->asset = find_asset(name);
+    o->bytes = bytes;
+    add(o->asset, kind, bytes);
+    UNLOCK();
+}
+
+void memstats_gl_delete(mem_kind kind, GLuint object)
+{
+    LOCK();
+    mem_object *o = find_object(kind, object);
+    if (o)
+    {
+        sub(o->asset, kind, o->bytes);
+        *o = objects[--object_count];
+    }
+    UNLOCK();
+}
+
+void memstats_dump(FILE *out)
+{
+    LOCK();
+    fprintf(out, "memory by asset, KB now (peak):\n%-28s", "");
+    for (unsigned int k = 0; k < MEM_KINDS; k++)
+        fprintf(out, " %19s", kind_names[k]);
+    fprintf(out, "\n");
+    for (unsigned int i = 0; i < asset_count; i++)
+    {
+        fprintf(out, "%-28.28s", assets[i].name);
+        for (unsigned int k = 0; k < MEM_KINDS; k++)
+            fprintf(out, " %8.1f (%8.1f)",
+                    assets[i].bytes[k] / KB, assets[i].peak[k] / KB);
+        fprintf(out, "\n");
+    }
+    fprintf(out, "%-28s", "total");
+    for (unsigned int k = 0; k < MEM_KINDS; k++)
+        fprintf(out, " %8.1f (%8.1f)", totals[k] / KB, peaks[k] / KB);
+    fprintf(out, "\n");
+    UNLOCK();
+}
+
+static void json_sizes(FILE *out, const size_t *bytes, const size_t *peak)
+{
+    for (unsigned int k = 0; k < MEM_KINDS; k++)
+        fprintf(out, "%s\"%s\": %zu, \"peak_%s\": %zu",
+                k ? ", " : "", kind_names[k], bytes[k],
+                kind_names[k], peak[k]);
+}
+
+void memstats_dump_json(FILE *out)
+{
+    LOCK();
+    fprintf(out, "{\n  \"assets\": [\n");
+    for (unsigned int i = 0; i < asset_count; i++)
+    {
+        // the names are paths, with nothing to escape but these
+        fprintf(out, "    { \"name\": \"");
+        for (const char *c = assets[i].name; *c; c++)
+            fprintf(out, *c == '"' || *c == '\\' ? "\\%c" : "%c", *c);
+        fprintf(out, "\", ");
+        json_sizes(out, assets[i].bytes, assets[i].peak);
+        fprintf(out, " }%s\n", i + 1 < asset_count ? "," : "");
+    }
+    fprintf(out, "  ],\n  \"total\": { ");
+    json_sizes(out, totals, peaks);
+    fprintf(out, " }\n}\n");
+    UNLOCK();
+}
+
+void memstats_report(void)
+{
+    memstats_dump(stderr);
+
+    const char *path = getenv("ASTRO_MEM_STATS");
+    if (path == NULL || *path == '\0')
+        return;
+    if (strcmp(path, "-") == 0)
+    {
+        memstats_dump_json(stdout);
+        fflush(stdout);
+        return;
+    }
+    FILE *out = fopen(path, "w");
+    if (out == NULL)
+    {
+        fprintf(stderr, "WARNING: couldn't write %s\n", path);
+        return;
+    }
+    memstats_dump_json(out);
+    fclose(out);
+}
+
+void memstats_poll(void)
+{
+    if (requested)
+    {
+        requested = 0;
+        memstats_report();
+    }
+}
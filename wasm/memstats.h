@@ -0,0 +1,62 @@
+#ifndef ASTRO_MEMSTATS_H
+#define ASTRO_MEMSTATS_H
+
+#include <stdio.h>
+#include <stddef.h>
+
+#include "glcaps.h"
+
+// Memory held for each asset, to size the texture budget on the Pi and the
+// heap of the web build: on the CPU what is malloc'd and what is mapped (in
+// wasm a mapping is a copy on the heap as well), on the GPU the buffers and
+// textures, at the bytes their data takes.
+//
+// The loaders count what they allocate and free against the asset's name.
+// A GL object is counted by its name when its store is made, and forgotten
+// by glstate when it is deleted. The counts are safe to make on any thread.
+//
+// memstats_report() prints the current and peak bytes of every asset, and
+// writes them as JSON to the file ASTRO_MEM_STATS names ("-" for stdout). It
+// runs at exit, and in the frame after SIGUSR1 or, in wasm, a call of
+// _astro_memstats() from the page.
+#define MEMSTATS_MAX_ASSETS     64
+#define MEMSTATS_OBJECTS        64      // to start with; the table grows
+#define MEMSTATS_NAME_LEN       64
+
+typedef enum MemKind
+{
+    MEM_HEAP,
+    MEM_MAPPED,
+    MEM_BUFFER,
+    MEM_TEXTURE,
+    MEM_KINDS
+} mem_kind;
+
+typedef struct MemAsset
+{
+    char name[MEMSTATS_NAME_LEN];
+    size_t bytes[MEM_KINDS];
+    size_t peak[MEM_KINDS];
+} mem_asset;
+
+// Call once, before any thread counts.
+void memstats_init(void);
+
+// The entry of the asset called name, made on first use.
+unsigned int memstats_asset(const char *name);
+void memstats_add(unsigned int asset, mem_kind kind, size_t bytes);
+void memstats_sub(unsigned int asset, mem_kind kind, size_t bytes);
+
+// The store of a GL buffer or texture is now bytes, attributed to name; a
+// new store of the same object replaces the old one.
+void memstats_gl(mem_kind kind, GLuint object, const char *name, size_t bytes);
+void memstats_gl_delete(mem_kind kind, GLuint object);
+
+void memstats_dump(FILE *out);
+void memstats_dump_json(FILE *out);
+void memstats_report(void);
+
+// Once a frame: reports if one was asked for since the last call.
+void memstats_poll(void);
+
+#endif
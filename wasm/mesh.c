@@ -0,0 +1,221 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "mesh.h"
+
+static const float MESH_PI = 3.14159265358979323846f;
+
+static int mesh_pack_validate(mesh_pack *pack, const char *filename)
+{
+    const mesh_file_header *hdr = (const mesh_file_header *) pack->base;
+
+    if (pack->size < sizeof(mesh_file_header) ||
+        memcmp(hdr->magic, MESH_MAGIC, 4) != 0)
+    {
+        fprintf(stderr, "%s is not a baked mesh file\n", filename);
+        return -1;
+    }
+    if (hdr->version != MESH_FILE_VERSION)
+    {
+        fprintf(stderr,
+                "%s has mesh format version %u, expected %u\n",
+                filename, hdr->version, MESH_FILE_VERSION);
+        return -1;
+    }
+    if (hdr->vertex_stride != sizeof(astro_attributes) ||
+        hdr->file_size != pack->size ||
+        hdr->entry_offset > pack->size ||
+        hdr->entry_count > (pack->size - hdr->entry_offset) /
+                           sizeof(mesh_file_entry))
+    {
+        fprintf(stderr, "%s has a corrupt mesh header\n", filename);
+        return -1;
+    }
+
+    const mesh_file_entry *entries =
+        (const mesh_file_entry *) (pack->base + hdr->entry_offset);
+    for (uint32_t i = 0; i < hdr->entry_count; i++)
+    {
+        const mesh_file_entry *e = &entries[i];
+        uint64_t vend = (uint64_t) e->vertex_offset +
+                        (uint64_t) e->vertex_count * sizeof(astro_attributes);
+        uint64_t iend = (uint64_t) e->index_offset +
+                        (uint64_t) e->index_count * e->index_size;
+
+        if ((e->index_size != 2 && e->index_size != 4) ||
+            e->vertex_offset % MESH_ALIGN || e->index_offset % MESH_ALIGN ||
+            vend > pack->size || iend > pack->size ||
+            memchr(e->name, 0, MESH_NAME_LEN) == NULL)
+        {
+            fprintf(stderr, "%s: mesh entry %u is corrupt\n", filename, i);
+            return -1;
+        }
+    }
+
+    pack->header = hdr;
+    pack->entries = entries;
+    return 0;
+}
+
+int mesh_pack_init(mesh_pack *pack,
+                   const void *data,
+                   size_t size,
+                   const char *name)
+{
+    memset(pack, 0, sizeof(*pack));
+    pack->base = (const unsigned char *) data;
+    pack->size = size;
+
+    if (mesh_pack_validate(pack, name) != 0)
+    {
+        memset(pack, 0, sizeof(*pack));
+        return -1;
+    }
+    return 0;
+}
+
+int mesh_pack_find(const mesh_pack *pack, const char *name, mesh_data *mesh)
+{
+    if (pack->header == NULL)
+        return -1;
+
+    for (uint32_t i = 0; i < pack->header->entry_count; i++)
+    {
+        const mesh_file_entry *e = &pack->entries[i];
+        if (strcmp(e->name, name) != 0)
+            continue;
+
+        mesh->vertexes =
+            (const astro_attributes *) (pack->base + e->vertex_offset);
+        mesh->vertex_count = e->vertex_count;
+        mesh->indices = pack->base + e->index_offset;
+        mesh->index_count = e->index_count;
+        mesh->index_size = e->index_size;
+        return 0;
+    }
+    return -1;
+}
+
+void mesh_sphere_name(char *name, size_t len,
+                      unsigned int stacks,
+                      unsigned int sectors)
+{
+    snprintf(name, len, "sphere_%ux%u", stacks, sectors);
+}
+
+uint32_t mesh_sphere_vertex_count(unsigned int stacks, unsigned int sectors)
+{
+    return (stacks + 1) * (sectors + 1);
+}
+
+uint32_t mesh_sphere_index_count(unsigned int stacks, unsigned int sectors)
+{
+    // 2 triangles per sector excluding 1st and last stacks
+    return ((stacks * sectors) - sectors) * 6;
+}
+
+uint32_t mesh_index_size(uint32_t vertex_count)
+{
+    return vertex_count <= 0xffff ? 2 : 4;
+}
+
+static void mesh_put_index(void *indices, uint32_t index_size,
+                           uint32_t i, uint32_t value)
+{
+    if (index_size == 2)
+        ((uint16_t *) indices)[i] = (uint16_t) value;
+    else
+        ((uint32_t *) indices)[i] = value;
+}
+
+void mesh_build_sphere(astro_attributes *vertexes,
+                       void *indices,
+                       uint32_t index_size,
+                       unsigned int stacks,
+                       unsigned int sectors)
+{
+    float x, y, z, xy;                              // vertex position
+    float s, t;                                     // texCoord
+
+    float sector_step = 2 * MESH_PI / sectors;
+    float stack_step = MESH_PI / stacks;
+    float sector_angle, stack_angle;
+
+    uint32_t count = 0;
+    for (unsigned int i = 0; i <= stacks; i++)
+    {
+        stack_angle = MESH_PI / 2 - i * stack_step; // from pi/2 to -pi/2
+        xy = cosf(stack_angle);                     // cos(u)
+        z = sinf(stack_angle);                      // sin(u)
+
+        // add (sectorCount+1) vertices per stack
+        // the first and last vertices have same position and normal,
+        // but different tex coords
+        for (unsigned int j = 0; j <= sectors; j++)
+        {
+            sector_angle = j * sector_step;          // from 0 to 2pi
+
+            // vertex position, which on a unit sphere is also its normal
+            x = xy * cosf(sector_angle);             // cos(u) * cos(v)
+            y = xy * sinf(sector_angle);             // cos(u) * sin(v)
+            vertexes[count].positions[0] = x;
+            vertexes[count].positions[1] = y;
+            vertexes[count].positions[2] = z;
+            vertexes[count].normals[0] = x;
+            vertexes[count].normals[1] = y;
+            vertexes[count].normals[2] = z;
+
+            // vertex tex coord between [0, 1]
+            s = (float)j / sectors;
+            t = (float)i / stacks;
+            vertexes[count].textures[0] = s;
+            vertexes[count].textures[1] = t;
+
+            count++;
+        }
+    }
+
+    uint32_t k1, k2;
+    count = 0;
+    for (unsigned int i = 0; i < stacks; i++)
+    {
+        k1 = i * (sectors + 1);     // beginning of current stack
+        k2 = k1 + sectors + 1;      // beginning of next stack
+
+        for (unsigned int j = 0; j < sectors; j++, k1++, k2++)
+        {
+            if (i != 0)
+            {
+                // k1---k2---k1+1
+                mesh_put_index(indices, index_size, count++, k1);
+                mesh_put_index(indices, index_size, count++, k2);
+                mesh_put_index(indices, index_size, count++, k1 + 1);
+            }
+
+            if (i != (stacks - 1))
+            {
+                // k1+1---k2---k2+1
+                mesh_put_index(indices, index_size, count++, k1 + 1);
+                mesh_put_index(indices, index_size, count++, k2);
+                mesh_put_index(indices, index_size, count++, k2 + 1);
+            }
+        }
+    }
+}
+
+void mesh_build_quad(astro_attributes *vertexes, uint16_t *indices)
+{
+    const astro_attributes bg[MESH_QUAD_VERTEXES] =
+    {
+        {{  1.0f,  1.0f, 0.0f }, { 1.0f, 1.0f }, { 0.0, 0.0, 0.0 }},
+        {{  1.0f, -1.0f, 0.0f }, { 1.0f, 0.0f }, { 0.0, 0.0, 0.0 }},
+        {{ -1.0f, -1.0f, 0.0f }, { 0.0f, 0.0f }, { 0.0, 0.0, 0.0 }},
+        {{ -1.0f,  1.0f, 0.0f }, { 0.0f, 1.0f }, { 0.0, 0.0, 0.0 }}
+    };
+    const uint16_t bg_indices[MESH_QUAD_INDICES] = {0, 1, 2, 2, 3, 0};
+
+    memcpy(vertexes, bg, sizeof(bg));
+    memcpy(indices, bg_indices, sizeof(bg_indices));
+}
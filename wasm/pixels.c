@@ -0,0 +1,172 @@
+#include <math.h>
+
+#include "pixels.h"
+
+static float to_linear[256];
+static int tables_ready;
+
+void pixels_init(void)
+{
+    if (tables_ready)
+        return;
+    for (int i = 0; i < 256; i++)
+    {
+        float c = i / 255.0f;
+        to_linear[i] = c <= 0.04045f ? c / 12.92f
+                                     : powf((c + 0.055f) / 1.055f, 2.4f);
+    }
+    tables_ready = 1;
+}
+
+// The sRGB byte whose linear value is nearest to v.
+static unsigned char to_srgb(float v)
+{
+    int lo = 0;
+    int hi = 255;
+
+    while (lo < hi)
+    {
+        int mid = (lo + hi + 1) / 2;
+        if (to_linear[mid] <= v)
+            lo = mid;
+        else
+            hi = mid - 1;
+    }
+    if (lo < 255 && to_linear[lo + 1] - v < v - to_linear[lo])
+        lo++;
+    return (unsigned char) lo;
+}
+
+// The first of the dst pixels, one of dst_size across total source pixels,
+// whose box starts at or after source pixel at.
+static uint32_t first_covering(uint32_t at, uint32_t total, uint32_t dst_size)
+{
+    return (uint32_t) (((uint64_t) at * dst_size + total - 1) / total);
+}
+
+void pixels_resize_part(const unsigned char *src,
+                        uint32_t sw,
+                        uint32_t sh,
+                        uint32_t left,
+                        uint32_t top,
+                        uint32_t total_w,
+                        uint32_t total_h,
+                        unsigned char *dst,
+                        uint32_t dw,
+                        uint32_t dh)
+{
+    uint32_t y_begin = first_covering(top, total_h, dh);
+    uint32_t y_end = first_covering(top + sh, total_h, dh);
+    uint32_t x_begin = first_covering(left, total_w, dw);
+    uint32_t x_end = first_covering(left + sw, total_w, dw);
+
+    // in 64 bits: the products of the virtual texture sizes overflow a 32
+    // bit long, and so do the sums of a big reduction
+    for (uint32_t y = y_begin; y < y_end; y++)
+    {
+        uint32_t y0 = (uint32_t) ((uint64_t) y * total_h / dh);
+        uint32_t y1 = (uint32_t) ((uint64_t) (y + 1) * total_h / dh);
+        if (y1 > top + sh)
+            y1 = top + sh;
+        if (y1 <= y0)
+            y1 = y0 + 1;
+
+        for (uint32_t x = x_begin; x < x_end; x++)
+        {
+            uint32_t x0 = (uint32_t) ((uint64_t) x * total_w / dw);
+            uint32_t x1 = (uint32_t) ((uint64_t) (x + 1) * total_w / dw);
+            if (x1 > left + sw)
+                x1 = left + sw;
+            if (x1 <= x0)
+                x1 = x0 + 1;
+
+            uint64_t sum[4] = { 0, 0, 0, 0 };
+            for (uint32_t sy = y0 - top; sy < y1 - top; sy++)
+                for (uint32_t sx = x0 - left; sx < x1 - left; sx++)
+                    for (int c = 0; c < 4; c++)
+                        sum[c] += src[((size_t) sy * sw + sx) * 4 + c];
+
+            uint64_t n = (uint64_t) (y1 - y0) * (x1 - x0);
+            for (int c = 0; c < 4; c++)
+                dst[((size_t) y * dw + x) * 4 + c] =
+                    (unsigned char) ((sum[c] + n / 2) / n);
+        }
+    }
+}
+
+void pixels_resize_rgba(const unsigned char *src, uint32_t sw, uint32_t sh,
+                        unsigned char *dst, uint32_t dw, uint32_t dh)
+{
+    pixels_resize_part(src, sw, sh, 0, 0, sw, sh, dst, dw, dh);
+}
+
+void pixels_half_size(uint32_t sw, uint32_t sh, uint32_t *dw, uint32_t *dh)
+{
+    *dw = sw > 1 ? sw / 2 : 1;
+    *dh = sh > 1 ? sh / 2 : 1;
+}
+
+void pixels_downsample_srgb(const unsigned char *src, uint32_t sw, uint32_t sh,
+                            unsigned char *dst)
+{
+    uint32_t dw, dh;
+    pixels_half_size(sw, sh, &dw, &dh);
+    pixels_init();
+
+    for (uint32_t y = 0; y < dh; y++)
+    {
+        // with an odd height the last output row takes three rows
+        uint32_t y0 = y * 2 < sh ? y * 2 : sh - 1;
+        uint32_t y1 = y == dh - 1 ? sh - 1 : y0 + 1;
+
+        for (uint32_t x = 0; x < dw; x++)
+        {
+            uint32_t x0 = x * 2 < sw ? x * 2 : sw - 1;
+            uint32_t x1 = x == dw - 1 ? sw - 1 : x0 + 1;
+            float sum[4] = { 0, 0, 0, 0 };
+            unsigned int n = 0;
+
+            for (uint32_t sy = y0; sy <= y1; sy++)
+            {
+                for (uint32_t sx = x0; sx <= x1; sx++)
+                {
+                    const unsigned char *p = &src[((size_t) sy * sw + sx) * 4];
+                    for (int c = 0; c < 3; c++)
+                        sum[c] += to_linear[p[c]];
+                    sum[3] += p[3];
+                    n++;
+                }
+            }
+
+            unsigned char *q = &dst[((size_t) y * dw + x) * 4];
+            for (int c = 0; c < 3; c++)
+                q[c] = to_srgb(sum[c] / n);
+            q[3] = (unsigned char) (sum[3] / n + 0.5f);
+        }
+    }
+}
+
+size_t pixels_chain_size(uint32_t width, uint32_t height, unsigned int levels)
+{
+    size_t size = 0;
+    for (unsigned int l = 0; l < levels; l++)
+    {
+        size += (size_t) width * height * 4;
+        pixels_half_size(width, height, &width, &height);
+    }
+    return size;
+}
+
+void pixels_build_chain(unsigned char *chain,
+                        uint32_t width,
+                        uint32_t height,
+                        unsigned int levels)
+{
+    for (unsigned int l = 1; l < levels; l++)
+    {
+        unsigned char *next = chain + (size_t) width * height * 4;
+        pixels_downsample_srgb(chain, width, height, next);
+        pixels_half_size(width, height, &width, &height);
+        chain = next;
+    }
+}
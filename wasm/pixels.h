@@ -0,0 +1,52 @@
+#ifndef ASTRO_PIXELS_H
+#define ASTRO_PIXELS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// CPU work on RGBA8 images, shared by the loaders and the host tools.
+//
+// The colour channels are sRGB encoded, so filters that average them do it
+// on linear values and encode the result again; averaging the encoded bytes
+// darkens every mip level a little more. Alpha is linear already.
+
+// Build the tables the sRGB filters use, once. The filters see to it
+// themselves, but threads that filter need it done before they start.
+void pixels_init(void);
+
+// Box filter src down to dw x dh, or sample it up.
+void pixels_resize_rgba(const unsigned char *src, uint32_t sw, uint32_t sh,
+                        unsigned char *dst, uint32_t dw, uint32_t dh);
+
+// The same for one piece of a total_w x total_h image, sw x sh at left,
+// top: the pixels of dst, dw x dh for the whole image, whose boxes start in
+// it. Where a box runs on into the next piece only this one's part counts.
+void pixels_resize_part(const unsigned char *src,
+                        uint32_t sw,
+                        uint32_t sh,
+                        uint32_t left,
+                        uint32_t top,
+                        uint32_t total_w,
+                        uint32_t total_h,
+                        unsigned char *dst,
+                        uint32_t dw,
+                        uint32_t dh);
+
+// Size of the mip level below a sw x sh one.
+void pixels_half_size(uint32_t sw, uint32_t sh, uint32_t *dw, uint32_t *dh);
+
+// The next mip level of src, a 2x2 box filter in linear light; an odd last
+// row or column is folded into its neighbour.
+void pixels_downsample_srgb(const unsigned char *src, uint32_t sw, uint32_t sh,
+                            unsigned char *dst);
+
+// Bytes of levels mip levels of a width x height image, one after another.
+size_t pixels_chain_size(uint32_t width, uint32_t height, unsigned int levels);
+
+// Fill in the levels below level 0, which chain starts with.
+void pixels_build_chain(unsigned char *chain,
+                        uint32_t width,
+                        uint32_t height,
+                        unsigned int levels);
+
+#endif
@@ -0,0 +1,180 @@
+#include <string.h>
+
+#include "pixfmt.h"
+
+// SSSE3 and wasm SIMD both shuffle the bytes of a 16 byte vector by a mask,
+// so they share kernels; a mask lane of -1 makes the byte 0 on either.
+#if defined(__SSSE3__)
+#include <tmmintrin.h>
+#define SHUFFLE_KERNELS     "ssse3"
+typedef __m128i vec;
+#define vec_load(p)         _mm_loadu_si128((const __m128i *) (p))
+#define vec_store(p, v)     _mm_storeu_si128((__m128i *) (p), (v))
+#define vec_shuffle(v, m)   _mm_shuffle_epi8((v), (m))
+#define vec_or(a, b)        _mm_or_si128((a), (b))
+#define vec_bytes           _mm_setr_epi8
+#define vec_words(w)        _mm_set1_epi32((int) (w))
+#elif defined(__wasm_simd128__)
+#include <wasm_simd128.h>
+#define SHUFFLE_KERNELS     "wasm simd128"
+typedef v128_t vec;
+#define vec_load(p)         wasm_v128_load(p)
+#define vec_store(p, v)     wasm_v128_store((p), (v))
+#define vec_shuffle(v, m)   wasm_i8x16_swizzle((v), (m))
+#define vec_or(a, b)        wasm_v128_or((a), (b))
+#define vec_bytes           wasm_i8x16_make
+#define vec_words(w)        wasm_i32x4_splat((int32_t) (w))
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define NEON_KERNELS        "neon"
+#endif
+
+#define ALPHA_WORD          0xff000000u
+
+const char *pixfmt_kernels(void)
+{
+#if defined(SHUFFLE_KERNELS)
+    return SHUFFLE_KERNELS;
+#elif defined(NEON_KERNELS)
+    return NEON_KERNELS;
+#else
+    return "scalar";
+#endif
+}
+
+void pixfmt_bgr_to_rgb(const unsigned char *src,
+                       unsigned char *dst,
+                       size_t count)
+{
+    size_t i = 0;
+#if defined(SHUFFLE_KERNELS)
+    // 5 pixels a vector; the 16th byte written is the next pixel's first,
+    // unchanged, so in place works too. 6 pixels keep the loads in bounds.
+    const vec mask = vec_bytes(2, 1, 0, 5, 4, 3, 8, 7, 6,
+                               11, 10, 9, 14, 13, 12, 15);
+    for (; i + 6 <= count; i += 5)
+        vec_store(dst + i * 3, vec_shuffle(vec_load(src + i * 3), mask));
+#elif defined(NEON_KERNELS)
+    for (; i + 16 <= count; i += 16)
+    {
+        uint8x16x3_t v = vld3q_u8(src + i * 3);
+        uint8x16_t b = v.val[0];
+        v.val[0] = v.val[2];
+        v.val[2] = b;
+        vst3q_u8(dst + i * 3, v);
+    }
+#endif
+    for (; i < count; i++)
+    {
+        unsigned char b = src[i * 3];
+        dst[i * 3] = src[i * 3 + 2];
+        dst[i * 3 + 1] = src[i * 3 + 1];
+        dst[i * 3 + 2] = b;
+    }
+}
+
+void pixfmt_bgr_to_rgba(const unsigned char *src,
+                        unsigned char *dst,
+                        size_t count)
+{
+    size_t i = 0;
+#if defined(SHUFFLE_KERNELS)
+    // 4 pixels a vector, loading 4 bytes past them
+    const vec mask = vec_bytes(2, 1, 0, -1, 5, 4, 3, -1,
+                               8, 7, 6, -1, 11, 10, 9, -1);
+    const vec alpha = vec_words(ALPHA_WORD);
+    for (; i + 6 <= count; i += 4)
+        vec_store(dst + i * 4,
+                  vec_or(vec_shuffle(vec_load(src + i * 3), mask), alpha));
+#elif defined(NEON_KERNELS)
+    for (; i + 16 <= count; i += 16)
+    {
+        uint8x16x3_t v = vld3q_u8(src + i * 3);
+        uint8x16x4_t out;
+        out.val[0] = v.val[2];
+        out.val[1] = v.val[1];
+        out.val[2] = v.val[0];
+        out.val[3] = vdupq_n_u8(255);
+        vst4q_u8(dst + i * 4, out);
+    }
+#endif
+    for (; i < count; i++)
+    {
+        dst[i * 4] = src[i * 3 + 2];
+        dst[i * 4 + 1] = src[i * 3 + 1];
+        dst[i * 4 + 2] = src[i * 3];
+        dst[i * 4 + 3] = 255;
+    }
+}
+
+// Both four byte orders: alpha_word is ORed into every pixel.
+static void bgra_to_rgba(const unsigned char *src,
+                         unsigned char *dst,
+                         size_t count,
+                         uint32_t alpha_word)
+{
+    size_t i = 0;
+#if defined(SHUFFLE_KERNELS)
+    const vec mask = vec_bytes(2, 1, 0, 3, 6, 5, 4, 7,
+                               10, 9, 8, 11, 14, 13, 12, 15);
+    const vec alpha = vec_words(alpha_word);
+    for (; i + 4 <= count; i += 4)
+        vec_store(dst + i * 4,
+                  vec_or(vec_shuffle(vec_load(src + i * 4), mask), alpha));
+#elif defined(NEON_KERNELS)
+    for (; i + 16 <= count; i += 16)
+    {
+        uint8x16x4_t v = vld4q_u8(src + i * 4);
+        uint8x16_t b = v.val[0];
+        v.val[0] = v.val[2];
+        v.val[2] = b;
+        if (alpha_word)
+            v.val[3] = vdupq_n_u8(255);
+        vst4q_u8(dst + i * 4, v);
+    }
+#endif
+    unsigned char alpha_byte = alpha_word ? 255 : 0;
+    for (; i < count; i++)
+    {
+        unsigned char b = src[i * 4];
+        dst[i * 4] = src[i * 4 + 2];
+        dst[i * 4 + 1] = src[i * 4 + 1];
+        dst[i * 4 + 2] = b;
+        dst[i * 4 + 3] = src[i * 4 + 3] | alpha_byte;
+    }
+}
+
+void pixfmt_bgra_to_rgba(const unsigned char *src,
+                         unsigned char *dst,
+                         size_t count)
+{
+    bgra_to_rgba(src, dst, count, 0);
+}
+
+void pixfmt_bgrx_to_rgba(const unsigned char *src,
+                         unsigned char *dst,
+                         size_t count)
+{
+    bgra_to_rgba(src, dst, count, ALPHA_WORD);
+}
+
+void pixfmt_flip_rows(unsigned char *pixels, size_t stride, uint32_t rows)
+{
+    // memcpy() is the fastest copy there is already; the swap goes through
+    // a buffer small enough to stay in L1
+    unsigned char chunk[1024];
+
+    for (uint32_t y = 0; y < rows / 2; y++)
+    {
+        unsigned char *top = pixels + y * stride;
+        unsigned char *bottom = pixels + (rows - 1 - y) * stride;
+        for (size_t x = 0; x < stride; x += sizeof(chunk))
+        {
+            size_t n = stride - x < sizeof(chunk) ? stride - x
+                                                  : sizeof(chunk);
+            memcpy(chunk, top + x, n);
+            memcpy(top + x, bottom + x, n);
+            memcpy(bottom + x, chunk, n);
+        }
+    }
+}
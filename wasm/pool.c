@@ -0,0 +1,423 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "pool.h"
+
+#ifdef POOL_THREADS
+#include <pthread.h>
+#endif
+
+static unsigned int thread_count;
+static atomic_uint finished;
+
+#ifdef POOL_THREADS
+// A worker's jobs, Chase-Lev style: the worker pushes and pops at the
+// bottom, thieves take from the top.
+typedef struct Deque
+{
+    atomic_long top;
+    atomic_long bottom;
+    _Atomic(pool_job *) jobs[POOL_DEQUE_SIZE];
+} deque;
+
+static pthread_t threads[POOL_MAX_THREADS];
+static deque deques[POOL_MAX_THREADS];
+static _Thread_local int self = -1;     // the worker this is, if it is one
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t wake = PTHREAD_COND_INITIALIZER;        // workers
+static pthread_cond_t changed = PTHREAD_COND_INITIALIZER;     // waiters
+// of the successor lists, against a job finishing
+static pthread_mutex_t edges = PTHREAD_MUTEX_INITIALIZER;
+static pool_job *head;                  // the shared queue, under lock
+static pool_job *tail;
+static atomic_uint queued;              // in the deques and shared queue
+static atomic_uint sleepers;            // idle workers
+static atomic_uint waiters;             // threads in help_until()
+static bool stopping;
+
+#define EDGES_LOCK()    pthread_mutex_lock(&edges)
+#define EDGES_UNLOCK()  pthread_mutex_unlock(&edges)
+
+// Returns false when the deque is full.
+static bool deque_push(deque *d, pool_job *job)
+{
+    long b = atomic_load_explicit(&d->bottom, memory_order_relaxed);
+    long t = atomic_load_explicit(&d->top, memory_order_acquire);
+    if (b - t >= POOL_DEQUE_SIZE)
+        return false;
+    atomic_store_explicit(&d->jobs[b % POOL_DEQUE_SIZE], job,
+                          memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    atomic_store_explicit(&d->bottom, b + 1, memory_order_relaxed);
+    return true;
+}
+
+static pool_job *deque_pop(deque *d)
+{
+    long b = atomic_load_explicit(&d->bottom, memory_order_relaxed) - 1;
+    atomic_store_explicit(&d->bottom, b, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    long t = atomic_load_explicit(&d->top, memory_order_relaxed);
+
+    pool_job *job = NULL;
+    if (t <= b)
+    {
+        job = atomic_load_explicit(&d->jobs[b % POOL_DEQUE_SIZE],
+                                   memory_order_relaxed);
+        if (t < b)
+            return job;
+        // the last one: a thief may be taking it too
+        if (!atomic_compare_exchange_strong_explicit(&d->top, &t, t + 1,
+                                                     memory_order_seq_cst,
+                                                     memory_order_relaxed))
+            job = NULL;
+    }
+    atomic_store_explicit(&d->bottom, b + 1, memory_order_relaxed);
+    return job;
+}
+
+static pool_job *deque_steal(deque *d)
+{
+    long t = atomic_load_explicit(&d->top, memory_order_acquire);
+    atomic_thread_fence(memory_order_seq_cst);
+    long b = atomic_load_explicit(&d->bottom, memory_order_acquire);
+    if (t >= b)
+        return NULL;
+
+    pool_job *job = atomic_load_explicit(&d->jobs[t % POOL_DEQUE_SIZE],
+                                         memory_order_relaxed);
+    if (!atomic_compare_exchange_strong_explicit(&d->top, &t, t + 1,
+                                                 memory_order_seq_cst,
+                                                 memory_order_relaxed))
+        return NULL;
+    return job;
+}
+
+// This worker's newest job, else the oldest shared one, else one stolen.
+static pool_job *find_job(void)
+{
+    pool_job *job = NULL;
+
+    if (self >= 0)
+        job = deque_pop(&deques[self]);
+    if (job == NULL)
+    {
+        pthread_mutex_lock(&lock);
+        job = head;
+        if (job)
+        {
+            head = job->next;
+            if (head == NULL)
+                tail = NULL;
+        }
+        pthread_mutex_unlock(&lock);
+    }
+    for (int i = 1; job == NULL && i <= POOL_MAX_THREADS; i++)
+    {
+        int victim = (self + i) % POOL_MAX_THREADS;
+        if (victim != self)
+            job = deque_steal(&deques[victim]);
+    }
+
+    if (job)
+        atomic_fetch_sub(&queued, 1);
+    return job;
+}
+
+// A job was queued, for a worker or a waiter to run, or one finished, which
+// a waiter may be waiting for.
+static void notify(bool queued_one)
+{
+    bool worker = queued_one && atomic_load(&sleepers) > 0;
+    bool waiter = atomic_load(&waiters) > 0;
+    if (worker || waiter)
+    {
+        pthread_mutex_lock(&lock);
+        if (worker)
+            pthread_cond_signal(&wake);
+        if (waiter)
+            pthread_cond_broadcast(&changed);
+        pthread_mutex_unlock(&lock);
+    }
+}
+#else
+#define EDGES_LOCK()
+#define EDGES_UNLOCK()
+#endif
+
+static void run(pool_job *job);
+
+// Queue a job whose dependencies are done.
+static void schedule(pool_job *job)
+{
+    if (thread_count == 0)
+    {
+        run(job);
+        return;
+    }
+
+    #ifdef POOL_THREADS
+    // counted first, so no taker sees it gone before it came
+    atomic_fetch_add(&queued, 1);
+    if (self < 0 || !deque_push(&deques[self], job))
+    {
+        job->next = NULL;
+        pthread_mutex_lock(&lock);
+        if (tail)
+            tail->next = job;
+        else
+            head = job;
+        tail = job;
+        pthread_mutex_unlock(&lock);
+    }
+    notify(true);
+    #endif
+}
+
+static void run(pool_job *job)
+{
+    pool_job *successors[POOL_MAX_SUCCESSORS];
+
+    job->func(job->arg);
+
+    // the job is its owner's again once done, so what's needed of it is
+    // taken first
+    EDGES_LOCK();
+    unsigned int count = job->successor_count;
+    memcpy(successors, job->successors, count * sizeof(*successors));
+    atomic_store(&job->done, true);
+    EDGES_UNLOCK();
+    atomic_fetch_add(&finished, 1);
+
+    for (unsigned int i = 0; i < count; i++)
+        if (atomic_fetch_sub(&successors[i]->pending, 1) == 1)
+            schedule(successors[i]);
+
+    #ifdef POOL_THREADS
+    if (thread_count > 0)
+        notify(false);
+    #endif
+}
+
+#ifdef POOL_THREADS
+static void *worker(void *arg)
+{
+    self = (int) (intptr_t) arg;
+
+    for (;;)
+    {
+        pool_job *job = find_job();
+        if (job)
+        {
+            run(job);
+            continue;
+        }
+
+        pthread_mutex_lock(&lock);
+        atomic_fetch_add(&sleepers, 1);
+        while (atomic_load(&queued) == 0 && !stopping)
+            pthread_cond_wait(&wake, &lock);
+        atomic_fetch_sub(&sleepers, 1);
+        bool stop = stopping && atomic_load(&queued) == 0;
+        pthread_mutex_unlock(&lock);
+        if (stop)
+            break;
+    }
+    return NULL;
+}
+
+// Run jobs, or else sleep, until ready(arg).
+static void help_until(bool (*ready)(const void *arg), const void *arg)
+{
+    while (!ready(arg))
+    {
+        pool_job *job = find_job();
+        if (job)
+        {
+            run(job);
+            continue;
+        }
+
+        pthread_mutex_lock(&lock);
+        atomic_fetch_add(&waiters, 1);
+        while (!ready(arg) && atomic_load(&queued) == 0)
+            pthread_cond_wait(&changed, &lock);
+        atomic_fetch_sub(&waiters, 1);
+        pthread_mutex_unlock(&lock);
+    }
+}
+
+static bool job_done(const void *arg)
+{
+    return atomic_load(&((pool_job *) arg)->done);
+}
+
+static bool more_finished(const void *arg)
+{
+    return atomic_load(&finished) > *(const unsigned int *) arg;
+}
+#endif
+
+void pool_start(void)
+{
+    #ifdef POOL_THREADS
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    long count = cores > 1 ? cores - 1 : 1;
+    const char *env = getenv("ASTRO_THREADS");
+    if (env && *env)
+        count = strtol(env, NULL, 10);
+    if (count < 1)
+        count = 1;
+    if (count > POOL_MAX_THREADS)
+        count = POOL_MAX_THREADS;
+
+    stopping = false;
+    for (thread_count = 0; thread_count < count; thread_count++)
+    {
+        if (pthread_create(&threads[thread_count], NULL, worker,
+                           (void *) (intptr_t) thread_count) != 0)
+        {
+            // e.g. a browser without shared memory; what's missing runs
+            // inline
+            fprintf(stderr, "WARNING: started %u of %ld worker threads\n",
+                    thread_count, count);
+            break;
+        }
+    }
+    #endif
+}
+
+void pool_stop(void)
+{
+    #ifdef POOL_THREADS
+    pthread_mutex_lock(&lock);
+    stopping = true;
+    pthread_cond_broadcast(&wake);
+    pthread_mutex_unlock(&lock);
+
+    for (unsigned int i = 0; i < thread_count; i++)
+        pthread_join(threads[i], NULL);
+    #endif
+    thread_count = 0;
+}
+
+unsigned int pool_threads(void)
+{
+    return thread_count;
+}
+
+void pool_submit(pool_job *job, pool_func func, void *arg)
+{
+    pool_submit_after(job, func, arg, NULL, 0);
+}
+
+void pool_submit_after(pool_job *job,
+                       pool_func func,
+                       void *arg,
+                       pool_job *const *deps,
+                       unsigned int count)
+{
+    job->func = func;
+    job->arg = arg;
+    job->successor_count = 0;
+    job->next = NULL;
+    atomic_store(&job->done, false);
+    // held by the submission until the dependencies are counted
+    atomic_store(&job->pending, 1);
+
+    EDGES_LOCK();
+    for (unsigned int i = 0; i < count; i++)
+    {
+        pool_job *dep = deps[i];
+        if (atomic_load(&dep->done))
+            continue;
+        if (dep->successor_count == POOL_MAX_SUCCESSORS)
+        {
+            fprintf(stderr, "ERROR: Too many jobs waiting for one.");
+            exit(EXIT_FAILURE);
+        }
+        dep->successors[dep->successor_count++] = job;
+        atomic_fetch_add(&job->pending, 1);
+    }
+    EDGES_UNLOCK();
+
+    if (atomic_fetch_sub(&job->pending, 1) == 1)
+        schedule(job);
+}
+
+bool pool_done(pool_job *job)
+{
+    return atomic_load(&job->done);
+}
+
+void pool_wait(pool_job *job)
+{
+    #ifdef POOL_THREADS
+    help_until(job_done, job);
+    #endif
+}
+
+typedef struct PoolRange
+{
+    pool_job job;
+    pool_range_func func;
+    void *arg;
+    unsigned int begin;
+    unsigned int end;
+} pool_range;
+
+static void run_range(void *arg)
+{
+    pool_range *range = (pool_range *) arg;
+    range->func(range->arg, range->begin, range->end);
+}
+
+void pool_parallel_for(unsigned int count,
+                       unsigned int grain,
+                       pool_range_func func,
+                       void *arg)
+{
+    if (grain < 1)
+        grain = 1;
+    if (thread_count == 0 || count <= grain)
+    {
+        if (count > 0)
+            func(arg, 0, count);
+        return;
+    }
+
+    unsigned int chunk = (count + POOL_FOR_CHUNKS - 1) / POOL_FOR_CHUNKS;
+    if (chunk < grain)
+        chunk = grain;
+    unsigned int chunks = (count + chunk - 1) / chunk;
+
+    // the first chunk is the calling thread's
+    pool_range ranges[POOL_FOR_CHUNKS];
+    for (unsigned int i = 1; i < chunks; i++)
+    {
+        ranges[i].func = func;
+        ranges[i].arg = arg;
+        ranges[i].begin = i * chunk;
+        ranges[i].end = i + 1 < chunks ? (i + 1) * chunk : count;
+        pool_submit(&ranges[i].job, run_range, &ranges[i]);
+    }
+    func(arg, 0, chunk);
+    for (unsigned int i = 1; i < chunks; i++)
+        pool_wait(&ranges[i].job);
+}
+
+unsigned int pool_finished(void)
+{
+    return atomic_load(&finished);
+}
+
+void pool_wait_finished(unsigned int count)
+{
+    #ifdef POOL_THREADS
+    if (thread_count > 0)
+        help_until(more_finished, &count);
+    #endif
+}
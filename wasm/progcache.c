@@ -0,0 +1,185 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <stdatomic.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "progcache.h"
+
+progcache_stats progstats;
+
+static bool enabled;
+static const char *cache_dir;
+static uint64_t driver_hash;
+static atomic_uint store_count;         // for the temporary files' names
+
+// 64-bit FNV-1a, continuing from h
+static uint64_t hash_bytes(uint64_t h, const void *data, size_t size)
+{
+    const unsigned char *p = (const unsigned char *) data;
+
+    for (size_t i = 0; i < size; i++)
+    {
+        h ^= p[i];
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+static uint64_t hash_string(uint64_t h, const char *s)
+{
+    // include the terminator so "ab" + "c" and "a" + "bc" differ
+    return hash_bytes(h, s ? s : "", s ? strlen(s) + 1 : 1);
+}
+
+static void entry_path(char *path, size_t size, uint64_t key)
+{
+    snprintf(path, size, "%s/%016llx.bin", cache_dir,
+             (unsigned long long) key);
+}
+
+void progcache_init(void)
+{
+    enabled = caps.program_binary;
+    if (!enabled)
+        return;
+
+    GLint formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    if (formats < 1)
+    {
+        enabled = false;
+        return;
+    }
+
+    cache_dir = getenv("ASTRO_CACHE_DIR");
+    if (cache_dir == NULL || *cache_dir == '\0')
+        cache_dir = "cache";
+    if (mkdir(cache_dir, 0755) != 0 && errno != EEXIST)
+    {
+        fprintf(stderr, "WARNING: no program cache, can't create %s\n",
+                cache_dir);
+        enabled = false;
+        return;
+    }
+
+    // a driver update invalidates every binary
+    driver_hash = 14695981039346656037ull;
+    driver_hash = hash_string(driver_hash,
+                              (const char *) glGetString(GL_VENDOR));
+    driver_hash = hash_string(driver_hash,
+                              (const char *) glGetString(GL_RENDERER));
+    driver_hash = hash_string(driver_hash,
+                              (const char *) glGetString(GL_VERSION));
+}
+
+uint64_t progcache_key(const char *const *parts, unsigned int count)
+{
+    uint64_t h = driver_hash;
+
+    for (unsigned int i = 0; i < count; i++)
+        h = hash_string(h, parts[i]);
+    return h;
+}
+
+GLuint progcache_load(uint64_t key)
+{
+    if (!enabled)
+        return 0;
+
+    char path[256];
+    entry_path(path, sizeof(path), key);
+
+    FILE *fp = fopen(path, "rb");
+    if (fp == NULL)
+        return 0;
+
+    progcache_header hdr;
+    void *binary = NULL;
+    GLuint program = 0;
+
+    if (fread(&hdr, sizeof(hdr), 1, fp) != 1 ||
+        memcmp(hdr.magic, PROGCACHE_MAGIC, 4) != 0 ||
+        hdr.version != PROGCACHE_VERSION ||
+        hdr.key != key ||
+        hdr.length == 0)
+        goto done;
+
+    binary = malloc(hdr.length);
+    if (binary == NULL || fread(binary, hdr.length, 1, fp) != 1)
+        goto done;
+
+    program = glCreateProgram();
+    glProgramBinary(program, hdr.format, binary, hdr.length);
+
+    // drivers may reject binaries for their own reasons; just rebuild
+    GLint linked = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    if (!linked)
+    {
+        glDeleteProgram(program);
+        program = 0;
+    }
+
+done:
+    free(binary);
+    fclose(fp);
+    return program;
+}
+
+void progcache_prepare(GLuint program)
+{
+    if (enabled)
+        glProgramParameteri(program,
+                            GL_PROGRAM_BINARY_RETRIEVABLE_HINT,
+                            GL_TRUE);
+}
+
+void progcache_store(uint64_t key, GLuint program)
+{
+    if (!enabled)
+        return;
+
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0)
+        return;
+
+    void *binary = malloc(length);
+    if (binary == NULL)
+        return;
+
+    progcache_header hdr;
+    GLenum format = 0;
+    glGetProgramBinary(program, length, &length, &format, binary);
+
+    memcpy(hdr.magic, PROGCACHE_MAGIC, 4);
+    hdr.version = PROGCACHE_VERSION;
+    hdr.key = key;
+    hdr.format = format;
+    hdr.length = length;
+
+    // write aside and rename, so a crash or another process storing the
+    // same program never leaves half an entry
+    char path[256];
+    char tmp[300];
+    entry_path(path, sizeof(path), key);
+    snprintf(tmp, sizeof(tmp), "%s.%ld.%u.tmp", path, (long) getpid(),
+             atomic_fetch_add(&store_count, 1));
+
+    FILE *fp = fopen(tmp, "wb");
+    if (fp != NULL)
+    {
+        bool ok = fwrite(&hdr, sizeof(hdr), 1, fp) == 1 &&
+                  fwrite(binary, length, 1, fp) == 1;
+        ok = fclose(fp) == 0 && ok;
+        if (!ok || rename(tmp, path) != 0)
+        {
+            fprintf(stderr, "WARNING: couldn't write %s\n", path);
+            remove(tmp);
+        }
+    }
+    free(binary);
+}
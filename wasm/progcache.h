@@ -0,0 +1,52 @@
+#ifndef ASTRO_PROGCACHE_H
+#define ASTRO_PROGCACHE_H
+
+#include <stdint.h>
+
+#include "glcaps.h"
+
+// On-disk cache of linked program binaries (caps.program_binary).
+//
+// A program is keyed by a hash of everything that goes into it: its shader
+// sources, the defines it was built with and the driver's vendor, renderer
+// and version strings. A hit is handed to glProgramBinary(); a missing,
+// stale or rejected entry falls back to compiling from source, and the new
+// binary replaces the entry. Entries live in ASTRO_CACHE_DIR, "cache" by
+// default, one file per key.
+#define PROGCACHE_MAGIC     "APPB"
+#define PROGCACHE_VERSION   1
+
+typedef struct ProgCacheHeader
+{
+    char magic[4];
+    uint32_t version;
+    uint64_t key;
+    uint32_t format;            // binary format from glGetProgramBinary()
+    uint32_t length;            // bytes of binary following the header
+} progcache_header;
+
+typedef struct ProgCacheStats
+{
+    unsigned int hits;          // programs loaded from the cache
+    unsigned int misses;        // programs compiled from source
+    double seconds;             // spent loading and compiling programs
+} progcache_stats;
+
+extern progcache_stats progstats;
+
+// Call once the context is current.
+void progcache_init(void);
+
+// Key of a program built from the count strings in parts.
+uint64_t progcache_key(const char *const *parts, unsigned int count);
+
+// The linked program cached under key, or 0.
+GLuint progcache_load(uint64_t key);
+
+// Ask for a retrievable binary; call before linking a program to store.
+void progcache_prepare(GLuint program);
+
+// Save the binary of the linked program under key.
+void progcache_store(uint64_t key, GLuint program);
+
+#endif
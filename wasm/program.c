@@ -0,0 +1,129 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "program.h"
+
+// FNV-1a, never 0 so that 0 can mark empty slots
+static unsigned int hash_name(const char *name)
+{
+    unsigned int h = 2166136261u;
+
+    while (*name)
+    {
+        h ^= (unsigned char) *name++;
+        h *= 16777619u;
+    }
+    return h ? h : 1;
+}
+
+// The slot holding name, or the empty slot where it would go; NULL only if
+// the table is full.
+static program_input *find(program_input *table, const char *name)
+{
+    unsigned int hash = hash_name(name);
+
+    for (unsigned int i = 0; i < PROGRAM_TABLE_SIZE; i++)
+    {
+        program_input *slot =
+            &table[(hash + i) & (PROGRAM_TABLE_SIZE - 1)];
+
+        if (slot->hash == 0 ||
+            (slot->hash == hash && strcmp(slot->name, name) == 0))
+            return slot;
+    }
+    return NULL;
+}
+
+static void insert(program *prog,
+                   program_input *table,
+                   const char *kind,
+                   const char *name,
+                   GLint location,
+                   GLenum type,
+                   GLint size)
+{
+    program_input *slot = find(table, name);
+
+    if (slot == NULL)
+    {
+        fprintf(stderr, "WARNING: too many %ss in %s, %s not recorded\n",
+                kind, prog->label, name);
+        return;
+    }
+    snprintf(slot->name, sizeof(slot->name), "%s", name);
+    slot->hash = hash_name(slot->name);
+    slot->location = location;
+    slot->type = type;
+    slot->size = size;
+}
+
+void program_reflect(program *prog, GLuint id, const char *label)
+{
+    GLint count = 0;
+    GLchar name[PROGRAM_NAME_LEN];
+    GLsizei length;
+    GLint size;
+    GLenum type;
+
+    memset(prog, 0, sizeof(*prog));
+    prog->id = id;
+    prog->label = label;
+
+    glGetProgramiv(id, GL_ACTIVE_UNIFORMS, &count);
+    for (GLint i = 0; i < count; i++)
+    {
+        glGetActiveUniform(id, i, sizeof(name), &length, &size, &type, name);
+
+        GLint location = glGetUniformLocation(id, name);
+        if (location < 0)
+            continue;
+
+        // arrays are reported as "name[0]"; look them up by the bare name
+        char *bracket = strchr(name, '[');
+        if (bracket)
+            *bracket = '\0';
+        insert(prog, prog->uniforms, "uniform", name, location, type, size);
+    }
+
+    glGetProgramiv(id, GL_ACTIVE_ATTRIBUTES, &count);
+    for (GLint i = 0; i < count; i++)
+    {
+        glGetActiveAttrib(id, i, sizeof(name), &length, &size, &type, name);
+        insert(prog,
+               prog->attributes,
+               "attribute",
+               name,
+               glGetAttribLocation(id, name),
+               type,
+               size);
+    }
+}
+
+static GLint lookup(program *prog,
+                    program_input *table,
+                    const char *kind,
+                    const char *name)
+{
+    program_input *slot = find(table, name);
+
+    if (slot && slot->hash)
+        return slot->location;
+
+    fprintf(stderr, "WARNING: %s has no active %s %s\n",
+            prog->label, kind, name);
+    // remember the miss so it is reported once
+    if (slot)
+        insert(prog, table, kind, name, -1, GL_NONE, 0);
+    return -1;
+}
+
+GLint program_uniform(program *prog, const char *name)
+{
+    return lookup(prog, prog->uniforms, "uniform", name);
+}
+
+GLint program_attribute(program *prog, const char *name)
+{
+    return lookup(prog, prog->attributes, "attribute", name);
+}
@@ -0,0 +1,39 @@
+#ifndef ASTRO_PROGRAM_H
+#define ASTRO_PROGRAM_H
+
+#include "glcaps.h"
+
+// A linked program and its active inputs.
+//
+// Right after linking, the active uniforms and attributes are enumerated
+// into a small hash table per program, so looking one up by name never goes
+// to the driver. A name the program doesn't have is reported the first time
+// it is looked up and gives -1, which glUniform*() ignores. Uniform block
+// members have no location and are left to ubo.c.
+#define PROGRAM_NAME_LEN    48
+#define PROGRAM_TABLE_SIZE  64          // per kind; a power of two
+
+typedef struct ProgramInput
+{
+    char name[PROGRAM_NAME_LEN];
+    unsigned int hash;                  // 0 marks an empty slot
+    GLint location;                     // -1 once reported missing
+    GLenum type;
+    GLint size;                         // array length
+} program_input;
+
+typedef struct Program
+{
+    GLuint id;
+    const char *label;                  // for messages
+    program_input uniforms[PROGRAM_TABLE_SIZE];
+    program_input attributes[PROGRAM_TABLE_SIZE];
+} program;
+
+// Fill in prog's tables from the linked program id.
+void program_reflect(program *prog, GLuint id, const char *label);
+
+GLint program_uniform(program *prog, const char *name);
+GLint program_attribute(program *prog, const char *name);
+
+#endif
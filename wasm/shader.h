@@ -0,0 +1,79 @@
+#ifndef ASTRO_SHADER_H
+#define ASTRO_SHADER_H
+
+#include "glcaps.h"
+#include "program.h"
+
+// Shader programs, built from preprocessed sources.
+//
+// A source may #include "name" another, found next to it, up to
+// SHADER_MAX_DEPTH deep. A variant of a program is built with the #define
+// of each of its SHADER_* features inserted after the #version line, so it
+// carries only the code it uses instead of branching on uniforms. Variants
+// are built the first time they are asked for and kept.
+//
+// Builds are asynchronous: compiling and linking is issued up front and the
+// result collected later, so the driver can work while textures are decoded
+// and meshes built, on its own threads where it has
+// KHR_parallel_shader_compile. Drawing goes ahead with what is ready.
+//
+// Attributes are bound to fixed locations before linking, so all programs
+// share one vertex layout and a VAO works with every variant.
+#define SHADER_MAX_DEPTH    8
+#define SHADER_MAX_VARIANTS 16
+
+#define SHADER_ATTRIB_POSITION              0
+#define SHADER_ATTRIB_TEXTURE               1
+#define SHADER_ATTRIB_NORMAL                2
+#define SHADER_ATTRIB_INSTANCE_MODEL_VIEW   3   // a mat4, so 3 to 6
+#define SHADER_ATTRIB_INSTANCE_PARAMS       7
+
+enum
+{
+    SHADER_NO_LIGHTING  = 1 << 0,   // ambient only, for far away bodies;
+                                    // overrides the others
+    SHADER_NIGHT_LIGHTS = 1 << 1,   // night map on the dark side
+    SHADER_ECLIPSE      = 1 << 2,   // shadows cast by the frame's occluders
+    SHADER_ATMOSPHERE   = 1 << 3,   // scattering rim along the limb
+    SHADER_VIRTUAL_TEXTURE = 1 << 4,    // colour from a vtex, see vtex.h
+};
+
+// Called once for each new variant, to set its constant state.
+typedef void (*shader_setup)(program *prog, unsigned int features);
+
+typedef enum ShaderState
+{
+    SHADER_PENDING,             // compiling and linking
+    SHADER_READY,
+    SHADER_FAILED,
+} shader_state;
+
+// Call once caps is known.
+void shader_init(void);
+
+// filename with its includes expanded and defines inserted; free() it.
+char *shader_source(const char *filename, const char *defines);
+
+// Start building the variant of the program with features, unless it has
+// been asked for before, and say how far it got. A cached binary is ready
+// at once; a build from source finishes in a later shader_poll().
+shader_state shader_request(const char *vert_filename,
+                            const char *frag_filename,
+                            unsigned int features,
+                            shader_setup setup);
+
+// The variant, or NULL while it is pending or if it doesn't build. It is
+// requested if need be. setup may be NULL.
+program *shader_variant(const char *vert_filename,
+                        const char *frag_filename,
+                        unsigned int features,
+                        shader_setup setup);
+
+// Collect the builds that have finished, and return how many haven't. With
+// caps.parallel_compile this never waits; otherwise every pending build is
+// collected, waiting for those the driver is still busy with.
+unsigned int shader_poll(void);
+
+void shader_variants_destroy(void);
+
+#endif
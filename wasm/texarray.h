@@ -0,0 +1,47 @@
+#ifndef ASTRO_TEXARRAY_H
+#define ASTRO_TEXARRAY_H
+
+#include "glcaps.h"
+#include "texload.h"
+#include "texstream.h"
+
+// Colour maps of the bodies, packed into one texture so the body pass binds
+// it once and picks a map by the per-instance layer.
+//
+// With caps.texture_array each map is a layer of a GL_TEXTURE_2D_ARRAY. On
+// GLES2 the maps are stacked top to bottom in a plain 2D atlas instead, and
+// the shader moves v into the layer's band with texarray_layer_scale().
+// Either way the maps are resized at load to one common resolution: the
+// smallest of their sizes, halved until it fits the GL limits, and then by
+// the levels asked to be dropped. Layers from KTX2 files stream their finer
+// levels in; see texstream.h.
+#define TEXARRAY_MAX_LAYERS 64
+
+typedef struct TexArray
+{
+    GLuint texture;
+    GLenum target;              // GL_TEXTURE_2D_ARRAY, or GL_TEXTURE_2D
+    unsigned int layers;
+    int width;                  // size of one layer
+    int height;
+    unsigned int levels;
+    size_t bytes;               // of all the levels of all the layers
+    tex_stream stream;
+} tex_array;
+
+// Make layers 0 to count - 1 of the loaded images, drop levels smaller than
+// they'd be otherwise. Once it has, it releases the images when their levels
+// are uploaded, which may be some frames later; they have to stay where they
+// are until then. If it fails they stay the caller's.
+int texarray_load_images(tex_array *ta,
+                         tex_image *images,
+                         unsigned int count,
+                         unsigned int drop);
+// Load the count images in files and make layers of them.
+int texarray_load(tex_array *ta, const char *const *files, unsigned int count);
+void texarray_destroy(tex_array *ta);
+
+// For the atlas: layer l covers v from l * scale to (l + 1) * scale.
+float texarray_layer_scale(const tex_array *ta);
+
+#endif
@@ -0,0 +1,49 @@
+#ifndef ASTRO_TEXCACHE_H
+#define ASTRO_TEXCACHE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "ktx.h"
+#include "asset.h"
+
+// On-disk cache of images transcoded for this context, for the ones that
+// have no KTX2 version baked next to them (see ktxtex.h), such as images
+// users drop in.
+//
+// The first load of such an image decodes it, builds its mip chain and
+// writes it as a KTX2 file: ETC2 with caps.etc2, RGBA8 otherwise. Later
+// loads map that file and upload it the way they would a baked one, with
+// nothing decoded. An entry is keyed by a hash of the image file's bytes
+// and of what it was made for (the format and caps.npot), so an edited
+// image or another GPU gets an entry of its own. Entries live in
+// ASTRO_CACHE_DIR, "cache" by default, next to the program binaries (see
+// progcache.h); a stale one is never read again, and can be deleted.
+//
+// With emscripten there is no cache: its files don't outlast the page.
+#define TEXCACHE_VERSION    1
+// block rows per job of the ETC2 encoding
+#define TEXCACHE_ETC_ROWS   8
+
+// Call once the caps are known, before any textures load.
+void texcache_init(void);
+bool texcache_enabled(void);
+
+// Key of the image whose file is the size bytes at data.
+uint64_t texcache_key(const void *data, size_t size);
+
+// Open the entry of key into ktx, holding its bytes in file until
+// asset_release(). Returns -1 on a miss.
+int texcache_open(uint64_t key, ktx_file *ktx, asset_span *file);
+
+// Write the entry of key from levels RGBA8 mip levels of a width x height
+// image, laid out the way pixels_build_chain() makes them. Safe on any
+// thread. Returns -1 if it couldn't.
+int texcache_store(uint64_t key,
+                   const unsigned char *chain,
+                   uint32_t width,
+                   uint32_t height,
+                   unsigned int levels);
+
+#endif
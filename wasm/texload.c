@@ -0,0 +1,194 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include <stb_image.h>
+
+#include "texload.h"
+#include "ktxtex.h"
+#include "texture.h"
+#include "pixels.h"
+#include "bmp.h"
+#include "texcache.h"
+#include "memstats.h"
+
+#define GLFW_INCLUDE_NONE
+#include <GLFW/glfw3.h>
+
+// Free the levels of img, which are counted against its file.
+static void free_pixels(tex_image *img)
+{
+    if (img->pixels)
+        memstats_sub(memstats_asset(img->file), MEM_HEAP,
+                     pixels_chain_size(img->width, img->height,
+                                       img->levels));
+    free(img->pixels);
+    img->pixels = NULL;
+}
+
+static bool is_bmp(const char *file)
+{
+    size_t length = strlen(file);
+    return length > 4 && strcasecmp(file + length - 4, ".bmp") == 0;
+}
+
+int texload_decode(tex_image *img)
+{
+    asset_span file;
+    if (asset_load(img->file, &file) != 0)
+        return -1;
+
+    // BMPs are only a byte shuffle away from RGBA, see bmp.h
+    int w = 0, h = 0, n;
+    unsigned char *data;
+    if (is_bmp(img->file))
+    {
+        uint32_t bmp_width = 0, bmp_height = 0;
+        data = bmp_decode(file.data,
+                          file.size,
+                          img->file,
+                          &bmp_width,
+                          &bmp_height);
+        w = bmp_width;
+        h = bmp_height;
+    }
+    else
+        data = stbi_load_from_memory(file.data,
+                                     (int) file.size,
+                                     &w, &h, &n,
+                                     STBI_rgb_alpha);
+    asset_release(&file);
+    if (data == NULL)
+        return -1;
+
+    img->width = w;
+    img->height = h;
+    img->levels = 1;
+    if ((img->flags & TEXLOAD_MIPS) && texture_mipmappable(w, h))
+        img->levels = texture_levels(w, h);
+
+    // both decoders allocate with malloc(), so the chain can grow in place
+    if (img->levels > 1)
+    {
+        size_t size = pixels_chain_size(w, h, img->levels);
+        unsigned char *chain = (unsigned char *) realloc(data, size);
+        if (chain == NULL)
+        {
+            fprintf(stderr, "ERROR: Couldn't allocate mip levels.");
+            exit(EXIT_FAILURE);
+        }
+        data = chain;
+        pixels_build_chain(data, w, h, img->levels);
+    }
+    img->pixels = data;
+    memstats_add(memstats_asset(img->file), MEM_HEAP,
+                 pixels_chain_size(w, h, img->levels));
+    return 0;
+}
+
+// An image with no baked KTX2 version: the one in the cache, transcoded
+// now if it isn't there yet. Returns -1 without one, having decoded the
+// image if it got that far.
+static int load_cached(tex_image *img)
+{
+    asset_span file;
+    if (asset_load(img->file, &file) != 0)
+        return -1;
+    uint64_t key = texcache_key(file.data, file.size);
+    asset_release(&file);
+
+    img->source = "cache";
+    if (texcache_open(key, &img->ktx, &img->ktx_file) == 0)
+        return 0;
+
+    // the entry has the whole chain, whatever this load asked for
+    unsigned int flags = img->flags;
+    img->flags |= TEXLOAD_MIPS;
+    int status = texload_decode(img);
+    img->flags = flags;
+    img->source = "decoded";
+    if (status != 0 ||
+        texcache_store(key, img->pixels, img->width, img->height,
+                       img->levels) != 0 ||
+        texcache_open(key, &img->ktx, &img->ktx_file) != 0)
+        return -1;
+
+    free_pixels(img);
+    img->source = "transcoded";
+    return 0;
+}
+
+static void load(void *arg)
+{
+    tex_image *img = (tex_image *) arg;
+    double start = glfwGetTime();
+
+    img->source = "baked";
+    img->has_ktx = ktxtex_open(&img->ktx, &img->ktx_file, img->file) == 0;
+    if (!img->has_ktx && texcache_enabled())
+        img->has_ktx = load_cached(img) == 0;
+
+    if (img->has_ktx)
+    {
+        img->width = img->ktx.header->pixel_width;
+        img->height = img->ktx.header->pixel_height;
+        img->levels = img->ktx.header->level_count;
+        img->status = 0;
+    }
+    else if (img->pixels)
+        img->status = 0;
+    else
+    {
+        img->source = "decoded";
+        img->status = texload_decode(img);
+    }
+
+    img->load_ms = (glfwGetTime() - start) * 1000.0;
+}
+
+void texload_request(tex_image *img, const char *file, unsigned int flags)
+{
+    memset(img, 0, sizeof(*img));
+    img->file = file;
+    img->flags = flags;
+    img->status = -1;
+    // before any worker filters with them
+    pixels_init();
+    pool_submit(&img->job, load, img);
+}
+
+bool texload_ready(tex_image *img)
+{
+    return pool_done(&img->job);
+}
+
+int texload_wait(tex_image *img)
+{
+    pool_wait(&img->job);
+    return img->status;
+}
+
+void texload_report(const tex_image *img)
+{
+    if (img->status != 0)
+        fprintf(stderr, "texture %s: failed after %.1f ms\n",
+                img->file, img->load_ms);
+    else if (img->has_ktx)
+        fprintf(stderr, "texture %s: %s KTX2 %s %ux%u, %u levels, %.1f ms\n",
+                img->file, img->source,
+                img->ktx.header->vk_format == KTX_VK_FORMAT_ETC2_R8G8B8_UNORM
+                ? "etc2" : "rgba",
+                img->width, img->height, img->levels, img->load_ms);
+    else
+        fprintf(stderr, "texture %s: decoded %ux%u, %u levels, %.1f ms\n",
+                img->file, img->width, img->height, img->levels, img->load_ms);
+}
+
+void texload_release(tex_image *img)
+{
+    if (img->has_ktx)
+        asset_release(&img->ktx_file);
+    free_pixels(img);
+    img->has_ktx = false;
+}
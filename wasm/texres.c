@@ -0,0 +1,377 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "texres.h"
+#include "ktxtex.h"
+#include "texture.h"
+#include "pixels.h"
+#include "glstate.h"
+#include "memstats.h"
+
+#define GLFW_INCLUDE_NONE
+#include <GLFW/glfw3.h>
+
+#define MB  (1024.0 * 1024.0)
+
+tex_res_stats texres_stats;
+
+static tex_resident *residents[TEXRES_MAX];
+static unsigned int resident_count;
+static unsigned long frame;
+
+static GLuint resident_texture(const tex_resident *tr)
+{
+    return tr->array ? tr->layers.texture : tr->texture;
+}
+
+// Load the files again; whatever is still streaming from the last load of
+// them stops where it is.
+static void request(tex_resident *tr)
+{
+    texstream_cancel(tr->array ? &tr->layers.stream : &tr->stream);
+    for (unsigned int i = 0; i < tr->count; i++)
+    {
+        texload_release(&tr->images[i]);
+        texload_request(&tr->images[i], tr->files[i], tr->flags);
+    }
+    tr->loading = true;
+}
+
+static void unmake(tex_resident *tr)
+{
+    if (tr->array)
+    {
+        texarray_destroy(&tr->layers);
+    }
+    else
+    {
+        texstream_cancel(&tr->stream);
+        if (tr->texture)
+            gls_delete_texture(tr->texture);
+        tr->texture = 0;
+    }
+    texres_stats.bytes -= tr->bytes;
+    tr->bytes = 0;
+}
+
+// The 2D texture of the image, less its top tr->drop levels, streaming in
+// from the image.
+static GLuint make_2d(tex_resident *tr)
+{
+    tex_image *img = &tr->images[0];
+    // baked by texbake; the decoded image is the fallback
+    if (img->has_ktx)
+    {
+        GLuint texture = ktxtex_create(&img->ktx, tr->drop,
+                                       &tr->stream, tr->name);
+        texstream_start(&tr->stream, img, 1);
+        return texture;
+    }
+
+    // without caps.npot a NPOT texture gets neither mips nor GL_REPEAT
+    bool mipmappable = texture_mipmappable(img->width, img->height);
+    if (!mipmappable)
+    {
+        fprintf(stderr,
+                "WARNING: texture %s is not power-of-2 dimensions, "
+                "so it has no mipmaps and is clamped\n",
+                img->file);
+    }
+
+    // the dropped levels are skipped in the chain
+    unsigned int drop = tr->drop < img->levels ? tr->drop : img->levels - 1;
+    const unsigned char *chain = img->pixels;
+    uint32_t width = img->width;
+    uint32_t height = img->height;
+    for (unsigned int l = 0; l < drop; l++)
+    {
+        chain += (size_t) width * height * 4;
+        pixels_half_size(width, height, &width, &height);
+    }
+
+    GLuint texture;
+    glGenTextures(1, &texture);
+    gls_bind_texture(GL_TEXTURE_2D, texture);
+    glTexParameteri(GL_TEXTURE_2D,
+                    GL_TEXTURE_WRAP_S,
+                    mipmappable ? GL_REPEAT : GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D,
+                    GL_TEXTURE_WRAP_T,
+                    mipmappable ? GL_REPEAT : GL_CLAMP_TO_EDGE);
+    texture_filter(GL_TEXTURE_2D, img->levels - drop);
+    texture_image_chain(GL_TEXTURE_2D, NULL, width, height,
+                        img->levels - drop);
+    texstream_init(&tr->stream, tr->name, texture, GL_TEXTURE_2D, GL_RGBA,
+                   width, height, img->levels - drop, 1);
+    texstream_source_chain(&tr->stream, 0, chain);
+    texstream_start(&tr->stream, img, 1);
+    return texture;
+}
+
+// Swap in the texture of the loaded files; the images are released once its
+// levels are uploaded.
+static int make(tex_resident *tr)
+{
+    double start = glfwGetTime();
+
+    for (unsigned int i = 0; i < tr->count; i++)
+    {
+        texload_report(&tr->images[i]);
+        if (tr->images[i].status != 0)
+        {
+            fprintf(stderr, "Failed to load texture %s\n",
+                    tr->images[i].file);
+            tr->failed = true;
+        }
+    }
+    unmake(tr);
+    if (!tr->failed && tr->array &&
+        texarray_load_images(&tr->layers, tr->images, tr->count,
+                             tr->drop) == 0)
+    {
+        tr->bytes = tr->layers.bytes;
+        tr->size = tr->layers.width > tr->layers.height ? tr->layers.width
+                                                        : tr->layers.height;
+        tr->mipmapped = tr->layers.levels > 1;
+    }
+    else if (!tr->failed && !tr->array)
+    {
+        tr->texture = make_2d(tr);
+        tr->bytes = texstream_bytes(&tr->stream);
+        tr->size = tr->stream.width > tr->stream.height ? tr->stream.width
+                                                        : tr->stream.height;
+        tr->mipmapped = tr->stream.levels > 1;
+    }
+    else
+    {
+        tr->failed = true;
+        for (unsigned int i = 0; i < tr->count; i++)
+            texload_release(&tr->images[i]);
+        return -1;
+    }
+
+    texres_stats.bytes += tr->bytes;
+    memstats_gl(MEM_TEXTURE, resident_texture(tr), tr->name, tr->bytes);
+    fprintf(stderr, "upload %s: %u x %u, %.1f MB, %.1f ms\n",
+            tr->name,
+            tr->array ? (uint32_t) tr->layers.width : tr->stream.width,
+            tr->array ? (uint32_t) tr->layers.height : tr->stream.height,
+            tr->bytes / MB, (glfwGetTime() - start) * 1000.0);
+    return 0;
+}
+
+void texres_init(tex_resident *tr,
+                 const char *name,
+                 const char *const *files,
+                 unsigned int count,
+                 unsigned int flags,
+                 bool array)
+{
+    if (resident_count == TEXRES_MAX || count == 0 ||
+        count > TEXARRAY_MAX_LAYERS)
+    {
+        fprintf(stderr, "ERROR: Too many textures.");
+        exit(EXIT_FAILURE);
+    }
+
+    if (texres_stats.budget == 0)
+    {
+        texres_stats.budget = (size_t) TEXRES_BUDGET_MB * 1024 * 1024;
+        const char *env = getenv("ASTRO_TEXTURE_BUDGET");
+        if (env && *env && strtoul(env, NULL, 10) > 0)
+            texres_stats.budget = (size_t) strtoul(env, NULL, 10) *
+                                  1024 * 1024;
+    }
+
+    memset(tr, 0, sizeof(*tr));
+    tr->name = name;
+    tr->files = files;
+    tr->count = count;
+    tr->flags = flags;
+    tr->array = array;
+    residents[resident_count++] = tr;
+    request(tr);
+}
+
+bool texres_poll(tex_resident *tr)
+{
+    if (tr->loading)
+    {
+        for (unsigned int i = 0; i < tr->count; i++)
+            if (!texload_ready(&tr->images[i]))
+                return false;
+        tr->loading = false;
+        make(tr);
+    }
+    return resident_texture(tr) != 0;
+}
+
+int texres_wait(tex_resident *tr)
+{
+    if (tr->loading)
+        for (unsigned int i = 0; i < tr->count; i++)
+            texload_wait(&tr->images[i]);
+    return texres_poll(tr) ? 0 : -1;
+}
+
+void texres_reload(tex_resident *tr)
+{
+    if (tr->loading)
+        for (unsigned int i = 0; i < tr->count; i++)
+            texload_wait(&tr->images[i]);
+    unmake(tr);
+    tr->failed = false;
+    tr->next_bytes = 0;
+    texres_stats.reloads++;
+    request(tr);
+}
+
+void texres_destroy(tex_resident *tr)
+{
+    if (tr->loading)
+        for (unsigned int i = 0; i < tr->count; i++)
+            texload_wait(&tr->images[i]);
+    unmake(tr);
+    for (unsigned int i = 0; i < tr->count; i++)
+        texload_release(&tr->images[i]);
+    tr->loading = false;
+
+    for (unsigned int i = 0; i < resident_count; i++)
+    {
+        if (residents[i] == tr)
+        {
+            residents[i] = residents[--resident_count];
+            break;
+        }
+    }
+}
+
+GLuint texres_use(tex_resident *tr)
+{
+    GLuint texture = resident_texture(tr);
+
+    tr->used = frame;
+    // evicted: back as soon as the pool has loaded it
+    if (texture == 0 && !tr->loading && !tr->failed)
+    {
+        tr->next_bytes = 0;
+        texres_stats.reloads++;
+        request(tr);
+    }
+    return texture;
+}
+
+void texres_pin(size_t bytes)
+{
+    texres_stats.pinned += bytes;
+}
+
+void texres_unpin(size_t bytes)
+{
+    texres_stats.pinned -= bytes < texres_stats.pinned ? bytes
+                                                       : texres_stats.pinned;
+}
+
+// The least recently drawn texture not drawn last frame, or with drawn,
+// the biggest that can still lose a level.
+static tex_resident *victim(bool drawn)
+{
+    tex_resident *found = NULL;
+
+    for (unsigned int i = 0; i < resident_count; i++)
+    {
+        tex_resident *tr = residents[i];
+        if (resident_texture(tr) == 0 || tr->loading)
+            continue;
+        if (!drawn && tr->used + 1 < frame &&
+            (found == NULL || tr->used < found->used))
+            found = tr;
+        if (drawn && tr->mipmapped && tr->size > TEXRES_MIN_SIZE &&
+            (found == NULL || tr->bytes > found->bytes))
+            found = tr;
+    }
+    return found;
+}
+
+static void report(double now)
+{
+    static int enabled = -1;
+    static double last;
+    static tex_res_stats counted;
+
+    if (enabled < 0)
+    {
+        enabled = getenv("ASTRO_TEX_STATS") != NULL;
+        last = now;
+    }
+    double seconds = now - last;
+    if (!enabled || seconds < TEXRES_STATS_SECONDS)
+        return;
+
+    fprintf(stderr,
+            "textures: %.1f MB + %.1f MB pinned of %.1f MB, "
+            "%.2f evictions/s, %.2f drops/s, %.2f reloads/s\n",
+            texres_stats.bytes / MB,
+            texres_stats.pinned / MB,
+            texres_stats.budget / MB,
+            (texres_stats.evictions - counted.evictions) / seconds,
+            (texres_stats.drops - counted.drops) / seconds,
+            (texres_stats.reloads - counted.reloads) / seconds);
+    counted = texres_stats;
+    last = now;
+}
+
+void texres_update(void)
+{
+    frame++;
+    for (unsigned int i = 0; i < resident_count; i++)
+        texres_poll(residents[i]);
+
+    // a texture being made again counts at the size it's going to be
+    size_t total = texres_stats.pinned;
+    for (unsigned int i = 0; i < resident_count; i++)
+        total += residents[i]->loading ? residents[i]->next_bytes
+                                       : residents[i]->bytes;
+
+    while (total > texres_stats.budget)
+    {
+        tex_resident *tr = victim(false);
+        if (tr)
+        {
+            total -= tr->bytes;
+            unmake(tr);
+            texres_stats.evictions++;
+            continue;
+        }
+        tr = victim(true);
+        if (tr == NULL)
+            break;
+        tr->next_bytes = tr->bytes / 4;
+        total -= tr->bytes - tr->next_bytes;
+        tr->drop++;
+        texres_stats.drops++;
+        request(tr);
+    }
+
+    // room again: the one drawn most recently gets a level back, one a
+    // frame, if it fits at four times the size
+    tex_resident *grow = NULL;
+    for (unsigned int i = 0; i < resident_count; i++)
+    {
+        tex_resident *tr = residents[i];
+        if (tr->drop > 0 && !tr->loading && resident_texture(tr) != 0 &&
+            total + tr->bytes * 3 <= texres_stats.budget &&
+            (grow == NULL || tr->used > grow->used))
+            grow = tr;
+    }
+    if (grow)
+    {
+        grow->next_bytes = grow->bytes * 4;
+        grow->drop--;
+        texres_stats.reloads++;
+        request(grow);
+    }
+
+    report(glfwGetTime());
+}
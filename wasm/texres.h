@@ -0,0 +1,90 @@
+#ifndef ASTRO_TEXRES_H
+#define ASTRO_TEXRES_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "glcaps.h"
+#include "texload.h"
+#include "texstream.h"
+#include "texarray.h"
+
+// Textures made from their files, kept within a GPU memory budget.
+//
+// Every resident texture is counted at the bytes of all its levels, and
+// texres_use() marks the frame it was last drawn in. Once a frame
+// texres_update() brings the total back under TEXRES_BUDGET_MB (or
+// ASTRO_TEXTURE_BUDGET, in MB): textures not drawn last frame are evicted,
+// least recently drawn first; if that isn't enough, the biggest of those
+// drawn loses its top level, down to TEXRES_MIN_SIZE texels a side. The
+// files are loaded again on the pool to make them: an evicted texture the
+// next time it is drawn, a reduced one a level at a time once the budget has
+// room for the level again. Until the new one is made the old one stays.
+//
+// With ASTRO_TEX_STATS set, the usage and the evictions, drops and reloads
+// per second are printed every TEXRES_STATS_SECONDS.
+#define TEXRES_BUDGET_MB        48
+#define TEXRES_MIN_SIZE         128
+#define TEXRES_MAX              8
+#define TEXRES_STATS_SECONDS    5.0
+
+typedef struct TexResident
+{
+    const char *name;
+    const char *const *files;
+    unsigned int count;
+    unsigned int flags;         // TEXLOAD_ ones
+    bool array;                 // a tex_array of the files, else a 2D
+    tex_image images[TEXARRAY_MAX_LAYERS];
+    bool loading;
+    bool failed;                // its files don't load; not tried again
+    tex_array layers;           // with array
+    GLuint texture;             // without
+    tex_stream stream;          // of texture
+    size_t bytes;
+    size_t next_bytes;          // what the load under way should make
+    uint32_t size;              // longest side of the top level
+    bool mipmapped;             // so it can lose levels
+    unsigned int drop;          // top levels left out
+    unsigned long used;         // frame last drawn in
+} tex_resident;
+
+typedef struct TexResStats
+{
+    size_t bytes;               // of the resident textures
+    size_t pinned;              // of others, counted against the budget
+    size_t budget;
+    unsigned long evictions;
+    unsigned long drops;        // top levels dropped
+    unsigned long reloads;
+} tex_res_stats;
+
+extern tex_res_stats texres_stats;
+
+// Start loading the count files of tr. With array they are the layers of a
+// tex_array, otherwise files[0] is a 2D texture.
+void texres_init(tex_resident *tr,
+                 const char *name,
+                 const char *const *files,
+                 unsigned int count,
+                 unsigned int flags,
+                 bool array);
+// Make the texture if its files have loaded. Returns whether it is there.
+bool texres_poll(tex_resident *tr);
+// Wait for the files and make the texture. Returns -1 if it can't be made.
+int texres_wait(tex_resident *tr);
+// Start making it again from its files, e.g. for other caps.
+void texres_reload(tex_resident *tr);
+void texres_destroy(tex_resident *tr);
+
+// The texture to draw with this frame, or 0 while it's not resident.
+GLuint texres_use(tex_resident *tr);
+
+// Count the bytes of textures made elsewhere against the budget.
+void texres_pin(size_t bytes);
+void texres_unpin(size_t bytes);
+
+// Once a frame, before the textures are used.
+void texres_update(void);
+
+#endif
@@ -0,0 +1,262 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "texstream.h"
+#include "glstate.h"
+#include "pixels.h"
+
+static tex_stream *streams[TEXSTREAM_MAX];
+static unsigned int stream_count;
+static size_t budget;
+
+static uint32_t level_size(uint32_t size, unsigned int level)
+{
+    return size >> level ? size >> level : 1;
+}
+
+// Texel rows that go up together: a row of ETC2 blocks is four.
+static uint32_t row_unit(const tex_stream *ts)
+{
+    return ts->format == GL_RGBA ? 1 : 4;
+}
+
+// Bytes of one row unit of a level width texels wide.
+static size_t row_bytes(const tex_stream *ts, uint32_t width)
+{
+    return ts->format == GL_RGBA ? (size_t) width * 4
+                                 : (size_t) (width + 3) / 4 * 8;
+}
+
+static size_t layer_bytes(const tex_stream *ts, unsigned int level)
+{
+    uint32_t height = level_size(ts->height, level);
+    uint32_t unit = row_unit(ts);
+    return row_bytes(ts, level_size(ts->width, level)) *
+           ((height + unit - 1) / unit);
+}
+
+// count rows of a level of a layer from row on; count is whole row units
+// unless it reaches the bottom.
+static void upload_rows(const tex_stream *ts,
+                        unsigned int layer,
+                        unsigned int level,
+                        uint32_t row,
+                        uint32_t count)
+{
+    uint32_t width = level_size(ts->width, level);
+    uint32_t height = level_size(ts->height, level);
+    uint32_t unit = row_unit(ts);
+    size_t bytes = row_bytes(ts, width);
+    const unsigned char *src = ts->data[layer * ts->levels + level] +
+                               row / unit * bytes;
+    bool array = ts->target == GL_TEXTURE_2D_ARRAY;
+    // the layers of a 2D target are stacked
+    GLint y = (GLint) (array ? row : layer * height + row);
+    GLsizei size = (GLsizei) ((count + unit - 1) / unit * bytes);
+
+    if (array && ts->format == GL_RGBA)
+        glTexSubImage3D(ts->target, level, 0, y, layer, width, count, 1,
+                        GL_RGBA, GL_UNSIGNED_BYTE, src);
+    else if (array)
+        glCompressedTexSubImage3D(ts->target, level, 0, y, layer,
+                                  width, count, 1, ts->format, size, src);
+    else if (ts->format == GL_RGBA)
+        glTexSubImage2D(ts->target, level, 0, y, width, count,
+                        GL_RGBA, GL_UNSIGNED_BYTE, src);
+    else
+        glCompressedTexSubImage2D(ts->target, level, 0, y, width, count,
+                                  ts->format, size, src);
+}
+
+// Upload about limit bytes of the level ts is on, at least one row unit.
+// Returns the bytes uploaded.
+static size_t stream_step(tex_stream *ts, size_t limit)
+{
+    unsigned int level = ts->base - 1;
+    uint32_t height = level_size(ts->height, level);
+    uint32_t unit = row_unit(ts);
+    size_t bytes = row_bytes(ts, level_size(ts->width, level));
+
+    size_t units = limit / bytes;
+    uint32_t count = height - ts->row;
+    if (units < count / unit)
+        count = (uint32_t) (units ? units : 1) * unit;
+    upload_rows(ts, ts->layer, level, ts->row, count);
+    ts->row += count;
+
+    if (ts->row == height)
+    {
+        ts->row = 0;
+        if (++ts->layer == ts->layers)
+        {
+            ts->layer = 0;
+            ts->base = level;
+            if (caps.base_level)
+                glTexParameteri(ts->target, GL_TEXTURE_BASE_LEVEL, level);
+        }
+    }
+    return (count + unit - 1) / unit * bytes;
+}
+
+static void stream_release(tex_stream *ts)
+{
+    for (unsigned int i = 0; i < ts->image_count; i++)
+        texload_release(&ts->images[i]);
+    free(ts->data);
+    ts->data = NULL;
+    ts->images = NULL;
+    ts->image_count = 0;
+
+    for (unsigned int i = 0; i < stream_count; i++)
+    {
+        if (streams[i] == ts)
+        {
+            streams[i] = streams[--stream_count];
+            break;
+        }
+    }
+    ts->active = false;
+}
+
+void texstream_init(tex_stream *ts,
+                    const char *name,
+                    GLuint texture,
+                    GLenum target,
+                    GLenum format,
+                    uint32_t width,
+                    uint32_t height,
+                    unsigned int levels,
+                    unsigned int layers)
+{
+    memset(ts, 0, sizeof(*ts));
+    ts->name = name;
+    ts->texture = texture;
+    ts->target = target;
+    ts->format = format;
+    ts->width = width;
+    ts->height = height;
+    ts->levels = levels;
+    ts->layers = layers;
+    ts->base = levels;
+    ts->data = (const unsigned char **) calloc((size_t) levels * layers,
+                                               sizeof(*ts->data));
+    if (ts->data == NULL)
+    {
+        fprintf(stderr, "ERROR: Couldn't allocate texture stream.");
+        exit(EXIT_FAILURE);
+    }
+}
+
+void texstream_source(tex_stream *ts,
+                      unsigned int layer,
+                      unsigned int level,
+                      const void *data)
+{
+    ts->data[layer * ts->levels + level] = (const unsigned char *) data;
+}
+
+void texstream_source_chain(tex_stream *ts,
+                            unsigned int layer,
+                            const unsigned char *chain)
+{
+    uint32_t width = ts->width;
+    uint32_t height = ts->height;
+
+    for (unsigned int l = 0; l < ts->levels; l++)
+    {
+        texstream_source(ts, layer, l, chain);
+        chain += (size_t) width * height * 4;
+        pixels_half_size(width, height, &width, &height);
+    }
+}
+
+void texstream_start(tex_stream *ts, tex_image *images, unsigned int count)
+{
+    if (budget == 0)
+    {
+        budget = TEXSTREAM_BUDGET;
+        const char *env = getenv("ASTRO_STREAM_BUDGET");
+        if (env && *env && strtoul(env, NULL, 10) > 0)
+            budget = strtoul(env, NULL, 10);
+    }
+
+    ts->images = images;
+    ts->image_count = count;
+    ts->active = true;
+
+    // the coarse levels, or everything where there's no streaming
+    unsigned int coarse = ts->levels - 1;
+    if (!caps.base_level || stream_count == TEXSTREAM_MAX)
+        coarse = 0;
+    while (coarse > 0 &&
+           level_size(ts->width, coarse - 1) <= TEXSTREAM_COARSE &&
+           level_size(ts->height, coarse - 1) <= TEXSTREAM_COARSE)
+        coarse--;
+
+    gls_bind_texture(ts->target, ts->texture);
+    while (ts->base > coarse)
+        stream_step(ts, SIZE_MAX);
+
+    if (ts->base == 0)
+        stream_release(ts);
+    else
+        streams[stream_count++] = ts;
+}
+
+void texstream_finish(tex_stream *ts)
+{
+    if (!ts->active)
+        return;
+
+    gls_bind_texture(ts->target, ts->texture);
+    while (ts->base > 0)
+        stream_step(ts, SIZE_MAX);
+    stream_release(ts);
+}
+
+void texstream_cancel(tex_stream *ts)
+{
+    if (ts->active)
+        stream_release(ts);
+}
+
+size_t texstream_bytes(const tex_stream *ts)
+{
+    size_t bytes = 0;
+    for (unsigned int l = 0; l < ts->levels; l++)
+        bytes += layer_bytes(ts, l) * ts->layers;
+    return bytes;
+}
+
+unsigned int texstream_update(void)
+{
+    size_t sent = 0;
+
+    while (sent < budget && stream_count > 0)
+    {
+        // the level that costs least goes first, so every texture gets
+        // sharper before any gets its finest level
+        unsigned int next = 0;
+        for (unsigned int i = 1; i < stream_count; i++)
+            if (layer_bytes(streams[i], streams[i]->base - 1) *
+                streams[i]->layers <
+                layer_bytes(streams[next], streams[next]->base - 1) *
+                streams[next]->layers)
+                next = i;
+
+        tex_stream *ts = streams[next];
+        gls_bind_texture(ts->target, ts->texture);
+        sent += stream_step(ts, budget - sent);
+        if (ts->base == 0)
+        {
+            fprintf(stderr, "stream %s: %u levels in %u frames\n",
+                    ts->name, ts->levels, ts->frames + 1);
+            stream_release(ts);
+        }
+    }
+
+    for (unsigned int i = 0; i < stream_count; i++)
+        streams[i]->frames++;
+    return stream_count;
+}
@@ -0,0 +1,84 @@
+#ifndef ASTRO_TEXSTREAM_H
+#define ASTRO_TEXSTREAM_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "glcaps.h"
+#include "texload.h"
+
+// Mip levels uploaded over the frames after a texture is made, so that
+// making it costs the same whatever its size.
+//
+// texstream_start() uploads the levels up to TEXSTREAM_COARSE texels a side
+// at once and the texture is drawn with those. Each frame texstream_update()
+// then uploads rows of the next finer level of every stream, the coarsest
+// level of them all first, until TEXSTREAM_BUDGET bytes (or
+// ASTRO_STREAM_BUDGET) have gone; GL_TEXTURE_BASE_LEVEL follows the finest
+// level complete in every layer, so the texture sharpens a level at a time.
+// ETC2 goes up in rows of blocks.
+//
+// Without caps.base_level (GLES2 and WebGL1) there is no sampling part of a
+// chain, and all of it is uploaded at start.
+#define TEXSTREAM_COARSE        128
+#define TEXSTREAM_BUDGET        (512 * 1024)
+#define TEXSTREAM_MAX           8   // streaming at once
+
+typedef struct TexStream
+{
+    const char *name;
+    GLuint texture;
+    GLenum target;              // GL_TEXTURE_2D, or GL_TEXTURE_2D_ARRAY
+    GLenum format;              // GL_RGBA, or GL_COMPRESSED_RGB8_ETC2
+    uint32_t width;             // of level 0
+    uint32_t height;
+    unsigned int levels;
+    unsigned int layers;        // stacked top to bottom in a 2D target
+    const unsigned char **data; // each layer's levels
+    unsigned int base;          // finest level uploaded in every layer
+    unsigned int layer;         // the rows of level base - 1 next
+    uint32_t row;
+    tex_image *images;          // released when it's done
+    unsigned int image_count;
+    unsigned int frames;
+    bool active;
+} tex_stream;
+
+// Start a stream into texture, which is bound to target with storage for
+// every level. format is the texture's.
+void texstream_init(tex_stream *ts,
+                    const char *name,
+                    GLuint texture,
+                    GLenum target,
+                    GLenum format,
+                    uint32_t width,
+                    uint32_t height,
+                    unsigned int levels,
+                    unsigned int layers);
+// Where a level of a layer comes from: its rows packed, top to bottom.
+void texstream_source(tex_stream *ts,
+                      unsigned int layer,
+                      unsigned int level,
+                      const void *data);
+// Every level of a layer from an RGBA8 chain laid out the way
+// pixels_build_chain() makes it.
+void texstream_source_chain(tex_stream *ts,
+                            unsigned int layer,
+                            const unsigned char *chain);
+
+// Upload the coarse levels, and the rest over the next frames. The count
+// images the sources point into are released when it's done; they have to
+// stay where they are until then.
+void texstream_start(tex_stream *ts, tex_image *images, unsigned int count);
+// Upload what is left of ts now.
+void texstream_finish(tex_stream *ts);
+// Stop ts, uploading no more, for a texture about to be deleted.
+void texstream_cancel(tex_stream *ts);
+
+// GPU bytes of the texture ts streams into, all its levels and layers.
+size_t texstream_bytes(const tex_stream *ts);
+
+// Once a frame. Returns the streams still going.
+unsigned int texstream_update(void);
+
+#endif
@@ -0,0 +1,55 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "texture.h"
+#include "ktx.h"
+#include "pixels.h"
+
+bool texture_mipmappable(uint32_t width, uint32_t height)
+{
+    return caps.npot ||
+           ((width & (width - 1)) == 0 && (height & (height - 1)) == 0);
+}
+
+unsigned int texture_levels(uint32_t width, uint32_t height)
+{
+    return ktx_chain_length(width, height);
+}
+
+void texture_filter(GLenum target, unsigned int levels)
+{
+    glTexParameteri(target,
+                    GL_TEXTURE_MIN_FILTER,
+                    levels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+    glTexParameteri(target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    if (caps.anisotropy > 1.0f && levels > 1)
+    {
+        float anisotropy = TEXTURE_MAX_ANISOTROPY;
+        const char *env = getenv("ASTRO_ANISOTROPY");
+        if (env && *env)
+            anisotropy = strtof(env, NULL);
+        if (anisotropy > caps.anisotropy)
+            anisotropy = caps.anisotropy;
+        if (anisotropy >= 1.0f)
+            glTexParameterf(target,
+                            GL_TEXTURE_MAX_ANISOTROPY_EXT,
+                            anisotropy);
+    }
+}
+
+void texture_image_chain(GLenum target,
+                         const unsigned char *chain,
+                         uint32_t width,
+                         uint32_t height,
+                         unsigned int levels)
+{
+    for (unsigned int l = 0; l < levels; l++)
+    {
+        glTexImage2D(target, l, GL_RGBA, width, height, 0,
+                     GL_RGBA, GL_UNSIGNED_BYTE, chain);
+        if (chain)
+            chain += (size_t) width * height * 4;
+        pixels_half_size(width, height, &width, &height);
+    }
+}
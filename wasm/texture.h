@@ -0,0 +1,32 @@
+#ifndef ASTRO_TEXTURE_H
+#define ASTRO_TEXTURE_H
+
+#include <stdint.h>
+
+#include "glcaps.h"
+
+// Sampling state shared by every texture: trilinear filtering over a full
+// mip chain wherever the texture can have one, plus anisotropic filtering
+// with caps.anisotropy, up to TEXTURE_MAX_ANISOTROPY or ASTRO_ANISOTROPY.
+#define TEXTURE_MAX_ANISOTROPY  8.0f
+
+// Whether a width x height texture can be mipmapped and repeat; without
+// caps.npot only power of two sizes can.
+bool texture_mipmappable(uint32_t width, uint32_t height);
+
+// Filters for the bound target with levels mip levels to sample.
+void texture_filter(GLenum target, unsigned int levels);
+
+// Levels of a full mip chain from width x height down to 1 x 1.
+unsigned int texture_levels(uint32_t width, uint32_t height);
+
+// Upload levels RGBA8 mip levels to the bound 2D target, from a chain laid
+// out the way pixels_build_chain() makes it; with chain NULL, just make the
+// storage for them.
+void texture_image_chain(GLenum target,
+                         const unsigned char *chain,
+                         uint32_t width,
+                         uint32_t height,
+                         unsigned int levels);
+
+#endif
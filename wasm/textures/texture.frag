@@ -4,38 +4,76 @@
 precision mediump float;
 #endif
 
+#include "lighting.glsl"
+#include "vtex.glsl"
+
 varying vec2 texture_coord;
+#ifndef NO_LIGHTING
 varying vec3 normal;
 varying vec3 light_vector;
+#endif
+#if defined(ECLIPSE) || defined(ATMOSPHERE)
+varying vec3 surface_position;
+#endif
+#ifdef NIGHT_LIGHTS
+varying vec2 night_coord;
+#endif
+#ifdef VIRTUAL_TEXTURE
+varying VT_HIGHP vec2 virtual_coord;
+#endif
 
 uniform sampler2D texture_sampler;
 uniform vec3 ambient_colour; // The light and object's combined ambient colour
 uniform vec3 diffuse_colour; // The light and object's combined diffuse colour
+#ifdef ECLIPSE
+uniform vec4 occluders[MAX_OCCLUDERS]; // View space centre, radius in w
+#endif
 
 const float inv_radius_square = 0.00001;
 
 void main()
 {
     // Base colour (from the diffuse texture)
+#ifdef VIRTUAL_TEXTURE
+    vec4 colour = virtual_texture(virtual_coord);
+#else
     vec4 colour = texture2D(texture_sampler, texture_coord);
+#endif
     //vec4 colour = texture2D(texture_sampler, gl_FragCoord);
 
     // Ambient lighting
     vec3 ambient = vec3(ambient_colour * colour.xyz);
 
+#ifdef NO_LIGHTING
+    gl_FragColor = vec4(ambient, colour.w);
+#else
     // Calculate the light attenuation, and direction
     float dist_square = dot(light_vector, light_vector);
     float attenuation = clamp(1.0 - inv_radius_square * sqrt(dist_square),
                               0.0,
                               1.0);
     vec3 light_direction = light_vector * inversesqrt(dist_square);
+    vec3 surface_normal = normalize(normal);
+    float n_dot_l = dot(light_direction, surface_normal);
 
     // Diffuse lighting
-    vec3 diffuse = max(dot(light_direction, normal),
-                       0.0) * diffuse_colour * colour.xyz;
+    vec3 diffuse = max(n_dot_l, 0.0) * diffuse_colour * colour.xyz;
+#ifdef ECLIPSE
+    diffuse *= eclipse(surface_position, light_direction, occluders);
+#endif
 
     // The final colour
     // NOTE: Alpha channel shouldn't be affected by lights
     vec3 final_colour = (ambient + diffuse) * attenuation;
+#ifdef NIGHT_LIGHTS
+    final_colour += night_lights(texture2D(texture_sampler, night_coord).xyz,
+                                 n_dot_l);
+#endif
+#ifdef ATMOSPHERE
+    final_colour += atmosphere_rim(surface_normal,
+                                   normalize(-surface_position),
+                                   n_dot_l);
+#endif
     gl_FragColor = vec4(final_colour, colour.w);
+#endif
 }
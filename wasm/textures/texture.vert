@@ -4,31 +4,63 @@ attribute vec3 vertex_position;
 attribute vec2 vertex_texture;
 attribute vec3 vertex_normal;
 
+// Per instance: rigid model-view matrix, made on the CPU once per frame;
+// radius scaling the unit sphere, texture layer and night map layer
+attribute mat4 instance_model_view;
+attribute vec3 instance_params;
+
 varying vec2 texture_coord;
+#ifndef NO_LIGHTING
 varying vec3 normal;
 varying vec3 light_vector;
+#endif
+#if defined(ECLIPSE) || defined(ATMOSPHERE)
+varying vec3 surface_position;
+#endif
+#ifdef NIGHT_LIGHTS
+varying vec2 night_coord;
+#endif
+#ifdef VIRTUAL_TEXTURE
+varying vec2 virtual_coord;
+#endif
 
-uniform mat4 mv_mat;
-uniform mat4 normal_mat;
 uniform mat4 proj_mat;
+#ifndef NO_LIGHTING
 uniform vec3 light_position;
+#endif
+uniform float layer_scale;  // height of one layer in the texture atlas
 
 // NOTE: position in view space (so after
 // (being transformed by its own MV matrix)
 void main()
 {
-    // Pass on the texture coordinate
-    texture_coord = vertex_texture;
+    // Pass on the texture coordinate, in the instance's atlas layer
+    texture_coord = vec2(vertex_texture.x,
+                         (instance_params.y + vertex_texture.y) * layer_scale);
+#ifdef NIGHT_LIGHTS
+    night_coord = vec2(vertex_texture.x,
+                       (instance_params.z + vertex_texture.y) * layer_scale);
+#endif
+#ifdef VIRTUAL_TEXTURE
+    virtual_coord = vertex_texture;
+#endif
 
     // Calc. the position in view space
-    vec4 view_position = mv_mat * vec4(vertex_position, 1.0);
+    vec4 view_position = instance_model_view *
+                         vec4(vertex_position * instance_params.x, 1.0);
 
     // Calc the position
     gl_Position = proj_mat * view_position;
 
-    // Transform the normal
-    normal = normalize((normal_mat * vec4(vertex_normal, 1.0)).xyz);
+#ifndef NO_LIGHTING
+    // Transform the normal; the model-view is rigid, so it's its own normal
+    // matrix
+    normal = normalize((instance_model_view * vec4(vertex_normal, 0.0)).xyz);
 
     // Calc. the light vector
     light_vector = light_position - view_position.xyz;
+#endif
+#if defined(ECLIPSE) || defined(ATMOSPHERE)
+    surface_position = view_position.xyz;
+#endif
 }
@@ -0,0 +1,60 @@
+#version 300 es
+
+in vec3 vertex_position;
+in vec2 vertex_texture;
+in vec3 vertex_normal;
+
+// Per instance: rigid model-view matrix, made on the CPU once per frame;
+// radius scaling the unit sphere, texture layer and night map layer
+in mat4 instance_model_view;
+in vec3 instance_params;
+
+out vec3 texture_coord;
+#ifndef NO_LIGHTING
+out vec3 normal;
+out vec3 light_vector;
+#endif
+#if defined(ECLIPSE) || defined(ATMOSPHERE)
+out vec3 surface_position;
+#endif
+#ifdef NIGHT_LIGHTS
+out vec3 night_coord;
+#endif
+#ifdef VIRTUAL_TEXTURE
+out vec2 virtual_coord;
+#endif
+
+#include "frame.glsl"
+
+// NOTE: position in view space (so after
+// (being transformed by its own MV matrix)
+void main()
+{
+    // Pass on the texture coordinate, and the instance's texture layer
+    texture_coord = vec3(vertex_texture, instance_params.y);
+#ifdef NIGHT_LIGHTS
+    night_coord = vec3(vertex_texture, instance_params.z);
+#endif
+#ifdef VIRTUAL_TEXTURE
+    virtual_coord = vertex_texture;
+#endif
+
+    // Calc. the position in view space
+    vec4 view_position = instance_model_view *
+                         vec4(vertex_position * instance_params.x, 1.0);
+
+    // Calc the position
+    gl_Position = proj_mat * view_position;
+
+#ifndef NO_LIGHTING
+    // Transform the normal; the model-view is rigid, so its rotation is
+    // enough
+    normal = normalize(mat3(instance_model_view) * vertex_normal);
+
+    // Calc. the light vector
+    light_vector = light_position.xyz - view_position.xyz;
+#endif
+#if defined(ECLIPSE) || defined(ATMOSPHERE)
+    surface_position = view_position.xyz;
+#endif
+}
@@ -0,0 +1,40 @@
+// Sampling the virtual texture (see vtex.h). The indirection texture has a
+// texel per tile, and a mip level per pyramid level; biased by the tile size
+// its mip selection picks the tile level the hardware wants at this pixel,
+// and the texel names the slot in the atlas and the level of the tile
+// loaded there for it.
+
+#ifdef VIRTUAL_TEXTURE
+#if __VERSION__ >= 300
+#define VT_SAMPLE texture
+#else
+#define VT_SAMPLE texture2D
+#endif
+
+// tile coordinates need more than mediump's 10 bits
+#ifdef GL_FRAGMENT_PRECISION_HIGH
+#define VT_HIGHP highp
+#else
+#define VT_HIGHP mediump
+#endif
+
+// as in vtfile.h
+const float vt_tile_size = 128.0;
+const float vt_border = 4.0;
+const float vt_physical = 136.0;
+const float vt_lod_bias = 7.0;      // log2(vt_tile_size)
+
+uniform sampler2D vt_indirection;
+uniform sampler2D vt_atlas;
+uniform VT_HIGHP vec3 vt_params; // level 0 tiles across and down, atlas size
+
+vec4 virtual_texture(VT_HIGHP vec2 uv)
+{
+    vec4 entry = floor(VT_SAMPLE(vt_indirection, uv, vt_lod_bias) * 255.0 +
+                       0.5);
+    VT_HIGHP vec2 tiles = max(vt_params.xy * exp2(-entry.z), 1.0);
+    VT_HIGHP vec2 texel = entry.xy * vt_physical + vt_border +
+                          fract(uv * tiles) * vt_tile_size;
+    return VT_SAMPLE(vt_atlas, texel / vt_params.z);
+}
+#endif
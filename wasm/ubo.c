@@ -0,0 +1,95 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ubo.h"
+#include "glstate.h"
+#include "glstats.h"
+#include "memstats.h"
+
+// Each ring segment holds one Frame block, starting on
+// GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT.
+static GLuint ring;
+static GLintptr segment_size;
+static unsigned int segment;
+
+static GLintptr align_up(GLintptr size, GLintptr align)
+{
+    return (size + align - 1) / align * align;
+}
+
+void ubo_init(void)
+{
+    if (!caps.ubo)
+        return;
+
+    GLint align = 0;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &align);
+    if (align < 1)
+        align = 256;
+
+    segment_size = align_up(sizeof(frame_uniforms), align);
+    segment = 0;
+
+    glGenBuffers(1, &ring);
+    gls_bind_buffer(GL_UNIFORM_BUFFER, ring);
+    glBufferData(GL_UNIFORM_BUFFER,
+                 segment_size * UBO_RING_FRAMES,
+                 NULL,
+                 GL_DYNAMIC_DRAW);
+    memstats_gl(MEM_BUFFER, ring, "frame uniforms",
+                segment_size * UBO_RING_FRAMES);
+}
+
+void ubo_destroy(void)
+{
+    if (!caps.ubo)
+        return;
+
+    gls_delete_buffer(ring);
+    ring = 0;
+}
+
+static void bind_block(GLuint program,
+                       const char *name,
+                       GLuint binding,
+                       GLsizeiptr expected_size)
+{
+    GLuint index = glGetUniformBlockIndex(program, name);
+    if (index == GL_INVALID_INDEX)
+        return;
+
+    GLint size = 0;
+    glGetActiveUniformBlockiv(program, index, GL_UNIFORM_BLOCK_DATA_SIZE, &size);
+    if (size != expected_size)
+    {
+        fprintf(stderr,
+                "WARNING: uniform block %s is %d bytes, expected %d\n",
+                name, size, (int) expected_size);
+    }
+    glUniformBlockBinding(program, index, binding);
+}
+
+void ubo_program(GLuint program)
+{
+    if (!caps.ubo)
+        return;
+
+    bind_block(program, "Frame", UBO_FRAME_BINDING, sizeof(frame_uniforms));
+}
+
+void ubo_frame(const frame_uniforms *frame)
+{
+    segment = (segment + 1) % UBO_RING_FRAMES;
+
+    gls_bind_buffer(GL_UNIFORM_BUFFER, ring);
+    GL_CALL(glBufferSubData(GL_UNIFORM_BUFFER,
+                            segment * segment_size,
+                            sizeof(*frame),
+                            frame));
+    gls_bind_buffer_range(GL_UNIFORM_BUFFER,
+                          UBO_FRAME_BINDING,
+                          ring,
+                          segment * segment_size,
+                          sizeof(frame_uniforms));
+}
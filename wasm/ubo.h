@@ -0,0 +1,42 @@
+#ifndef ASTRO_UBO_H
+#define ASTRO_UBO_H
+
+#include <cglm/cglm.h>
+
+#include "glcaps.h"
+
+// Uniform buffers for GLES3 / WebGL2 (caps.ubo).
+//
+// Per-frame data lives in the std140 block "Frame", written once per frame
+// and shared by every program that declares it. Frames go round a ring of
+// UBO_RING_FRAMES segments, so a frame never overwrites data the GPU may
+// still be reading for an earlier one. Per-object data comes from the
+// instance attributes (instance.h). The C struct below mirrors the std140
+// layout of the block, textures/frame.glsl, exactly.
+#define UBO_FRAME_BINDING   0
+#define UBO_RING_FRAMES     3
+#define FRAME_MAX_OCCLUDERS 4   // MAX_OCCLUDERS in textures/frame.glsl
+
+typedef struct FrameUniforms
+{
+    mat4 view_mat;
+    mat4 proj_mat;
+    vec4 light_position;        // view space, w unused
+    vec4 ambient_colour;        // w unused
+    vec4 diffuse_colour;        // w unused
+    vec4 occluders[FRAME_MAX_OCCLUDERS];    // view space centre, radius in w;
+                                            // radius 0 for none
+    vec4 time;                  // x = seconds since start
+} frame_uniforms;
+
+void ubo_init(void);
+void ubo_destroy(void);
+
+// Point the Frame block of program, if it has one, at the shared binding
+// point.
+void ubo_program(GLuint program);
+
+// Upload this frame's data into the next ring segment and bind it.
+void ubo_frame(const frame_uniforms *frame);
+
+#endif
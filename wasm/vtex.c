@@ -0,0 +1,523 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "vtex.h"
+#include "ktx.h"
+#include "glstate.h"
+#include "memstats.h"
+
+// Tiles of this level across or fewer are always taken as visible and
+// refined: the test below only samples a tile's corners, edges and centre.
+#define VTEX_COARSE_TILES   4
+
+// What vtex_update() needs to know of the view, on the unit sphere in model
+// space.
+typedef struct VTexView
+{
+    vec3 eye;
+    mat4 mvp;                   // from the unit sphere
+    float pixel;                // size of a pixel at distance 1
+    float texel_u;              // of level 0 along the equator
+    float texel_v;
+} vtex_view;
+
+static uint32_t tiles_x(const vtex *vt, unsigned int level)
+{
+    return vt_level_tiles_x(&vt->file.header, level);
+}
+
+static uint32_t tiles_y(const vtex *vt, unsigned int level)
+{
+    return vt_level_tiles_y(&vt->file.header, level);
+}
+
+static void tile_coords(const vtex *vt,
+                        uint32_t tile,
+                        unsigned int *level,
+                        uint32_t *x,
+                        uint32_t *y)
+{
+    unsigned int l = vt->file.header.levels - 1;
+    while (l > 0 && vt->file.level_first[l] > tile)
+        l--;
+
+    uint32_t i = tile - vt->file.level_first[l];
+    *level = l;
+    *x = i % tiles_x(vt, l);
+    *y = i / tiles_x(vt, l);
+}
+
+// Point the indirection texels of tile (level, x, y) and of all those under
+// it at value: those that show a coarser tile when a tile comes in, or those
+// that show match when it goes.
+static void repoint(vtex *vt,
+                    unsigned int level,
+                    uint32_t x,
+                    uint32_t y,
+                    const unsigned char *match,
+                    const unsigned char value[4])
+{
+    gls_active_texture(GL_TEXTURE0 + VTEX_INDIRECTION_UNIT);
+    gls_bind_texture(GL_TEXTURE_2D, vt->indirection);
+
+    for (int m = level; m >= 0; m--)
+    {
+        uint32_t width = tiles_x(vt, m);
+        uint32_t scale_x = width / tiles_x(vt, level);
+        uint32_t scale_y = tiles_y(vt, m) / tiles_y(vt, level);
+
+        for (uint32_t ty = y * scale_y; ty < (y + 1) * scale_y; ty++)
+        {
+            for (uint32_t tx = x * scale_x; tx < (x + 1) * scale_x; tx++)
+            {
+                unsigned char *e = &vt->entries[m][(ty * width + tx) * 4];
+                if (match ? memcmp(e, match, 3) == 0 : e[2] > level)
+                    memcpy(e, value, 4);
+            }
+        }
+        // whole rows, which are contiguous
+        glTexSubImage2D(GL_TEXTURE_2D, m, 0, y * scale_y, width, scale_y,
+                        GL_RGBA, GL_UNSIGNED_BYTE,
+                        &vt->entries[m][y * scale_y * width * 4]);
+    }
+}
+
+static void upload(vtex *vt, uint32_t tile, unsigned int slot, const void *data)
+{
+    const vt_header *hdr = &vt->file.header;
+    unsigned char value[4] = { slot % vt->slots, slot / vt->slots, 0, 255 };
+    unsigned int level;
+    uint32_t x, y;
+    tile_coords(vt, tile, &level, &x, &y);
+    value[2] = level;
+
+    gls_active_texture(GL_TEXTURE0 + VTEX_ATLAS_UNIT);
+    gls_bind_texture(GL_TEXTURE_2D, vt->atlas);
+    if (hdr->vk_format == KTX_VK_FORMAT_ETC2_R8G8B8_UNORM)
+        glCompressedTexSubImage2D(GL_TEXTURE_2D, 0,
+                                  value[0] * VT_PHYSICAL,
+                                  value[1] * VT_PHYSICAL,
+                                  VT_PHYSICAL, VT_PHYSICAL,
+                                  GL_COMPRESSED_RGB8_ETC2,
+                                  hdr->tile_bytes, data);
+    else
+        glTexSubImage2D(GL_TEXTURE_2D, 0,
+                        value[0] * VT_PHYSICAL,
+                        value[1] * VT_PHYSICAL,
+                        VT_PHYSICAL, VT_PHYSICAL,
+                        GL_RGBA, GL_UNSIGNED_BYTE, data);
+
+    vt->slot_tile[slot] = tile;
+    vt->slot_used[slot] = vt->frame;
+    vt->tile_slot[tile] = slot;
+    repoint(vt, level, x, y, NULL, value);
+    vt->loaded++;
+}
+
+// Give the slot's tile up; its texels show what its parent's show.
+static void evict(vtex *vt, unsigned int slot)
+{
+    uint32_t tile = vt->slot_tile[slot];
+    unsigned int level;
+    uint32_t x, y;
+    tile_coords(vt, tile, &level, &x, &y);
+
+    unsigned char match[3] = { slot % vt->slots, slot / vt->slots, level };
+    uint32_t px = x * tiles_x(vt, level + 1) / tiles_x(vt, level);
+    uint32_t py = y * tiles_y(vt, level + 1) / tiles_y(vt, level);
+    unsigned char parent[4];
+    memcpy(parent,
+           &vt->entries[level + 1][(py * tiles_x(vt, level + 1) + px) * 4],
+           4);
+
+    repoint(vt, level, x, y, match, parent);
+    vt->tile_slot[tile] = VTEX_NONE;
+    vt->slot_tile[slot] = VTEX_NONE;
+    vt->evicted++;
+}
+
+// A free slot, or else the one used longest ago, but not this frame.
+static unsigned int find_slot(const vtex *vt)
+{
+    unsigned int best = VTEX_NONE;
+
+    for (unsigned int s = 0; s < vt->slots * vt->slots; s++)
+    {
+        if (vt->slot_tile[s] == VTEX_NONE)
+            return s;
+        if (vt->slot_used[s] != vt->frame &&
+            vt->slot_used[s] != VTEX_NONE &&
+            (best == VTEX_NONE || vt->slot_used[s] < vt->slot_used[best]))
+            best = s;
+    }
+    return best;
+}
+
+static void read_tile(void *arg)
+{
+    vtex_load *load = (vtex_load *) arg;
+    load->status = vt_read_tile(&load->vt->file, load->tile, load->data);
+}
+
+static void unit_point(float s, float t, vec3 n)
+{
+    float lat = GLM_PI_2f - GLM_PIf * t;
+    float lon = 2.0f * GLM_PIf * s;
+
+    n[0] = cosf(lat) * cosf(lon);
+    n[1] = cosf(lat) * sinf(lon);
+    n[2] = sinf(lat);
+}
+
+// Whether any of the tile is in view, and if so the finest level the
+// hardware would pick on it.
+static bool examine(const vtex *vt,
+                    const vtex_view *view,
+                    unsigned int level,
+                    uint32_t x,
+                    uint32_t y,
+                    float *wanted_level)
+{
+    uint32_t across = tiles_x(vt, level);
+    uint32_t down = tiles_y(vt, level);
+    bool visible = false;
+
+    *wanted_level = level;
+    if (across <= VTEX_COARSE_TILES)
+    {
+        *wanted_level = 0.0f;
+        return true;
+    }
+
+    for (int j = 0; j <= 2; j++)
+    {
+        for (int i = 0; i <= 2; i++)
+        {
+            float t = (y + 0.5f * j) / down;
+            vec3 n, to_eye;
+            unit_point((x + 0.5f * i) / across, t, n);
+            glm_vec3_sub((float *) view->eye, n, to_eye);
+
+            float distance = glm_vec3_norm(to_eye);
+            float facing = glm_vec3_dot(n, to_eye) / distance;
+            vec4 clip;
+            glm_mat4_mulv((vec4 *) view->mvp, (vec4){ n[0], n[1], n[2], 1 },
+                          clip);
+            if (facing < -0.1f || clip[3] <= 0.0f ||
+                fabsf(clip[0]) > 1.2f * clip[3] ||
+                fabsf(clip[1]) > 1.2f * clip[3])
+                continue;
+            visible = true;
+
+            // a pixel's footprint against the smaller texel side, which
+            // shrinks towards the poles the way u does
+            float footprint = distance * view->pixel /
+                              (facing > 0.2f ? facing : 0.2f);
+            float along_u = view->texel_u * fabsf(sinf(GLM_PIf * t));
+            float texel = fminf(fmaxf(along_u, 0.02f * view->texel_u),
+                                view->texel_v);
+            float lod = log2f(footprint / texel) + 0.5f;
+            if (lod < *wanted_level)
+                *wanted_level = lod > 0.0f ? lod : 0.0f;
+        }
+    }
+    return visible;
+}
+
+// The tiles the view wants, coarse first, up to as many as there are slots.
+static uint32_t wanted_tiles(vtex *vt, const vtex_view *view)
+{
+    const vt_header *hdr = &vt->file.header;
+    uint32_t capacity = vt->slots * vt->slots;
+    uint32_t count = 0;
+
+    vt->wanted[count++] = vt_tile_index(&vt->file, hdr->levels - 1, 0, 0);
+    for (uint32_t head = 0; head < count; head++)
+    {
+        unsigned int level;
+        uint32_t x, y;
+        float wanted_level;
+        tile_coords(vt, vt->wanted[head], &level, &x, &y);
+        if (level == 0 ||
+            !examine(vt, view, level, x, y, &wanted_level) ||
+            wanted_level >= level)
+            continue;
+
+        // children, whose numbers depend on which sides are still halving
+        uint32_t scale_x = tiles_x(vt, level - 1) / tiles_x(vt, level);
+        uint32_t scale_y = tiles_y(vt, level - 1) / tiles_y(vt, level);
+        for (uint32_t cy = y * scale_y; cy < (y + 1) * scale_y; cy++)
+        {
+            for (uint32_t cx = x * scale_x; cx < (x + 1) * scale_x; cx++)
+            {
+                float child_level;
+                if (count < capacity &&
+                    examine(vt, view, level - 1, cx, cy, &child_level))
+                    vt->wanted[count++] = vt_tile_index(&vt->file,
+                                                        level - 1, cx, cy);
+            }
+        }
+    }
+    return count;
+}
+
+int vtex_open(vtex *vt, const char *filename)
+{
+    memset(vt, 0, sizeof(*vt));
+    if (vt_open(&vt->file, filename) != 0)
+        return -1;
+
+    const vt_header *hdr = &vt->file.header;
+    bool etc2 = hdr->vk_format == KTX_VK_FORMAT_ETC2_R8G8B8_UNORM;
+    GLint max_size = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &max_size);
+    vt->slots = VTEX_ATLAS_SLOTS;
+    while (vt->slots > 1 && (GLint) (vt->slots * VT_PHYSICAL) > max_size)
+        vt->slots--;
+    if ((etc2 && !caps.etc2) || vt->slots < 4 ||
+        (GLint) hdr->tiles_x > max_size || (GLint) hdr->tiles_y > max_size)
+    {
+        fprintf(stderr, "WARNING: virtual texture %s can't be used here\n",
+                filename);
+        vt_close(&vt->file);
+        return -1;
+    }
+
+    unsigned int slot_count = vt->slots * vt->slots;
+    vt->slot_tile = (uint32_t *) malloc(slot_count * sizeof(uint32_t));
+    vt->slot_used = (uint32_t *) calloc(slot_count, sizeof(uint32_t));
+    vt->tile_slot = (uint32_t *) malloc(vt->file.tile_count *
+                                        sizeof(uint32_t));
+    vt->loading = (unsigned char *) calloc(vt->file.tile_count, 1);
+    vt->wanted = (uint32_t *) malloc(slot_count * sizeof(uint32_t));
+    bool failed = !vt->slot_tile || !vt->slot_used || !vt->tile_slot ||
+                  !vt->loading || !vt->wanted;
+    for (unsigned int l = 0; l < hdr->levels; l++)
+    {
+        // coarser than every level, so the top tile replaces it all
+        size_t size = (size_t) tiles_x(vt, l) * tiles_y(vt, l) * 4;
+        vt->entries[l] = (unsigned char *) malloc(size);
+        failed = failed || vt->entries[l] == NULL;
+        if (vt->entries[l])
+            memset(vt->entries[l], 0xff, size);
+    }
+    for (unsigned int i = 0; i < VTEX_MAX_LOADS; i++)
+    {
+        vt->loads[i].vt = vt;
+        vt->loads[i].tile = VTEX_NONE;
+        vt->loads[i].data = (unsigned char *) malloc(hdr->tile_bytes);
+        failed = failed || vt->loads[i].data == NULL;
+    }
+    if (failed)
+    {
+        fprintf(stderr, "ERROR: Couldn't allocate the virtual texture.");
+        exit(EXIT_FAILURE);
+    }
+    memset(vt->slot_tile, 0xff, slot_count * sizeof(uint32_t));
+    memset(vt->tile_slot, 0xff, vt->file.tile_count * sizeof(uint32_t));
+
+    vt->heap_bytes = slot_count * sizeof(uint32_t) * 3 +
+                     vt->file.tile_count * (sizeof(uint32_t) + 1) +
+                     (size_t) VTEX_MAX_LOADS * hdr->tile_bytes;
+    for (unsigned int l = 0; l < hdr->levels; l++)
+        vt->heap_bytes += (size_t) tiles_x(vt, l) * tiles_y(vt, l) * 4;
+    vt->mem_asset = memstats_asset(filename);
+    memstats_add(vt->mem_asset, MEM_HEAP, vt->heap_bytes);
+
+    vt->uploads = VTEX_UPLOADS;
+    const char *env = getenv("ASTRO_VT_UPLOADS");
+    if (env && *env)
+        vt->uploads = strtoul(env, NULL, 10);
+
+    // one texel per tile, picked from the level the hardware wants
+    glGenTextures(1, &vt->indirection);
+    gls_active_texture(GL_TEXTURE0 + VTEX_INDIRECTION_UNIT);
+    gls_bind_texture(GL_TEXTURE_2D, vt->indirection);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
+                    GL_NEAREST_MIPMAP_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    size_t indirection_bytes = 0;
+    for (unsigned int l = 0; l < hdr->levels; l++)
+    {
+        glTexImage2D(GL_TEXTURE_2D, l, GL_RGBA, tiles_x(vt, l), tiles_y(vt, l),
+                     0, GL_RGBA, GL_UNSIGNED_BYTE, vt->entries[l]);
+        indirection_bytes += (size_t) tiles_x(vt, l) * tiles_y(vt, l) * 4;
+    }
+    memstats_gl(MEM_TEXTURE, vt->indirection, filename, indirection_bytes);
+
+    // the tiles carry their own borders for the filtering
+    GLsizei size = vt->slots * VT_PHYSICAL;
+    glGenTextures(1, &vt->atlas);
+    gls_active_texture(GL_TEXTURE0 + VTEX_ATLAS_UNIT);
+    gls_bind_texture(GL_TEXTURE_2D, vt->atlas);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    if (etc2)
+        glCompressedTexImage2D(GL_TEXTURE_2D, 0, GL_COMPRESSED_RGB8_ETC2,
+                               size, size, 0,
+                               ktx_level_size(hdr->vk_format, size, size),
+                               NULL);
+    else
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, size, size, 0,
+                     GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    memstats_gl(MEM_TEXTURE, vt->atlas, filename,
+                vtex_bytes(vt) - indirection_bytes);
+
+    // the top tile, here and now, for good
+    uint32_t top = vt_tile_index(&vt->file, hdr->levels - 1, 0, 0);
+    if (vt_read_tile(&vt->file, top, vt->loads[0].data) != 0)
+    {
+        fprintf(stderr, "Error reading virtual texture %s\n", filename);
+        vtex_close(vt);
+        return -1;
+    }
+    upload(vt, top, 0, vt->loads[0].data);
+    vt->slot_used[0] = VTEX_NONE;
+    gls_active_texture(GL_TEXTURE0);
+
+    fprintf(stderr,
+            "virtual texture %s: %ux%u tiles, %u levels, %s, %u slots\n",
+            filename, hdr->tiles_x, hdr->tiles_y, hdr->levels,
+            etc2 ? "etc2" : "rgba", slot_count);
+    return 0;
+}
+
+void vtex_close(vtex *vt)
+{
+    // never opened, or closed already
+    if (vt->slot_tile == NULL)
+        return;
+
+    // the workers may still be reading into the buffers
+    for (unsigned int i = 0; i < VTEX_MAX_LOADS; i++)
+    {
+        if (vt->loads[i].tile != VTEX_NONE)
+            pool_wait(&vt->loads[i].job);
+        free(vt->loads[i].data);
+    }
+    if (vt->loaded)
+        fprintf(stderr, "virtual texture: %lu tiles loaded, %lu evicted\n",
+                vt->loaded, vt->evicted);
+
+    if (vt->indirection)
+        gls_delete_texture(vt->indirection);
+    if (vt->atlas)
+        gls_delete_texture(vt->atlas);
+    for (unsigned int l = 0; l < VT_MAX_LEVELS; l++)
+        free(vt->entries[l]);
+    free(vt->slot_tile);
+    free(vt->slot_used);
+    free(vt->tile_slot);
+    free(vt->loading);
+    free(vt->wanted);
+    memstats_sub(vt->mem_asset, MEM_HEAP, vt->heap_bytes);
+    vt_close(&vt->file);
+    memset(vt, 0, sizeof(*vt));
+}
+
+void vtex_update(vtex *vt,
+                 mat4 model_view,
+                 float radius,
+                 mat4 proj,
+                 int viewport_height)
+{
+    const vt_header *hdr = &vt->file.header;
+    vtex_view v;
+
+    vt->frame++;
+
+    // the eye in the unit sphere's space; model_view is rigid
+    for (int i = 0; i < 3; i++)
+        v.eye[i] = -glm_vec3_dot(model_view[i], model_view[3]) / radius;
+    glm_mat4_mul(proj, model_view, v.mvp);
+    glm_scale_uni(v.mvp, radius);
+    v.pixel = 2.0f / (proj[1][1] * viewport_height);
+    v.texel_u = 2.0f * GLM_PIf / (hdr->tiles_x * VT_TILE_SIZE);
+    v.texel_v = GLM_PIf / (hdr->tiles_y * VT_TILE_SIZE);
+
+    // mark what is wanted and start reading what isn't there
+    uint32_t count = wanted_tiles(vt, &v);
+    unsigned int free_load = 0;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        uint32_t tile = vt->wanted[i];
+        if (vt->tile_slot[tile] != VTEX_NONE)
+        {
+            if (vt->slot_used[vt->tile_slot[tile]] != VTEX_NONE)
+                vt->slot_used[vt->tile_slot[tile]] = vt->frame;
+            continue;
+        }
+        if (vt->loading[tile])
+            continue;
+
+        while (free_load < VTEX_MAX_LOADS &&
+               vt->loads[free_load].tile != VTEX_NONE)
+            free_load++;
+        if (free_load == VTEX_MAX_LOADS)
+            continue;
+
+        vtex_load *load = &vt->loads[free_load];
+        load->tile = tile;
+        vt->loading[tile] = 1;
+        pool_submit(&load->job, read_tile, load);
+    }
+
+    // the tiles read go in, a few a frame
+    unsigned int uploaded = 0;
+    for (unsigned int i = 0; i < VTEX_MAX_LOADS && uploaded < vt->uploads; i++)
+    {
+        vtex_load *load = &vt->loads[i];
+        if (load->tile == VTEX_NONE || !pool_done(&load->job))
+            continue;
+
+        unsigned int slot = find_slot(vt);
+        if (load->status == 0 && slot != VTEX_NONE)
+        {
+            if (vt->slot_tile[slot] != VTEX_NONE)
+                evict(vt, slot);
+            upload(vt, load->tile, slot, load->data);
+            uploaded++;
+        }
+        vt->loading[load->tile] = 0;
+        load->tile = VTEX_NONE;
+    }
+
+    gls_active_texture(GL_TEXTURE0 + VTEX_INDIRECTION_UNIT);
+    gls_bind_texture(GL_TEXTURE_2D, vt->indirection);
+    gls_active_texture(GL_TEXTURE0 + VTEX_ATLAS_UNIT);
+    gls_bind_texture(GL_TEXTURE_2D, vt->atlas);
+    gls_active_texture(GL_TEXTURE0);
+}
+
+void vtex_program(const vtex *vt, program *prog)
+{
+    gls_use_program(prog->id);
+    glUniform1i(program_uniform(prog, "vt_indirection"),
+                VTEX_INDIRECTION_UNIT);
+    glUniform1i(program_uniform(prog, "vt_atlas"), VTEX_ATLAS_UNIT);
+    glUniform3f(program_uniform(prog, "vt_params"),
+                vt->file.header.tiles_x,
+                vt->file.header.tiles_y,
+                vt->slots * VT_PHYSICAL);
+}
+
+size_t vtex_bytes(const vtex *vt)
+{
+    const vt_header *hdr = &vt->file.header;
+    size_t bytes = 0;
+
+    if (vt->slot_tile == NULL)
+        return 0;
+    for (unsigned int l = 0; l < hdr->levels; l++)
+        bytes += (size_t) tiles_x(vt, l) * tiles_y(vt, l) * 4;
+    uint32_t size = vt->slots * VT_PHYSICAL;
+    if (hdr->vk_format == KTX_VK_FORMAT_ETC2_R8G8B8_UNORM)
+        return bytes + ktx_level_size(hdr->vk_format, size, size);
+    return bytes + (size_t) size * size * 4;
+}
@@ -0,0 +1,67 @@
+#ifndef ASTRO_VTFILE_H
+#define ASTRO_VTFILE_H
+
+#include <stdint.h>
+
+// A virtual texture file, as vtbake writes it: the mip pyramid of an image
+// too big for the GPU, cut into tiles that load one at a time.
+//
+//   vt_header
+//   tiles of level 0 row by row, then those of level 1, and so on
+//
+// A tile is VT_TILE_SIZE texels square plus a border of VT_BORDER texels
+// from its neighbours, so bilinear filtering in the atlas never reaches into
+// the next slot. The border wraps around in x, as longitude does, and clamps
+// in y. Level 0 is a power of two tiles each way, so each tile has one
+// parent: level l is max(tiles_x >> l, 1) x max(tiles_y >> l, 1) tiles, down
+// to a single tile. All tiles are tile_bytes of vk_format (see ktx.h).
+#define VT_MAGIC        "ASTROVT1"
+#define VT_MAGIC_LEN    8
+#define VT_TILE_SIZE    128
+#define VT_BORDER       4
+#define VT_PHYSICAL     (VT_TILE_SIZE + 2 * VT_BORDER)
+#define VT_MAX_LEVELS   16
+
+typedef struct VtHeader
+{
+    char magic[VT_MAGIC_LEN];
+    uint32_t vk_format;
+    uint32_t tiles_x;
+    uint32_t tiles_y;
+    uint32_t levels;
+    uint32_t tile_bytes;
+    uint32_t data_offset;
+} vt_header;
+
+typedef struct VtFile
+{
+    int fd;
+    vt_header header;
+    uint32_t level_first[VT_MAX_LEVELS];    // index of each level's tile 0
+    uint32_t tile_count;
+} vt_file;
+
+// Fill in levels, tile_bytes and data_offset of a header for tiles_x x
+// tiles_y tiles of vk_format. Returns -1 if it isn't a valid pyramid.
+int vt_header_init(vt_header *hdr,
+                   uint32_t vk_format,
+                   uint32_t tiles_x,
+                   uint32_t tiles_y);
+
+uint32_t vt_level_tiles_x(const vt_header *hdr, unsigned int level);
+uint32_t vt_level_tiles_y(const vt_header *hdr, unsigned int level);
+
+// Open a virtual texture file. Returns 0 on success, -1 if it is missing or
+// isn't one.
+int vt_open(vt_file *vt, const char *filename);
+void vt_close(vt_file *vt);
+
+uint32_t vt_tile_index(const vt_file *vt,
+                       unsigned int level,
+                       uint32_t x,
+                       uint32_t y);
+
+// Read tile index into out, tile_bytes long. Safe from any thread.
+int vt_read_tile(const vt_file *vt, uint32_t index, void *out);
+
+#endif